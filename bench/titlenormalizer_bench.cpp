@@ -0,0 +1,73 @@
+#include "titlenormalizer.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QTextStream>
+#include <iterator>
+
+// Times TitleNormalizer::normalize() over a generated corpus shaped like real downloads:
+// circle tags, product codes, versions, full-width characters and plain titles.
+//   TitleNormalizerBench [names] [rounds]
+static QStringList generateCorpus(int count) {
+    static const char *const words[] = {"Dungeon", "Princess", "Quest", "Night", "Academy", "Lost", "Memories", "Witch",
+                                        "Tower", "Summer", "Island", "Record", "Eternal", "Maid", "Star", "Garden"};
+    static const char *const tags[] = {"[Circle Moon]", "(Full)", "[Eng]", "(Win)", "【DL版】", "{Steam}", "(Ver.Final)"};
+    static const char *const suffixes[] = {".zip", ".7z", ".rar", ".iso", ""};
+
+    QRandomGenerator random(42); // Same corpus every run
+    QStringList names;
+    names.reserve(count);
+    for (int n = 0; n < count; ++n) {
+        QString name;
+        if (random.bounded(3) == 0) name += QString::fromUtf8(tags[random.bounded(int(std::size(tags)))]) + ' ';
+        switch (random.bounded(5)) {
+        case 0: name += QString("RJ%1_").arg(random.bounded(100000, 99999999)); break;
+        case 1: name += QString("d_%1 ").arg(random.bounded(10000, 9999999)); break;
+        case 2: name += QString::fromUtf8("ＲＪ") + QString::number(random.bounded(100000, 999999)) + ' '; break;
+        default: break;
+        }
+        const int titleWords = 1 + random.bounded(4);
+        for (int w = 0; w < titleWords; ++w) {
+            if (w > 0) name += random.bounded(2) ? ' ' : '_';
+            name += QString::fromLatin1(words[random.bounded(int(std::size(words)))]);
+        }
+        switch (random.bounded(4)) {
+        case 0: name += QString(" v%1.%2").arg(random.bounded(1, 5)).arg(random.bounded(0, 20)); break;
+        case 1: name += QString(" ver%1.0%2").arg(random.bounded(1, 5)).arg(random.bounded(0, 9)); break;
+        default: break;
+        }
+        if (random.bounded(3) == 0) name += ' ' + QString::fromUtf8(tags[random.bounded(int(std::size(tags)))]);
+        name += QString::fromLatin1(suffixes[random.bounded(int(std::size(suffixes)))]);
+        names.append(name);
+    }
+    return names;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    const int count = args.size() > 1 ? qMax(1, args[1].toInt()) : 100000;
+    const int rounds = args.size() > 2 ? qMax(1, args[2].toInt()) : 5;
+
+    const QStringList corpus = generateCorpus(count);
+    const TitleNormalizer normalizer; // Built-in rules, so results don't depend on AppData
+
+    QTextStream out(stdout);
+    qint64 best = -1;
+    int codes = 0;
+    for (int round = 0; round < rounds; ++round) {
+        QElapsedTimer timer;
+        timer.start();
+        codes = 0;
+        for (const QString &name : corpus) {
+            const TitleNormalizer::Result result = normalizer.normalize(name, name.contains('.'));
+            if (!result.gameCode.isEmpty()) ++codes;
+        }
+        const qint64 elapsed = timer.nsecsElapsed();
+        if (best < 0 || elapsed < best) best = elapsed;
+        out << "round " << round + 1 << ": " << elapsed / 1000000.0 << " ms\n";
+    }
+    out << count << " names, " << codes << " with a code; best " << double(best) / count << " ns per name\n";
+    return 0;
+}
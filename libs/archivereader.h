@@ -0,0 +1,49 @@
+#ifndef ARCHIVEREADER_H
+#define ARCHIVEREADER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+#include "gamedata.h"
+
+// Reads the table of contents of an archive without extracting anything.
+//
+// Only directory structures are parsed: the zip central directory (found through the
+// end-of-central-directory record, Zip64 included), the 7z header, RAR 4/5 block headers
+// and the ISO9660 volume descriptors and directory extents (Joliet names when present).
+// Every archive costs at most MAX_READ_BYTES of reads and MAX_ENTRIES entries, so
+// indexing a drive full of archives is bound by seeks rather than archive sizes.
+//
+// Single small files (a cover image, an executable) can be read back out of zip archives,
+// stored or deflated, and ISO images. 7z and RAR entries would need their codecs and aren't.
+//
+// Stateless; read() and readEntry() are safe to call from any number of threads.
+class ArchiveReader {
+public:
+    struct Info {
+        bool valid = false;     // The format was recognised and its directory (partly) read
+        bool complete = false;  // The listing covers every entry
+        QStringList files;      // '/'-separated paths inside the archive, files only
+        QVector<qint64> fileSizes; // Uncompressed, parallel to files
+        QVector<qint64> fileOffsets; // Zip local header or iso extent, parallel to files; -1 elsewhere
+        QStringList executables;
+        qint64 uncompressedSize = 0;
+        QString volumeLabel;    // Iso only
+    };
+
+    static const qint64 MAX_READ_BYTES = 4 * 1024 * 1024;
+    static const int MAX_ENTRIES = 65536;
+
+    // type picks the parser (GameScanner classifies archives by suffix)
+    static Info read(const QString &path, GameType type);
+    static bool isArchive(GameType type);
+
+    // Contents of info.files[index], empty if it can't be read back or is over maxBytes
+    static QByteArray readEntry(const QString &path, GameType type, const Info &info, int index, qint64 maxBytes);
+
+    // Copies what the GameItem keeps of info into its content fields
+    static void apply(const Info &info, GameItem &item);
+};
+
+#endif // ARCHIVEREADER_H
@@ -0,0 +1,65 @@
+#ifndef CAPTUREBACKEND_H
+#define CAPTUREBACKEND_H
+
+#include <QHash>
+#include <QImage>
+#include <QProcess>
+#include <QWindow>
+
+// Finds, raises and grabs a launched game's window for ThumbnailManager, and ends the game
+// afterwards along with everything it spawned.
+//
+// Backends:
+//  - Windows: EnumWindows over the processes of a job object the game is put in, so a window
+//    opened by a child of a launcher stub is found too; closing the job kills the whole tree.
+//    The game is started suspended and only runs once it is in the job, so nothing it
+//    spawns can get out first.
+//  - X11: the window manager's _NET_CLIENT_LIST, matched by _NET_WM_PID against the game's
+//    process group
+//  - Fake: no real window. One "opens" shortly after the process starts and shows a blank
+//    frame before it "paints", so the capture scheduler can run headless
+//    (QT_QPA_PLATFORM=offscreen)
+// On Unix every backend starts the game in its own session, and killProcessTree() signals
+// the whole process group.
+//
+// Not thread-safe; use from the GUI thread.
+class CaptureBackend {
+public:
+    enum class Backend {
+        Windows,
+        X11,
+        Fake
+    };
+
+    virtual ~CaptureBackend() = default;
+
+    // Before process->start(); process stays valid until killProcessTree()
+    virtual void prepare(QProcess &process);
+    // Once process has started
+    virtual void attach(QProcess &process);
+    // Ends process and every process it started, even after process itself has exited
+    virtual void killProcessTree(QProcess &process);
+
+    // Largest visible top-level window of the game started as pid; 0 if none is up yet
+    virtual WId findWindow(qint64 pid) = 0;
+    virtual void raise(WId window) = 0;
+    // Current contents of window; null if it is gone
+    virtual QImage grab(WId window) = 0;
+    virtual Backend backend() const = 0;
+
+    // New backend for defaultBackend(); nullptr if none works here
+    static CaptureBackend *create();
+    static CaptureBackend *create(Backend backend);
+
+    // Fake under the offscreen platform, otherwise the native one;
+    // GAMEDB_CAPTURE_BACKEND=windows|x11|fake overrides it
+    static Backend defaultBackend();
+    static bool isAvailable(Backend backend);
+    static const char *backendName(Backend backend);
+
+protected:
+    // pid each attached process was started as, which is also its process group on Unix
+    QHash<const QProcess *, qint64> startedAs;
+};
+
+#endif // CAPTUREBACKEND_H
@@ -0,0 +1,45 @@
+#ifndef DIRECTORYENUMERATOR_H
+#define DIRECTORYENUMERATOR_H
+
+#include <QString>
+#include <QVector>
+
+// Lists the entries of one directory for the scanners.
+//
+// The scanners only need an entry's name and whether it is a directory, so backends are
+// free to skip building a QFileInfo and stat-ing every entry. Matches what the scanners
+// used to get from QDir::entryInfoList(NoDotAndDotDot | Files | Dirs | NoSymLinks):
+// no ".", "..", symlinks, hidden entries or special files.
+//
+// An enumerator keeps its buffers between calls and is not thread-safe; use one per thread.
+class DirectoryEnumerator {
+public:
+    enum class Backend {
+        QDir,       // QDir::entryInfoList, portable
+        Getdents    // Linux getdents64 + d_type, statx only when d_type is unknown
+    };
+
+    struct Entry {
+        QString name;
+        bool isDir = false;
+    };
+
+    virtual ~DirectoryEnumerator() = default;
+
+    // Replaces entries with the listing of path; false (and no entries) if it can't be read in full
+    virtual bool list(const QString &path, QVector<Entry> &entries) = 0;
+    virtual Backend backend() const = 0;
+
+    // New enumerator for defaultBackend()
+    static DirectoryEnumerator *create();
+    static DirectoryEnumerator *create(Backend backend);
+
+    // Getdents on Linux, QDir elsewhere; GAMEDB_SCAN_BACKEND=qdir|getdents overrides it
+    // at startup and setDefaultBackend() at runtime (for benchmarking both paths)
+    static Backend defaultBackend();
+    static void setDefaultBackend(Backend backend);
+    static bool isAvailable(Backend backend);
+    static const char *backendName(Backend backend);
+};
+
+#endif // DIRECTORYENUMERATOR_H
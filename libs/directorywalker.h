@@ -0,0 +1,111 @@
+#ifndef DIRECTORYWALKER_H
+#define DIRECTORYWALKER_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include "gamedata.h"
+#include "scanindex.h"
+#include "directoryenumerator.h"
+#include "gamefolderdetector.h"
+
+struct WalkState;
+struct WalkQueue;
+struct WalkResult;
+
+// Recursive, parallel crawl of a directory tree.
+//
+// Every worker owns a deque of directories still to enumerate. Workers take from the
+// back of their own deque (depth-first, so paths stay hot in the OS cache) and, when it
+// runs dry, steal from the front of another worker's deque (the oldest entries, which
+// tend to be the largest untouched subtrees). One slow directory on a network share
+// therefore never stalls the whole walk.
+//
+// Each worker pushes its results into its own lock-free SPSC ring. The GUI thread drains
+// the rings on a timer and spends at most DRAIN_BUDGET_MS per tick doing so (including
+// the receivers of gamesFound), so the event loop keeps running while 100k entries stream
+// in. Results of different workers interleave: a folder's contents may arrive before the
+// folder itself. Starting a new walk cancels the old one; its undrained results are dropped.
+//
+// Given the ScanIndex of a previous walk, directories whose mtime/inode are unchanged are
+// answered from it without being listed, and a finished walk leaves a fresh index behind.
+// A reportAll walk names such directories through directoriesUnchanged instead of sending
+// their entries again; receivers already hold them in the baseline.
+// Directories are listed with DirectoryEnumerator::defaultBackend() as of start().
+class DirectoryWalker : public QObject {
+    Q_OBJECT
+
+public:
+    explicit DirectoryWalker(QObject *parent = nullptr);
+    ~DirectoryWalker();
+
+    // Directories down to this depth below the root are descended into; the level below
+    // them is still listed (to classify and report it) but its subdirectories are not
+    void setMaxDepth(int depth);
+    int maxDepth() const;
+    // Classifies every directory below the root; detected game folders are not descended into.
+    // Probes run on the walk's workers, so as many run at once as directories are walked.
+    void setDetector(const GameFolderDetector &detector);
+    GameFolderDetector detector() const;
+    // Number of directories enumerated at the same time
+    void setConcurrency(int threads);
+    int concurrency() const;
+
+    bool isRunning() const;
+
+    // Index produced by the last walk that completed (not cancelled)
+    QSharedPointer<ScanIndex> lastIndex() const;
+
+public slots:
+    // reportAll: deliver every entry through gamesFound (the view is empty). Otherwise the
+    // view already shows baseline, and only new entries arrive through gamesFound, with
+    // gamesRemoved/gamesChanged emitted just before finished.
+    void start(const QString &root, QSharedPointer<const ScanIndex> baseline = QSharedPointer<const ScanIndex>(), bool reportAll = true);
+    void cancel();
+
+signals:
+    // A chunk of game candidates drained from the workers
+    void gamesFound(const QList<GameItem> &items);
+    // reportAll walks only: directories matching the baseline passed to start(). Their
+    // entries (baseline->itemsOf(dir)) don't come through gamesFound.
+    void directoriesUnchanged(const QStringList &dirs);
+    void gamesRemoved(const QStringList &paths);
+    void gamesChanged(const QList<GameItem> &items);
+    // Sampled about twice a second while a walk runs
+    void progress(double dirsPerSec, double entriesPerSec, int queueDepth);
+    void finished(qint64 dirs, qint64 entries, qint64 elapsedMs);
+
+private:
+    static void runWorker(QSharedPointer<WalkState> state, int worker);
+    static void walkDirectory(const QSharedPointer<WalkState> &state, int worker, DirectoryEnumerator &enumerator,
+                              QVector<DirectoryEnumerator::Entry> &listing, const QString &path, int depth);
+    static bool pushResult(const QSharedPointer<WalkState> &state, WalkQueue &queue, WalkResult &result);
+    static void finishWalk(const QSharedPointer<WalkState> &state, int worker);
+
+    void complete(const QSharedPointer<WalkState> &state);
+    void drain();
+    void sampleProgress();
+
+    static const int DRAIN_BUDGET_MS = 4;
+    static const int DRAIN_INTERVAL_MS = 10;
+    static const int DRAIN_CHUNK = 256; // Items per gamesFound emission
+
+    QThreadPool pool;
+    QSharedPointer<WalkState> current;
+    QSharedPointer<ScanIndex> finishedIndex;
+    int depthLimit = 16;
+    GameFolderDetector folderDetector;
+    int threads;
+
+    QTimer drainTimer;
+    QTimer progressTimer;
+    QElapsedTimer sampleClock;
+    qint64 lastDirs = 0;
+    qint64 lastEntries = 0;
+};
+
+#endif // DIRECTORYWALKER_H
@@ -0,0 +1,40 @@
+#ifndef DUPLICATEREPORTDIALOG_H
+#define DUPLICATEREPORTDIALOG_H
+
+#include <QDialog>
+#include <QTreeWidget>
+#include <QLabel>
+#include <QProgressBar>
+#include <QPushButton>
+#include "fingerprinter.h"
+
+// Library games that look like copies of each other: grouped by content fingerprint
+// (Fingerprinter) and, separately, by game code. Fingerprinting starts when the dialog
+// opens, unless a run is still going from an earlier one; code groups are shown right
+// away and content groups as soon as it finishes. Closing the dialog doesn't stop it.
+class DuplicateReportDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit DuplicateReportDialog(Fingerprinter *fingerprinter, QWidget *parent = nullptr);
+
+private slots:
+    void rescan();
+    void onProgress(int done, int total);
+    void refreshGroups();
+    void openLocation(QTreeWidgetItem *item);
+
+private:
+    void setupUI();
+    void addGroup(QTreeWidgetItem *section, const QString &title, const QList<int> &rows);
+
+    Fingerprinter *fingerprinter;
+
+    QLabel *statusLabel;
+    QProgressBar *progressBar;
+    QTreeWidget *groupTree;
+    QPushButton *rescanButton;
+    QPushButton *closeButton;
+};
+
+#endif // DUPLICATEREPORTDIALOG_H
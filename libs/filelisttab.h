@@ -13,6 +13,7 @@
 #include <QUrl>
 #include <QDebug>
 #include <QMap>
+#include <QHash>
 #include "gamedata.h"
 
 class FileListTab : public QWidget {
@@ -22,11 +23,23 @@ public:
     FileListTab();
 
     void addGameItem(const GameItem &item);
+    // Bulk insert: items are grouped by parent and attached with one insert per parent
+    void addGameItems(const QList<GameItem> &items);
+    // Removes the entries (and anything shown below them) / refreshes their texts in place
+    void removeGameItems(const QStringList &paths);
+    void updateGameItems(const QList<GameItem> &items);
+    // Makes the children shown for dir match a fresh listing; returns the folders that were added.
+    // Ignored for folders whose contents were never loaded (still lazy).
+    QStringList syncDirectory(const QString &dir, const QList<GameItem> &items);
+    QString currentRoot() const;
     void clearItems();
+    // Entries under the root whose folder hasn't been added yet are held back until it is
+    void setRootPath(const QString &path);
 
 signals:
     void scanRequested(const QString &path);
     void requestAddGame(const GameItem &item);
+    void requestAddGames(const QList<GameItem> &items);
 
 public slots:
     void onGameAdded(const GameItem &item);
@@ -40,17 +53,28 @@ private:
     
     void filterItems(QTreeWidgetItem *item); // Recursive logic helper
     void updateItemHighlight(QTreeWidgetItem *item, bool isSaved);
+    GameItem gameItemFromTreeItem(QTreeWidgetItem *item) const;
+    QTreeWidgetItem *createTreeItem(const GameItem &item) const;
+    static QString typeName(GameType type);
+    void forgetItem(QTreeWidgetItem *item); // Drops item and its descendants from the path maps
     
     // Helper to find parent items quickly.
     // Key: Absolute Path of the folder
     // Value: Pointer to QTreeWidgetItem
     QMap<QString, QTreeWidgetItem*> itemMap;
+    // Every item by path, so library add/remove highlights don't search the tree
+    QHash<QString, QTreeWidgetItem*> pathItems;
+
+    // Parallel scans can deliver a folder's contents before the folder; they wait here, keyed by parent path
+    QString rootPath;
+    QHash<QString, QList<GameItem>> orphans;
 
 private slots:
     void onTypeFilterChanged(int index);
     void showContextMenu(const QPoint &pos);
     void openFileLocation();
     void renameFolder();
+    void addSelectedToLibrary();
     void onItemExpanded(QTreeWidgetItem *item);
     void onDoubleClicked(QTreeWidgetItem *item, int column);
 
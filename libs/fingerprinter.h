@@ -0,0 +1,89 @@
+#ifndef FINGERPRINTER_H
+#define FINGERPRINTER_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QVector>
+#include <QPair>
+#include <QThreadPool>
+#include <QTimer>
+#include <QSharedPointer>
+#include "gamedata.h"
+
+struct FingerprintJob;
+
+// Content fingerprints for finding copies of one game, whatever their path or form.
+//
+// A folder is fingerprinted by its file set (relative paths and sizes), and so is an
+// archive whose listing ArchiveReader can read completely. An extracted folder and the
+// zip it came from therefore end up with the same fingerprint. Any other file is
+// fingerprinted by its size and three sampled blocks (head, middle, tail). Both are
+// hashed with XXH64.
+//
+// Runs on its own small pool with a read rate limit, so a library spread over spinning
+// drives doesn't grind the rest of the app to a halt. Results are cached in
+// AppData/fingerprints.dat and reused while a path's mtime and size are unchanged. For
+// a folder that is its own mtime, which catches files added or removed directly inside it.
+//
+// MainWindow owns the one instance, so a job keeps going after the dialog that started
+// it is closed.
+class Fingerprinter : public QObject {
+    Q_OBJECT
+
+public:
+    struct CacheEntry {
+        qint64 mtime = 0;   // msecs since epoch
+        qint64 size = 0;    // 0 for folders
+        quint64 fingerprint = 0;
+    };
+
+    explicit Fingerprinter(QObject *parent = nullptr);
+    ~Fingerprinter();
+
+    // Paths hashed at the same time (default 2; more only makes one disk seek harder)
+    void setConcurrency(int threads);
+    // Bytes read per second over all threads, 0 for no limit (default 64 MiB/s)
+    void setReadLimit(qint64 bytesPerSec);
+    bool isRunning() const;
+
+    // Last known fingerprint of path, 0 if it has none yet
+    quint64 fingerprint(const QString &path) const;
+
+    static quint64 fingerprintFile(const QString &path, qint64 size);
+    // Paths relative to the game, '/'-separated; order doesn't matter
+    static quint64 fingerprintFileSet(QVector<QPair<QString, qint64>> files);
+
+public slots:
+    // Fingerprints every game; cancels a running job. A completed run replaces the cache,
+    // so it holds only games still in the library.
+    void start(const QList<GameItem> &games);
+    // Keeps (and saves) what the job had finished, merged into the cache
+    void cancel();
+
+signals:
+    void progress(int done, int total);
+    void finished();
+
+private:
+    static void runGame(const QSharedPointer<FingerprintJob> &job, const GameItem &game);
+    static quint64 fingerprintFolder(const QSharedPointer<FingerprintJob> &job, const QString &path);
+    static void throttle(const QSharedPointer<FingerprintJob> &job, qint64 bytes);
+
+    void poll();
+    void loadCache();
+    // Writes the cache on savePool
+    void queueSave();
+    static bool saveCache(const QHash<QString, CacheEntry> &cache);
+    static QString cachePath();
+
+    QThreadPool pool;
+    QThreadPool savePool; // One thread, so saves land in the order they were queued
+    QSharedPointer<FingerprintJob> current;
+    QTimer pollTimer;
+    qint64 readLimit = 64 * 1024 * 1024;
+    QHash<QString, CacheEntry> cache; // GUI thread only; jobs get a copy
+};
+
+#endif // FINGERPRINTER_H
@@ -0,0 +1,62 @@
+#ifndef FOLDERWATCHER_H
+#define FOLDERWATCHER_H
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QStringList>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+
+// Watches directories for entries being added, removed or renamed and reports them
+// in debounced batches: a burst (an archive extracting thousands of files) becomes one
+// directoriesChanged after it goes quiet, or at least every MAX_LATENCY_MS while it lasts.
+//
+// Each watched directory costs an OS handle (an inotify watch, a Windows change handle),
+// so at most budget() directories are watched, shallowest first. Past the budget the
+// rest of the tree is only covered by fallbackScanDue, a periodic hint to run an
+// incremental rescan.
+class FolderWatcher : public QObject {
+    Q_OBJECT
+
+public:
+    explicit FolderWatcher(QObject *parent = nullptr);
+
+    void setBudget(int maxDirectories);
+    int budget() const;
+    void setFallbackInterval(int msecs);
+
+    // Replaces the watched set
+    void watchDirectories(QStringList dirs);
+    // Adds one directory; false if it doesn't fit in the budget
+    bool watch(const QString &dir);
+    void clear();
+
+    int watchedCount() const;
+    bool isOverBudget() const;
+
+signals:
+    void directoriesChanged(const QStringList &dirs);
+    void fallbackScanDue();
+
+private slots:
+    void onDirectoryChanged(const QString &path);
+    void flush();
+
+private:
+    void setOverBudget(bool over);
+
+    static const int DEBOUNCE_MS = 500;
+    static const int MAX_LATENCY_MS = 5000;
+
+    QFileSystemWatcher watcher;
+    int maxDirectories = 4096;
+    bool overBudget = false;
+
+    QSet<QString> dirty;
+    QTimer debounceTimer;
+    QElapsedTimer dirtySince;
+    QTimer fallbackTimer;
+};
+
+#endif // FOLDERWATCHER_H
@@ -2,7 +2,11 @@
 #define GAMEDATA_H
 
 #include <QString>
+#include <QByteArray>
 #include <QDateTime>
+#include <QFlags>
+#include <QStringList>
+#include "tagset.h"
 
 enum class GameType {
     Folder,
@@ -10,9 +14,29 @@ enum class GameType {
     SevenZip,
     Rar,
     Iso,
-    Unknown
+    Unknown,
+    Directory   // Folder without game content; only shown in the file tree to navigate through
 };
 
+// Groups of GameItem fields, used to describe what an edit touched
+enum class GameField {
+    None = 0x000,
+    Name = 0x001,       // cleanName, originalName
+    FolderName = 0x002,
+    Type = 0x004,
+    Korean = 0x008,
+    Tags = 0x010,
+    LastPlayed = 0x020,
+    Path = 0x040,       // filePath, exePath
+    Thumbnail = 0x080,
+    Metadata = 0x100,   // source, gameCode
+    Missing = 0x200,    // Runtime only: filePath disappeared from disk (GameManager::isMissing)
+    Contents = 0x400,   // contentSize, contentFiles, contentExecutables, volumeLabel
+    All = 0x7FF
+};
+Q_DECLARE_FLAGS(GameFields, GameField)
+Q_DECLARE_OPERATORS_FOR_FLAGS(GameFields)
+
 struct GameItem {
     QString originalName;
     QString cleanName;
@@ -22,13 +46,20 @@ struct GameItem {
     // Extended Metadata
     bool koreanSupport = false;
     QString folderName; // Folder name or File name without path
-    QStringList tags;
+    TagSet tags; // Ids interned by TagManager
     QString source; // e.g. "DLsite", "Steam"
     QString gameCode; // e.g. "RJ123456"
     
     // Thumbnail & Launch
     QString thumbnailPath;
+    QByteArray thumbnailPreview; // ThumbnailPreview code of thumbnailPath, painted until it loads; may be empty
     QString exePath; // Specific executable to run (for Folder type games)
+
+    // Archive contents, from the archive's own directory (ArchiveReader); empty for folders
+    qint64 contentSize = 0; // Uncompressed bytes
+    int contentFiles = 0;
+    QStringList contentExecutables; // Paths inside the archive
+    QString volumeLabel; // Iso only
     
     // Statistics
     QDateTime lastPlayed;
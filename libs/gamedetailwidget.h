@@ -23,9 +23,12 @@ private slots:
     void onPlayClicked();
     void onOpenClicked();
     void onEditClicked();
+    void onImagesLoaded(const QStringList &thumbnailPaths);
 
 private:
     void setupUI();
+    // From ImageProvider without blocking; the preview code stands in while it loads
+    void showThumbnail();
 
     GameItem item;
     QLabel *thumbnailLabel;
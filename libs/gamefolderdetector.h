@@ -0,0 +1,48 @@
+#ifndef GAMEFOLDERDETECTOR_H
+#define GAMEFOLDERDETECTOR_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include "directoryenumerator.h"
+
+// Decides from its contents whether a directory holds a game.
+//
+// The folder and up to maxDepth() levels below it are probed breadth-first for:
+//  - engine markers: data.win (GameMaker), *.rpgproject / *.rgss?a (RPG Maker),
+//    UnityPlayer.dll (Unity), www/ + package.json (NW.js), renpy/ + game/ (Ren'Py)
+//  - executables, ignoring installers, uninstallers and crash handlers
+//  - archives, when the folder itself holds nothing but archives and documents
+// A probe never lists more than ioBudget() directories (the folder's own listing included),
+// so a huge non-game tree costs the same as a small one.
+//
+// Holds only settings; detect() is const and safe to call from several threads at once.
+class GameFolderDetector {
+public:
+    struct Detection {
+        bool isGame = false;
+        QString exePath; // Best launch candidate; empty if the folder was recognised without one
+        // Directories below the folder that were listed, with their mtime from just before
+        // listing. The answer holds only while these and the folder's own mtime are unchanged.
+        QHash<QString, qint64> probed;
+    };
+
+    void setMaxDepth(int depth);
+    int maxDepth() const;
+    void setIoBudget(int listings);
+    int ioBudget() const;
+
+    // listing: the folder's own entries, already read by the caller
+    Detection detect(const QString &path, const QVector<DirectoryEnumerator::Entry> &listing, DirectoryEnumerator &enumerator) const;
+    // Lists path first
+    Detection detect(const QString &path, DirectoryEnumerator &enumerator) const;
+
+    // Installers, uninstallers and crash handlers, by file name
+    static bool isHelperExecutable(const QString &fileName);
+
+private:
+    int depthLimit = 1;
+    int listingBudget = 8;
+};
+
+#endif // GAMEFOLDERDETECTOR_H
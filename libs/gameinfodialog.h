@@ -36,15 +36,18 @@ private slots:
     void save();
     void onCaptureClicked();
     void onBrowseExeClicked();
-    void onCaptureFinished(const QString &path);
-    void onCaptureFailed(const QString &reason);
+    void onCaptureFinished(const QString &id, const QString &path);
+    void onCaptureFailed(const QString &id, const QString &reason);
     void onToggleAdvanced();
     void onBrowseThumbnail();
     void onPasteThumbnail();
+    void onImagesLoaded(const QStringList &thumbnailPaths);
 
 private:
     void setupUI();
+    // Shows thumbnailPath from ImageProvider without blocking; called again once it has loaded
     void updateThumbnailPreview();
+    void setThumbnailPath(const QString &path);
 
     GameItem item;
     QLineEdit *nameEdit;
@@ -2,7 +2,10 @@
 #define GAMELIBRARYMODEL_H
 
 #include <QAbstractTableModel>
+#include <QSet>
+#include <QStringList>
 #include "gamedata.h"
+#include "librarytable.h"
 
 // Define custom roles for our model to use in Card View and Proxy Filter
 enum GameRoles {
@@ -13,7 +16,8 @@ enum GameRoles {
     TypeRole,
     TagsRole,
     KoreanSupportRole,
-    LastPlayedRole
+    LastPlayedRole,
+    CardIconRole // Thumbnail at card size; DecorationRole is the table's 48px icon
 };
 
 class GameLibraryModel : public QAbstractTableModel {
@@ -32,12 +36,28 @@ public:
     // Custom functions to interact with the underlying data
     void refreshData();
     GameItem getGame(int row) const;
+    // Borrowed pointer for hot paths (filtering) that must not copy the item; valid until the next library change
+    const GameItem *gameAt(int row) const;
 
 public slots:
     void onLibraryUpdated();
+    void onGamesAboutToBeInserted(int first, int last);
+    void onGamesInserted(int first, int last);
+    void onGamesAboutToBeRemoved(int first, int last);
+    void onGamesRemoved(int first, int last);
+    void onGamesChanged(const QList<int> &rows, GameFields fields);
+    void onImagesLoaded(const QStringList &thumbnailPaths);
 
 private:
-    const QList<GameItem> *libraryRef;
+    void flushLoadedThumbnails();
+    void emitRowRuns(const QList<int> &sortedRows, int firstColumn, int lastColumn, const QVector<int> &roles);
+
+    const LibraryTable *libraryRef;
+    // Rows announced to views. Inside a GameManager batch the library grows before
+    // the insert is announced, so rowCount() must not read the list size directly.
+    int rows = 0;
+    // Thumbnails loaded since the last repaint pass
+    QSet<QString> loadedThumbnails;
 };
 
 #endif // GAMELIBRARYMODEL_H
@@ -8,6 +8,8 @@
 #include <QComboBox>
 #include <QToolButton>
 #include <QSortFilterProxyModel>
+#include <QPersistentModelIndex>
+#include <QTimer>
 #include "gamemanager.h"
 #include "multiselectcombobox.h"
 #include "gamelibrarymodel.h"
@@ -21,12 +23,17 @@ public:
     GameListTab();
     void refreshList();
 
+signals:
+    // Launch the games and grab a thumbnail from each (ThumbnailManager)
+    void captureRequested(const QList<GameItem> &games);
+
 private slots:
     void onSearchChanged(const QString &text);
     void onDoubleClicked(const QModelIndex &index);
     void showContextMenu(const QPoint &pos);
     void openFileLocation();
     void removeGame();
+    void captureSelected();
 
     void onRowClicked(const QModelIndex &index);
     void runGame(QString exePath);
@@ -47,12 +54,18 @@ private slots:
     void onTagFilterChanged();
     void updateTagFilterCombo();
 
+    // Tells ImageProvider which thumbnails the current view shows, so off-screen loads get dropped
+    void updateThumbnailViewport();
+
 private:
     void setupUI();
+    void expandDetail(const QModelIndex &rowIndex);
+    void collapseDetail();
     
     QLineEdit *searchEdit;
     QComboBox *typeFilterCombo;
     MultiSelectComboBox *tagFilterCombo;
+    QToolButton *tagMatchBtn;
     QToolButton *viewToggleBtn;
     
     // Sorting
@@ -67,7 +80,10 @@ private:
     GameLibraryModel *libraryModel;
     GameListFilterProxyModel *proxyModel;
     
-    int expandedRow;
+    // Persistent so the expanded row survives sorting, filtering and row-level updates
+    QPersistentModelIndex expandedIndex;
+
+    QTimer *viewportTimer;
 };
 
 #endif // GAMELISTTAB_H
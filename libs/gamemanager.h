@@ -3,13 +3,22 @@
 
 #include <QObject>
 #include <QList>
+#include <QHash>
+#include <QMultiHash>
+#include <QSet>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QFile>
 #include <QStandardPaths>
 #include <QDir>
+#include <QThreadPool>
+#include <QFutureWatcher>
 #include "gamedata.h"
+#include "libraryjournal.h"
+#include "librarytable.h"
+
+class TagManager;
 
 class GameManager : public QObject {
     Q_OBJECT
@@ -21,33 +30,150 @@ public:
     void updateGame(const GameItem &item);
     void removeGame(int index);
     void removeGameByPath(const QString &path);
-    const QList<GameItem>& getGames() const;
+    // Removes every listed game in one batch; unknown paths are skipped
+    void removeGames(const QStringList &paths);
+    // Rows decode from the snapshot as they are read; see LibraryTable
+    const LibraryTable& getGames() const;
     GameItem getGameByPath(const QString &path) const;
+
+    // O(1) lookups backed by secondary indexes; rows index into getGames()
+    bool containsPath(const QString &path) const;
+    int indexOfPath(const QString &path) const;
+    int indexOfExePath(const QString &exePath) const;
+    QList<int> rowsForThumbnail(const QString &thumbnailPath) const;
+
+    // Number of games carrying a tag, from the inverted tag index (no library scan)
+    int tagCount(const QString &tag) const;
+    int tagCount(int tagId) const;
+
+    // Games whose filePath sits directly in dir, and every such directory
+    QStringList pathsInDirectory(const QString &dir) const;
+    QStringList libraryDirectories() const;
+    static QString parentDirectory(const QString &path);
+
+    // Entries whose file or folder vanished (drive unplugged, moved away). Kept rather than
+    // removed so tags and play history survive; not persisted, re-checked every session.
+    bool isMissing(const QString &path) const;
+    void setMissing(const QString &path, bool missing);
+    // Checks every game's filePath on a worker thread and updates the missing flags
+    void verifyPaths();
     
     void updateLastPlayed(const QString &path);
 
+    // Fills in thumbnailPath -> ThumbnailPreview code for games showing that thumbnail that
+    // have no preview yet (libraries from before previews, captures applied elsewhere).
+    // Journaled as one small "preview" record per game.
+    void setThumbnailPreviews(const QHash<QString, QByteArray> &previews);
+
+    // Groups mutations into one transaction: the journal is written once and a single
+    // change notification is emitted when the outermost batch commits. Batches nest.
+    void beginBatch();
+    void commitBatch();
+
+    // Scoped helper so a batch always commits, even on early return
+    class BatchGuard {
+    public:
+        explicit BatchGuard(GameManager &manager = GameManager::instance()) : manager(manager) { manager.beginBatch(); }
+        ~BatchGuard() { manager.commitBatch(); }
+    private:
+        Q_DISABLE_COPY(BatchGuard)
+        GameManager &manager;
+    };
+
+    // Writes a full snapshot synchronously and clears the journal. Like compaction, does
+    // nothing while a damaged snapshot is set aside (see loadGames()).
     void saveGames();
     void loadGames();
 
+    // Folds the journal into a new snapshot on a background thread
+    void compactJournal();
+
+    // Helper for JSON serialization (games.json schema, also used by the journal).
+    // Tags are stored by name, in the game's own order; tags resolves them.
+    static QJsonObject gameToJson(const GameItem &item, const TagManager &tags);
+    static GameItem jsonToGame(const QJsonObject &obj, TagManager &tags);
+
 public slots:
     void onTagRenamed(const QString &oldTag, const QString &newTag);
     void onTagRemoved(const QString &tag);
+    void onTagsMerged(int fromId, int intoId);
 
 signals:
     void gameAdded(GameItem item);
     void gameRemoved(QString path);
+    // Everything may have changed; receivers should re-read the whole library
     void libraryUpdated();
 
+    // Row-level notifications, modelled on QAbstractItemModel's begin/end pairs.
+    // Inside a batch, inserted rows are announced on commit and are already in
+    // getGames() when gamesAboutToBeInserted fires, so receivers must track their own count.
+    // Likewise removed rows are already gone; their ranges are announced first, bottom up,
+    // in the row numbers receivers last saw, then the appended range, then changed rows.
+    void gamesAboutToBeInserted(int first, int last);
+    void gamesInserted(int first, int last);
+    void gamesAboutToBeRemoved(int first, int last);
+    void gamesRemoved(int first, int last);
+    // Rows (ascending) whose contents changed in place, and which fields changed
+    void gamesChanged(const QList<int> &rows, GameFields fields);
+    // Per-tag counts changed; queued, so a batch or a load emits it once
+    void tagCountsChanged();
+
 private:
     GameManager(QObject *parent = nullptr);
     ~GameManager();
     
-    QList<GameItem> library;
+    LibraryTable library;
     QString savePath;
+    QString legacyJsonPath; // Pre-snapshot games.json, imported once if no snapshot exists
+
+    // Every mutation is appended here instead of rewriting the snapshot
+    LibraryJournal *journal;
+    QThreadPool compactionPool;
+    QFutureWatcher<bool> compactionWatcher;
+    bool compacting = false;
+    // games.gdb failed to load; writing a new one would replace the data it may still hold
+    bool snapshotBlocked = false;
+
+    // Secondary indexes, kept in sync by the row helpers below. The row-keyed ones are
+    // renumbered lazily after removals (staleRowsFrom), hence mutable.
+    mutable QHash<QString, int> pathIndex;
+    mutable QMultiHash<QString, int> exeIndex;
+    mutable QMultiHash<QString, int> thumbnailIndex;
+    mutable int staleRowsFrom = -1; // First row whose index entries predate a removal, -1 if none
+    // Tag id -> filePaths of the games carrying it. Paths rather than rows, so removals
+    // don't have to shift it; rows are resolved through pathIndex when needed.
+    QHash<int, QSet<QString>> tagIndex;
+    QMultiHash<QString, QString> dirIndex; // Parent directory -> filePaths
+    QSet<QString> missingPaths;
+    bool tagCountsPending = false;
+
+    void indexRow(int row);
+    void unindexRow(int row);
+    void rebuildIndexes();
+    void insertRow(const GameItem &item);
+    void replaceRow(int row, const GameItem &item);
+    void removeRow(int row);
+    void reindexStaleRows() const;
+    QList<int> rowsForTag(int tagId) const; // Ascending
+    void moveTag(int fromId, int intoId);
+    QList<int> dropTag(int tagId);          // Returns the rows that lost it
+    void scheduleTagCountsChanged();
+
+    // Pending transaction state, flushed by commitBatch()
+    int batchDepth = 0;
+    QList<QJsonObject> batchRecords;
+    QHash<QString, GameFields> batchChanges; // By filePath, since removals shift rows
+    int batchInsertFrom = -1;      // First row appended in this batch
+    QList<int> batchRemoved;       // Announced rows removed, ascending, numbered as before the batch
+
+    void notifyRowsChanged(const QList<int> &rows, GameFields fields);
+    void recordBatchRemoval(int row);
+    static GameFields changedFields(const GameItem &before, const GameItem &after);
 
-    // Helper for JSON serialization
-    QJsonObject gameToJson(const GameItem &item);
-    GameItem jsonToGame(const QJsonObject &obj);
+    void appendJournal(const QJsonObject &record);
+    void applyJournalRecord(const QJsonObject &record);
+    void loadLegacyJson();
+    void installPendingSnapshot();
 };
 
 #endif // GAMEMANAGER_H
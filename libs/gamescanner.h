@@ -5,8 +5,12 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QThread>
-#include <QRegularExpression>
+#include <QThreadPool>
+#include <memory>
 #include "gamedata.h"
+#include "directoryenumerator.h"
+#include "gamefolderdetector.h"
+#include "scanindex.h"
 
 class GameScanner : public QObject {
     Q_OBJECT
@@ -14,17 +18,45 @@ class GameScanner : public QObject {
 public:
     explicit GameScanner(QObject *parent = nullptr);
 
+    // Fills item for an entry of the directory prefix (ending in '/') that could be a game;
+    // false if it can't be one. Thread-safe, shared with DirectoryWalker's workers.
+    // Directories come out as GameType::Directory until classifyFolder() is applied.
+    static bool itemForEntry(const QString &prefix, const DirectoryEnumerator::Entry &entry, GameItem &item);
+    // Folder with the detected exe if found is a game, otherwise Directory
+    static void classifyFolder(const GameFolderDetector::Detection &found, GameItem &item);
+    // Fills item's content fields from its archive; stamp is the file as it was before the
+    // read, false if it couldn't be statted (the contents are then not worth caching)
+    static bool readArchive(GameItem &item, ScanIndex::FileStamp &stamp);
+
+    void setDetector(const GameFolderDetector &detector);
+
 public slots:
     void scanDirectory(const QString &path);
+    // Re-lists directories reported by FolderWatcher, one directoryScanned per path
+    void rescanDirectories(const QStringList &paths);
+    // Stats library entries here rather than on the GUI thread; answers with pathsChecked
+    void checkPaths(const QStringList &paths);
 
 signals:
-    void gameFound(GameItem item);
+    // Everything found in one scanDirectory() call, as a single cross-thread event
+    void gamesFound(const QList<GameItem> &items);
     void scanFinished();
+    // Complete current listing of path (empty if it no longer exists), and the ScanIndex
+    // record a walk would have made of it (mtime 0 if it couldn't be listed). record.self
+    // is classified as if path were below the root.
+    void directoryScanned(const QString &path, const QList<GameItem> &items, const ScanIndex::DirRecord &record);
+    void pathsChecked(const QStringList &missing, const QStringList &present);
 
 private:
-    void processEntry(const QFileInfo &info);
-    QString cleanGameName(const QString &name);
-    GameType determineType(const QFileInfo &info);
+    QList<GameItem> listDirectory(const QString &path, ScanIndex::DirRecord *record = nullptr);
+    static GameType determineType(const QString &name, bool isDir);
+
+    GameFolderDetector detector;
+    std::unique_ptr<DirectoryEnumerator> enumerator;
+    QVector<DirectoryEnumerator::Entry> listing;
+    // Probes subfolders and reads archives for listDirectory; kept off the global pool so
+    // a slow drive here doesn't starve thumbnail and fingerprint work
+    QThreadPool pool;
 };
 
 #endif // GAMESCANNER_H
@@ -4,8 +4,19 @@
 #include <QObject>
 #include <QIcon>
 #include <QString>
+#include <QStringList>
+#include <QSet>
+#include <QList>
+#include <QImage>
+#include <QTimer>
 #include <QPixmapCache>
-#include <QMutex>
+#include <QHash>
+#include <QByteArray>
+#include <QThreadPool>
+#include <QFutureWatcher>
+#include "thumbnailcache.h"
+#include "thumbnailloader.h"
+#include "thumbnailpack.h"
 
 class ImageProvider : public QObject {
     Q_OBJECT
@@ -13,21 +24,77 @@ class ImageProvider : public QObject {
 public:
     static ImageProvider& instance();
     
-    // Returns the cached icon instantly if available, otherwise returns a null/placeholder icon
-    // and begins loading it asynchronously.
-    QIcon getIcon(const QString &thumbnailPath);
+    // Returns the cached icon instantly if available, otherwise returns a placeholder icon
+    // and begins loading it asynchronously. size is the variant the view draws at. The
+    // placeholder is preview (the game's ThumbnailPreview code) blown up to size, or flat
+    // grey if there is none.
+    QIcon getIcon(const QString &thumbnailPath, ThumbnailCache::Size size = ThumbnailCache::Icon,
+                  const QByteArray &preview = QByteArray());
+
+    // The decoded thumbnail if it is cached or packed; otherwise null and, unless it already
+    // failed to decode (failed is then set), a load is queued. For widgets showing one image:
+    // call again when imagesLoaded() lists thumbnailPath.
+    QPixmap pixmap(const QString &thumbnailPath, ThumbnailCache::Size size, bool *failed = nullptr);
+
+    // What a view shows right now (in paint order) and the screens around it. Uncached ones
+    // are loaded in that order; queued loads of size that are in neither list are cancelled.
+    void setViewport(ThumbnailCache::Size size, const QStringList &visible, const QStringList &prefetch);
+
+    ThumbnailLoader::Stats loaderStats() const;
+
+    // thumbnailPath was rewritten or deleted; forget every cached and packed copy of it
+    void invalidate(const QString &thumbnailPath);
 
 signals:
-    // Emitted when an image finishes loading in the background
-    void imageLoaded(const QString &thumbnailPath);
+    // Thumbnails that finished loading in the background since the last emission, deduplicated.
+    // Emitted once per conversion batch, so a burst of completions costs one repaint pass.
+    void imagesLoaded(const QStringList &thumbnailPaths);
+    // ThumbnailPreview codes of thumbnails decoded for games that were painted without one,
+    // by thumbnailPath; meant for GameManager::setThumbnailPreviews()
+    void previewsComputed(const QHash<QString, QByteArray> &previews);
 
 private:
     explicit ImageProvider(QObject *parent = nullptr);
     ~ImageProvider();
 
+    static QString cacheKey(const QString &thumbnailPath, ThumbnailCache::Size size);
+    QIcon previewIcon(const QByteArray &preview, ThumbnailCache::Size size);
+    void takePreview(const QString &thumbnailPath, const QByteArray &preview);
+    void encodePreview(const QString &thumbnailPath, const QImage &packed);
+    void onLoaded(const QString &thumbnailPath, ThumbnailCache::Size size, const QImage &image, const QByteArray &preview);
+    void convertBatch();
+    void flushPack();
+    void onPackWritten();
+
+    struct Decoded {
+        QString thumbnailPath;
+        ThumbnailCache::Size size;
+        QImage image;
+        QByteArray preview;
+    };
+
     QIcon placeholderIcon;
-    QList<QString> pendingLoads;
-    QMutex mutex;
+    ThumbnailLoader loader;
+    QList<Decoded> decoded;     // Waiting to become pixmaps
+    QTimer conversionTimer;
+    QSet<QString> failedLoads; // Cache keys that didn't decode; not retried, or every repaint would queue them again
+    QSet<QString> previewedPaths; // Have a preview, or one was computed this session
+    QHash<QString, QByteArray> computedPreviews; // Emitted with the next conversion batch
+    QThreadPool previewPool; // Encodes packed thumbnails, which never pass through the loader
+
+    // Decoded thumbnails survive restarts in the pack. New decodes collect here and are
+    // appended to it in the background; once it holds too much dead data it is compacted
+    // into a fresh pack instead, which replaces the mapped one when done.
+    ThumbnailPack pack;
+    QString packPath;
+    QHash<quint64, QImage> packAdditions;
+    qint64 packAdditionBytes = 0;
+    QSet<quint64> packDropped;   // Packed but invalidated
+    QSet<quint64> packWriting;   // Dropped keys the running write leaves out
+    bool packCompacting = false; // The running write builds thumbnails.pack.new
+    QTimer packTimer;
+    QThreadPool packPool;
+    QFutureWatcher<bool> packWatcher;
 };
 
 #endif // IMAGEPROVIDER_H
@@ -0,0 +1,51 @@
+#ifndef LIBRARYJOURNAL_H
+#define LIBRARYJOURNAL_H
+
+#include <QString>
+#include <QList>
+#include <QFile>
+#include <QJsonObject>
+
+// Append-only write-ahead log for library mutations.
+// Each record is one compact JSON object per line, so the cost of a write
+// depends on the size of the change rather than the size of the library.
+//
+// The journal has two segments on disk:
+//   <path>          - the active segment new records are appended to
+//   <path>.rotated  - records already handed to a snapshot that is still being written
+// A segment is only deleted once the snapshot that covers it is safely on disk,
+// and replaying records is idempotent, so a crash at any point loses nothing.
+class LibraryJournal {
+public:
+    explicit LibraryJournal(const QString &path);
+    ~LibraryJournal();
+
+    bool append(const QJsonObject &record);
+    bool append(const QList<QJsonObject> &records);
+
+    // Number of records / bytes in the active segment
+    int recordCount() const;
+    qint64 size() const;
+
+    // Moves the active segment aside (merging into an existing rotated segment
+    // if a previous compaction did not finish) and starts a fresh one.
+    bool rotate();
+    // Drops the rotated segment once a snapshot containing its records is written.
+    void discardRotated();
+    // Drops both segments. Only valid right after a full synchronous snapshot.
+    void reset();
+
+    // Returns the rotated segment followed by the active one, in write order.
+    QList<QJsonObject> readAll() const;
+
+private:
+    bool openActive();
+    static void readSegment(const QString &path, QList<QJsonObject> &out);
+
+    QString path;
+    QString rotatedPath;
+    QFile file;
+    int records = 0;
+};
+
+#endif // LIBRARYJOURNAL_H
@@ -0,0 +1,117 @@
+#ifndef LIBRARYSNAPSHOT_H
+#define LIBRARYSNAPSHOT_H
+
+#include <QString>
+#include <QList>
+#include <QStringList>
+#include <QFile>
+#include <QHash>
+#include "gamedata.h"
+
+// Versioned binary snapshot of the game library (games.gdb).
+//
+// Layout (native byte order, checked on open):
+//   Header       - magic, version, record size and section offsets
+//   Record table - one fixed-size record per game, strings stored as (offset, length) refs
+//   Tag refs     - string refs for every game's tags, records point at a contiguous run
+//   Path index   - open-addressing hash table of record numbers keyed by filePath
+//   String pool  - deduplicated UTF-16 text
+//
+// The file is memory-mapped, so opening it costs the same for 10 or 100k games and
+// single records can be read (or looked up by path) without touching the rest.
+// Newer versions may only append fields to the record; readers use the record size
+// from the header so old files keep loading.
+class LibrarySnapshot {
+public:
+    LibrarySnapshot();
+    ~LibrarySnapshot();
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const;
+
+    int count() const;
+    GameItem gameAt(int index) const;
+    // Single fields, without decoding the rest of the record
+    QString filePathAt(int index) const;
+    QString cleanNameAt(int index) const;
+    QString exePathAt(int index) const;
+    QString thumbnailPathAt(int index) const;
+    QList<int> tagIdsAt(int index) const;
+    int indexOfPath(const QString &path) const; // -1 if not found
+    QList<GameItem> readAll() const;
+
+    // Interns every tag name with TagManager up front. Reads only look tags up afterwards,
+    // so gameAt() and tagIdsAt() may then run on any thread; before, GUI thread only.
+    void resolveTags();
+
+    // tagDictionary maps the ids in GameItem::tags to names (TagManager::tagDictionary()).
+    // It is passed in rather than looked up so the write can run on a worker thread.
+    static bool write(const QString &path, const QList<GameItem> &games, const QStringList &tagDictionary);
+
+    // Lossless conversion from/to the games.json schema used by GameManager
+    static bool importJson(const QString &jsonPath, const QString &snapshotPath);
+    static bool exportJson(const QString &snapshotPath, const QString &jsonPath);
+
+    static quint32 hashPath(const QString &path);
+
+    struct StringRef {
+        quint32 offset; // In UTF-16 units from the start of the string pool
+        quint32 length;
+    };
+
+    struct Header {
+        char magic[4];
+        quint32 version;
+        quint32 byteOrder;
+        quint32 recordSize;
+        quint32 recordCount;
+        quint32 tagRefCount;
+        quint32 pathIndexSlots;
+        quint32 reserved;
+        quint64 recordsOffset;
+        quint64 tagRefsOffset;
+        quint64 pathIndexOffset;
+        quint64 stringPoolOffset;
+        quint64 stringPoolUnits;
+    };
+
+    struct Record {
+        StringRef originalName;
+        StringRef cleanName;
+        StringRef filePath;
+        StringRef folderName;
+        StringRef source;
+        StringRef gameCode;
+        StringRef thumbnailPath;
+        StringRef exePath;
+        qint64 lastPlayed; // msecs since epoch, INVALID_TIME if never played
+        quint32 tagFirst;
+        quint32 tagCount;
+        quint8 type;
+        quint8 flags;
+        quint16 reserved0;
+        quint32 reserved1;
+        // Version 2
+        StringRef volumeLabel;
+        StringRef contentExecutables; // '\n'-separated
+        qint64 contentSize;
+        quint32 contentFiles;
+        quint32 reserved2;
+        // Version 3
+        quint8 thumbnailPreview[112]; // ThumbnailPreview code, zero-padded; none if the first byte is 0
+    };
+
+private:
+    Record recordAt(int index) const;
+    QString stringAt(const StringRef &ref) const;
+    int tagIdFor(const StringRef &ref) const;
+
+    QFile file;
+    const uchar *data = nullptr;
+    qint64 size = 0;
+    Header header;
+    mutable QHash<quint32, int> tagIds; // String pool offset -> TagManager id
+};
+
+#endif // LIBRARYSNAPSHOT_H
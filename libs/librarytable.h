@@ -0,0 +1,77 @@
+#ifndef LIBRARYTABLE_H
+#define LIBRARYTABLE_H
+
+#include <QList>
+#include <QVector>
+#include <QString>
+#include <memory>
+#include "gamedata.h"
+
+class LibrarySnapshot;
+
+// GameManager's rows, backed by the mapped LibrarySnapshot they were loaded from.
+//
+// A loaded row stays a record in the mapping until something reads it: at() decodes it into
+// a GameItem the first time and keeps that, so startup costs the same whether a view ends
+// up showing ten games or all of them. Rows that are appended, replaced or written through
+// operator[] are plain GameItems from then on. The *At() accessors read the fields
+// GameManager indexes straight from the record, without decoding the row.
+//
+// Copies are cheap (implicitly shared, like QList) and may be read on another thread once
+// the snapshot's tags are resolved (LibrarySnapshot::resolveTags()). One table is only used
+// by one thread at a time.
+class LibraryTable {
+public:
+    class const_iterator {
+    public:
+        const_iterator(const LibraryTable *table, int row) : table(table), row(row) {}
+        const GameItem &operator*() const { return this->table->at(this->row); }
+        const GameItem *operator->() const { return &this->table->at(this->row); }
+        const_iterator &operator++() { ++this->row; return *this; }
+        bool operator==(const const_iterator &other) const { return this->row == other.row; }
+        bool operator!=(const const_iterator &other) const { return this->row != other.row; }
+
+    private:
+        const LibraryTable *table;
+        int row;
+    };
+
+    LibraryTable() = default;
+    // A row per record of snapshot, which must be open; none decoded yet
+    explicit LibraryTable(std::shared_ptr<const LibrarySnapshot> snapshot);
+
+    int size() const { return this->items.size(); }
+    int count() const { return this->items.size(); }
+    bool isEmpty() const { return this->items.isEmpty(); }
+
+    // Decodes the row on first use
+    const GameItem &at(int row) const;
+    const GameItem &operator[](int row) const { return at(row); }
+    GameItem &operator[](int row);
+
+    QString filePathAt(int row) const;
+    QString exePathAt(int row) const;
+    QString thumbnailPathAt(int row) const;
+    QList<int> tagIdsAt(int row) const;
+
+    void append(const GameItem &item);
+    // Without decoding the row it overwrites
+    void replace(int row, const GameItem &item);
+    void removeAt(int row);
+    void clear();
+    void reserve(int rows);
+
+    // Every row; rows not decoded yet are decoded into the list only, not kept, so this
+    // is safe on a copy handed to a worker thread
+    QList<GameItem> toList() const;
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+private:
+    std::shared_ptr<const LibrarySnapshot> snapshot;
+    mutable QVector<GameItem> items;
+    mutable QVector<int> records; // Snapshot record behind each row, -1 once decoded
+};
+
+#endif // LIBRARYTABLE_H
@@ -11,16 +11,23 @@
 #include <QGroupBox>
 #include <QTabWidget>
 #include <QThread>
+#include <QStatusBar>
+#include <QHash>
 
 #include <iostream>
 #include <string>
 
 #include "filelisttab.h"
 #include "gamescanner.h"
+#include "directorywalker.h"
+#include "folderwatcher.h"
 #include "gamelisttab.h"
 #include "gameinfodialog.h"
 #include "gamemanager.h"
 #include "tagmanagerdialog.h"
+#include "duplicatereportdialog.h"
+#include "thumbnailextractor.h"
+#include "thumbnailmanager.h"
 
 #define MAINBOX_STYLESHEET ".QGroupBox{border:1px solid; border-radius:4px; margin-top:10px; padding: 10px} .QGroupBox::title {subcontrol-origin: margin; subcontrol-position: top left; left: 10px; padding: 0 1px;}"
 #define MAINTAB_STYLESHEET R"(QTabWidget::pane {border: 1px solid #aaa; background-color: #ffffff; border-radius: 4px; border-top-left-radius: 0px; padding: 5px;} QTabBar::tab {background-color: #f0f0f0; border: 1px solid #aaa; border-top-left-radius: 4px; border-top-right-radius: 4px; padding: 5px 12px; margin-right: 2px;} QTabBar::tab:hover {background-color: #e8e8e8;} QTabBar::tab:selected {background-color: #ffffff; border-bottom-color: #ffffff;})"
@@ -52,15 +59,37 @@ private:
     FileListTab *fileListTab;
     GameListTab *gameListTab;
     
-    GameScanner *scanner;
+    GameScanner *scanner;        // Single-level scans when a folder is expanded
     QThread *workerThread;
+    DirectoryWalker *walker;     // Full recursive scan of the selected root
+    QSharedPointer<ScanIndex> scanIndex; // Last completed walk, baseline for the next one
+    QString shownRoot;           // Root the file tree fully reflects, empty while a walk fills it
+    FolderWatcher *folderWatcher; // Library directories and the shown root's tree
+    ThumbnailExtractor *thumbnailExtractor;
+    Fingerprinter *fingerprinter; // Outlives the duplicate report, which only shows its progress
+    ThumbnailManager *captureQueue; // Batch captures requested from the game list
+    QHash<QString, QString> captureBaseline; // Each queued game's thumbnailPath when it was queued
+    QPushButton *extractBtn;
+
+    void updateWatchedDirectories();
 
 private slots:
     void getDirPath();
-    void onGameFound(GameItem item);
     void onScanFinished();
+    void onGamesFound(const QList<GameItem> &items);
+    void onDirectoriesUnchanged(const QStringList &dirs);
+    void onWalkProgress(double dirsPerSec, double entriesPerSec, int queueDepth);
+    void onWalkFinished(qint64 dirs, qint64 entries, qint64 elapsedMs);
+    void onDirectoriesChanged(const QStringList &dirs);
+    void onPathsChecked(const QStringList &missing, const QStringList &present);
+    void onDirectoryScanned(const QString &dir, const QList<GameItem> &items, const ScanIndex::DirRecord &record);
+    void onFallbackScan();
     void showGameInfoDialog(const GameItem &item);
+    void addGamesToLibrary(const QList<GameItem> &items);
     void openTagManager();
+    void openDuplicateReport();
+    void extractThumbnails();
+    void captureThumbnails(const QList<GameItem> &games);
 };
 
 #endif
\ No newline at end of file
@@ -15,6 +15,10 @@ public:
     
     void addCheckableItem(const QString &text, const QVariant &userData);
     void clearItems();
+    // User data of every item, in order
+    QStringList itemDataList() const;
+    // Relabels the item with userData in place; check state and an open popup are kept
+    void setItemTextForData(const QString &userData, const QString &text);
 
 signals:
     void selectionChanged();
@@ -0,0 +1,69 @@
+#ifndef SCANINDEX_H
+#define SCANINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include "gamedata.h"
+
+// What the last walk of a root saw, persisted under AppData/scanindex/.
+//
+// A directory's mtime (and inode, where the platform has one) changes whenever an
+// entry directly inside it is added, removed or renamed. If both are unchanged, the
+// cached listing is still exact and the walker can skip enumerating the directory;
+// it only has to stat it and descend into the cached subdirectories. Detected game
+// folders are not descended into, so their contents are not in the index.
+class ScanIndex {
+public:
+    // An archive file's own size and mtime when its contents were read
+    struct FileStamp {
+        qint64 size = 0;
+        qint64 mtime = 0; // msecs since epoch
+    };
+
+    struct DirRecord {
+        qint64 mtime = 0;   // msecs since epoch
+        quint64 inode = 0;  // 0 where unavailable (Windows)
+        QStringList subdirs;     // Absolute paths, every subdirectory whether or not it was entered
+        QList<GameItem> items;   // Files; scanner-derived fields only (path, names, type, archive contents)
+        // The directory itself, classified by GameFolderDetector (Folder or Directory); no
+        // filePath for the root. Redone when the directory's own mtime changes, or that of
+        // one of the subdirectories the detector listed to decide (probed).
+        GameItem self;
+        QHash<QString, qint64> probed;
+        // Archive items by filePath. An archive rewritten in place (same name) leaves the
+        // directory's mtime alone, so its contents are only reused while this still matches.
+        QHash<QString, FileStamp> archives;
+    };
+
+    QString root;
+    qint64 createdAt = 0; // msecs since epoch when the walk that produced this index started
+    quint64 titleRules = 0; // TitleNormalizer::rulesHash() the items' names were made with
+    QHash<QString, DirRecord> dirs;
+
+    // The cached record for dir if its mtime/inode and those of its probed subdirectories
+    // still match, otherwise nullptr. Stats each probed subdirectory.
+    const DirRecord *reusable(const QString &dir, qint64 mtime, quint64 inode) const;
+
+    // True if path's archive contents in record can be kept: its stamp is there, matches
+    // the file (one stat) and is old enough to trust
+    bool archiveCurrent(const DirRecord &record, const QString &path) const;
+
+    // Every directory below the root and every item inside them
+    QList<GameItem> items() const;
+    // What a walk reports for dir: the directory itself (unless it is the root) and its items
+    QList<GameItem> itemsOf(const QString &dir) const;
+    int itemCount() const;
+
+    // Names made with other title rules are normalized again from originalName
+    bool load(const QString &path);
+    bool save(const QString &path) const;
+
+    // AppData/scanindex/<hash of root>.idx
+    static QString pathForRoot(const QString &root);
+    static bool statDirectory(const QString &path, qint64 &mtime, quint64 &inode);
+    static bool statFile(const QString &path, FileStamp &stamp);
+};
+
+#endif // SCANINDEX_H
@@ -0,0 +1,60 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// The producer only writes head and the consumer only writes tail, so neither side
+// ever takes a lock or allocates; a full ring tells the producer to back off.
+template <typename T>
+class SpscRing {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscRing(int capacity) {
+        size_t size = 2;
+        while (size < size_t(qMax(2, capacity))) size <<= 1;
+        this->slots.resize(size);
+        this->mask = size - 1;
+    }
+
+    // Producer side. value is only moved from if the push succeeds.
+    bool push(T &value) {
+        const size_t h = this->head.load(std::memory_order_relaxed);
+        if (h - this->tail.load(std::memory_order_acquire) > this->mask) return false;
+        this->slots[h & this->mask] = std::move(value);
+        this->head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T &value) {
+        const size_t t = this->tail.load(std::memory_order_relaxed);
+        if (t == this->head.load(std::memory_order_acquire)) return false;
+        value = std::move(this->slots[t & this->mask]);
+        this->slots[t & this->mask] = T(); // Release what the slot held now, not when it's overwritten
+        this->tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const {
+        return this->tail.load(std::memory_order_acquire) == this->head.load(std::memory_order_acquire);
+    }
+
+    // Approximate while the other side is running
+    int size() const {
+        const size_t t = this->tail.load(std::memory_order_acquire);
+        return static_cast<int>(this->head.load(std::memory_order_acquire) - t);
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask = 0;
+    // Separate cache lines so the two threads don't invalidate each other on every push/pop
+    alignas(64) std::atomic<size_t> head{0}; // Next slot to write
+    alignas(64) std::atomic<size_t> tail{0}; // Next slot to read
+};
+
+#endif // SPSCRING_H
@@ -3,11 +3,13 @@
 
 #include <QObject>
 #include <QStringList>
+#include <QHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QFile>
 #include <QStandardPaths>
 #include <QDir>
+#include "tagset.h"
 
 class TagManager : public QObject {
     Q_OBJECT
@@ -21,18 +23,35 @@ public:
     void renameTag(const QString &oldTag, const QString &newTag);
     void saveTags();
 
+    // Interned tag ids. Every name seen this session (user tags and names found on
+    // loaded games) gets a small id that stays the same until the app exits, so games
+    // can store tags as a TagSet and renames never touch the games themselves.
+    int tagId(const QString &tag);           // Interns unknown names without listing them as user tags
+    int findTagId(const QString &tag) const; // -1 if the name was never interned
+    QString tagName(int id) const;
+    QStringList tagDictionary() const;       // Names indexed by id, empty for retired ids
+
+    TagSet toTagSet(const QStringList &tags);
+    QStringList tagNames(const TagSet &set) const; // Sorted
+
 signals:
     void tagAdded(const QString &tag);
+    // Emitted before the tag's id is retired, so receivers can still resolve it
     void tagRemoved(const QString &tag);
     void tagRenamed(const QString &oldTag, const QString &newTag);
+    // A rename landed on a name that was already interned; games must move fromId -> intoId
+    void tagsMerged(int fromId, int intoId);
 
 private:
     TagManager(QObject *parent = nullptr);
     ~TagManager();
 
     void loadTags();
+    void insertSorted(const QString &tag);
 
-    QStringList tags;
+    QStringList tags; // User tags, kept sorted
+    QStringList names; // id -> name
+    QHash<QString, int> ids;
     QString savePath;
 };
 
@@ -0,0 +1,108 @@
+#ifndef TAGSET_H
+#define TAGSET_H
+
+#include <QVector>
+#include <QList>
+#include <QtGlobal>
+#include <QtAlgorithms>
+
+// A set of tag ids (see TagManager::tagId), one bit per tag.
+// Filtering a game by tags is a handful of 64-bit AND/compare operations
+// instead of string comparisons. The order ids were added in is kept on the side,
+// so a game's tags are saved back in the order they were loaded.
+class TagSet {
+public:
+    bool isEmpty() const {
+        for (quint64 word : words) {
+            if (word) return false;
+        }
+        return true;
+    }
+
+    bool contains(int id) const {
+        if (id < 0) return false;
+        int w = id / 64;
+        return w < words.size() && (words[w] & (quint64(1) << (id % 64)));
+    }
+
+    void insert(int id) {
+        if (id < 0 || contains(id)) return;
+        int w = id / 64;
+        if (w >= words.size()) words.resize(w + 1);
+        words[w] |= quint64(1) << (id % 64);
+        order.append(id);
+    }
+
+    void remove(int id) {
+        if (!contains(id)) return;
+        words[id / 64] &= ~(quint64(1) << (id % 64));
+        order.removeOne(id);
+    }
+
+    // Swaps from for into in the same position; just drops from if into is already there
+    void replace(int from, int into) {
+        if (!contains(from) || from == into) return;
+        if (into < 0 || contains(into)) {
+            remove(from);
+            return;
+        }
+        words[from / 64] &= ~(quint64(1) << (from % 64));
+        int w = into / 64;
+        if (w >= words.size()) words.resize(w + 1);
+        words[w] |= quint64(1) << (into % 64);
+        order[order.indexOf(from)] = into;
+    }
+
+    void clear() {
+        words.clear();
+        order.clear();
+    }
+
+    int count() const {
+        return order.size();
+    }
+
+    // In the order they were inserted
+    QList<int> ids() const {
+        return order;
+    }
+
+    // True if every tag in other is also in this set (all-of filter)
+    bool containsAll(const TagSet &other) const {
+        for (int w = 0; w < other.words.size(); ++w) {
+            quint64 mine = w < words.size() ? words[w] : 0;
+            if ((mine & other.words[w]) != other.words[w]) return false;
+        }
+        return true;
+    }
+
+    // True if at least one tag is in both sets (any-of filter)
+    bool intersects(const TagSet &other) const {
+        int n = qMin(words.size(), other.words.size());
+        for (int w = 0; w < n; ++w) {
+            if (words[w] & other.words[w]) return true;
+        }
+        return false;
+    }
+
+    bool operator==(const TagSet &other) const {
+        // Same tags in another order are the same set. Trailing zero words don't change it either.
+        int n = qMax(words.size(), other.words.size());
+        for (int w = 0; w < n; ++w) {
+            quint64 a = w < words.size() ? words[w] : 0;
+            quint64 b = w < other.words.size() ? other.words[w] : 0;
+            if (a != b) return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const TagSet &other) const {
+        return !(*this == other);
+    }
+
+private:
+    QVector<quint64> words;
+    QList<int> order;
+};
+
+#endif // TAGSET_H
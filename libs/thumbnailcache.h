@@ -0,0 +1,48 @@
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QString>
+#include <QSize>
+#include <QImage>
+#include <QDateTime>
+
+// Downscaled copies of thumbnails at the sizes the views draw them, so a 48px table
+// icon doesn't cost a full-size PNG decode.
+//
+// The first request for any size decodes the source once, already scaled to the largest
+// variant by QImageReader::setScaledSize, and writes every variant to
+// AppData/thumbnails/variants/<hash of the source path>_<size>.png. Each variant is given
+// the source's mtime as its own, so one stat of the variant tells whether the source was
+// replaced in place since, and the variants are then written over. Variants are never
+// upscaled: a source smaller than a variant size is stored as is.
+//
+// All functions are thread-safe. Concurrent writers of one variant produce the same
+// bytes and each write is atomic.
+class ThumbnailCache {
+public:
+    // Longest side of each variant
+    enum Size {
+        Icon = 48,      // Table rows
+        Preview = 160,
+        Card = 320      // Card view, detail and edit previews
+    };
+
+    // Smallest variant that fills target without upscaling, Card if none does
+    static Size sizeFor(const QSize &target);
+
+    // Variant of source, generated if missing; null image if source can't be read
+    static QImage load(const QString &source, Size size);
+
+    // Generates the variants of a newly saved or picked thumbnail on the global pool
+    static void ingest(const QString &source);
+    // Deletes every variant of source, e.g. once source itself is gone
+    static void discard(const QString &source);
+
+private:
+    static QString variantDir();
+    static QString keyPrefix(const QString &source);
+    static QString variantPath(const QString &prefix, Size size);
+    static QImage generate(const QString &source, const QDateTime &modified, Size wanted);
+};
+
+#endif // THUMBNAILCACHE_H
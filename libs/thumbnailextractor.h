@@ -0,0 +1,68 @@
+#ifndef THUMBNAILEXTRACTOR_H
+#define THUMBNAILEXTRACTOR_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QImage>
+#include <QIODevice>
+#include <QThreadPool>
+#include <QTimer>
+#include <QSharedPointer>
+#include "gamedata.h"
+
+struct ExtractionJob;
+
+// Thumbnails pulled out of a game's own files, without running it.
+//
+// Sources are tried in this order and the first one found wins:
+//  - for archive games, an image beside the archive with the same base name (game.zip, game.jpg)
+//  - an image named like a cover (cover, folder, title, thumbnail, banner, icon, logo, with
+//    or without a suffix such as "cover_front"). Folder games are searched in their top two
+//    levels; zip and iso games through the whole listing. Shallower images win.
+//  - the icon named by an iso's autorun.inf
+//  - the largest icon in the main executable's PE resources: the folder's exePath, or the
+//    shallowest non-installer executable inside a zip or iso
+// 7z and RAR games only get the side-car image, since ArchiveReader can't read their entries back.
+//
+// start() runs over a list of games on its own pool. Found images go into ThumbnailStore and
+// are applied to the library in batches as they come in, to games that still have no thumbnail.
+class ThumbnailExtractor : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ThumbnailExtractor(QObject *parent = nullptr);
+    ~ThumbnailExtractor();
+
+    // Games searched at the same time (default 4; mostly small reads, bound by seeks)
+    void setConcurrency(int threads);
+    bool isRunning() const;
+
+    // Finds a thumbnail for game and stores it; the stored path, empty if nothing was found.
+    // Safe to call from any thread.
+    static QString extract(const GameItem &game);
+
+    // Largest icon in a Windows executable's resources; null if it has none
+    static QImage executableIcon(QIODevice &device);
+
+public slots:
+    // Extracts for every game without a thumbnail; cancels a running job
+    void start(const QList<GameItem> &games);
+    void cancel();
+
+signals:
+    void progress(int done, int total);
+    void finished(int found, int total);
+
+private:
+    static void runGame(const QSharedPointer<ExtractionJob> &job, const GameItem &game);
+
+    void poll();
+    void applyResults(const QSharedPointer<ExtractionJob> &job);
+
+    QThreadPool pool;
+    QSharedPointer<ExtractionJob> current;
+    QTimer pollTimer;
+};
+
+#endif // THUMBNAILEXTRACTOR_H
@@ -0,0 +1,88 @@
+#ifndef THUMBNAILLOADER_H
+#define THUMBNAILLOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QImage>
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QThreadPool>
+#include "thumbnailcache.h"
+
+// Decodes thumbnail variants on a small dedicated pool, most wanted first.
+//
+// Requests wait in a priority queue (lower value first, FIFO within one value) and are
+// only handed to a worker when one is free, so anything still queued can be reordered or
+// dropped. Views report what they show through setViewport(): visible thumbnails in
+// order, then the neighbouring screens as prefetch; everything else queued for that size
+// is cancelled, which keeps fast scrolling from piling up decodes for cards long gone.
+//
+// Workers only decode to QImage, already in the format QPixmap::fromImage() takes without
+// converting, and encode its ThumbnailPreview code while the pixels are at hand; turning
+// them into pixmaps is left to the GUI thread (ImageProvider).
+//
+// GUI thread only, apart from the workers it runs itself.
+class ThumbnailLoader : public QObject {
+    Q_OBJECT
+
+public:
+    // Priorities below PREFETCH are for things on screen
+    static const int VISIBLE = 0;
+    static const int PREFETCH = 1 << 20;
+
+    struct Stats {
+        int queued = 0;            // Waiting for a worker
+        int running = 0;
+        quint64 completed = 0;
+        quint64 cancelled = 0;     // Dropped from the queue before a worker took them
+        qint64 lastDecodeMs = 0;
+        qint64 averageDecodeMs = 0;
+        qint64 maxDecodeMs = 0;
+    };
+
+    explicit ThumbnailLoader(QObject *parent = nullptr);
+    ~ThumbnailLoader();
+
+    // Decodes at the same time (default 2)
+    void setMaxWorkers(int workers);
+
+    // Queues path at priority, or moves it there if it's already queued. No-op while it's running.
+    void request(const QString &path, ThumbnailCache::Size size, int priority);
+    // visible in order at VISIBLE + i, prefetch in order at PREFETCH + i; cancels the rest of size's queue
+    void setViewport(ThumbnailCache::Size size, const QStringList &visible, const QStringList &prefetch);
+    bool isPending(const QString &path, ThumbnailCache::Size size) const;
+
+    Stats stats() const;
+
+signals:
+    // image is null if the thumbnail couldn't be read; preview is its ThumbnailPreview code
+    void loaded(const QString &path, ThumbnailCache::Size size, const QImage &image, const QByteArray &preview);
+
+private:
+    struct Request {
+        QString path;
+        ThumbnailCache::Size size;
+        quint64 order;
+    };
+
+    static QString keyFor(const QString &path, ThumbnailCache::Size size);
+    void pump();
+    void finish(const QString &key, const QString &path, ThumbnailCache::Size size, const QImage &image,
+                const QByteArray &preview, qint64 decodeMs);
+
+    QThreadPool pool;
+    int maxWorkers = 2;
+
+    QMap<quint64, QString> queue;     // (priority << 32 | sequence) -> key
+    QHash<QString, Request> queued;   // key -> its place in queue
+    QSet<QString> running;
+    quint32 sequence = 0;
+
+    Stats counters;
+    qint64 totalDecodeMs = 0;
+};
+
+#endif // THUMBNAILLOADER_H
@@ -4,35 +4,75 @@
 #include <QObject>
 #include <QProcess>
 #include <QTimer>
-#include <QPixmap>
+#include <QImage>
 #include <QString>
+#include <QList>
+#include <memory>
+#include "gamedata.h"
 
+class CaptureBackend;
+
+// Captures thumbnails by launching games and grabbing their window.
+//
+// Games are queued and run up to concurrency() at a time. The default is 1, because the
+// Windows and X11 backends grab from the screen, where windows on top of each other would
+// spoil the shots. A running capture polls its CaptureBackend: each new game window is
+// raised, and the shot is taken as soon as the window shows more than a blank frame and
+// two grabs in a row match. That is usually well before the timeout. At the timeout the
+// last painted frame is used if there is one. Either way the game and everything it
+// started are then killed.
 class ThumbnailManager : public QObject {
     Q_OBJECT
 
 public:
     explicit ThumbnailManager(QObject *parent = nullptr);
     ~ThumbnailManager();
-    
-    void startCapture(const QString &exePath, const QString &gameName, int delaySec);
 
-signals:
-    void captureFinished(const QString &imagePath);
-    void captureFailed(const QString &reason);
+    // Takes ownership; replaces the default (CaptureBackend::create()). Only between runs.
+    void setBackend(CaptureBackend *backend);
+    // Games captured at the same time
+    void setConcurrency(int games);
+    int concurrency() const;
+    bool isRunning() const;
+
+    // id comes back with the result, e.g. the game's filePath
+    void enqueue(const QString &id, const QString &exePath, int timeoutSec);
+    // Every game that has an exePath, by filePath
+    void enqueue(const QList<GameItem> &games, int timeoutSec);
+    // Drops queued games and kills the running ones
+    void cancel();
 
-private slots:
-    void onTimeout();
-    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+signals:
+    // All signals are queued, so a slot may open a dialog or call back into the queue.
+    // preview is the ThumbnailPreview code of the image
+    void captureFinished(const QString &id, const QString &imagePath, const QByteArray &preview);
+    void captureFailed(const QString &id, const QString &reason);
+    void progress(int done, int total);
+    // The queue ran empty
+    void finished();
 
 private:
-    QProcess *process;
-    QTimer *timer;
-    QString currentExePath;
-    QString currentGameName;
-    
-    void captureWindow(qint64 pid);
-    void doCapture(qint64 pid, WId windowId);
-    QString saveThumbnail(const QPixmap &pixmap);
+    struct Request {
+        QString id;
+        QString exePath;
+        int timeoutMs;
+    };
+    struct Capture;
+
+    void startNext();
+    void poll();
+    void finish(Capture *capture, const QImage &frame, const QString &error);
+    // Queued emit of captureFinished (reason empty) or captureFailed, then progress
+    void report(const QString &id, const QString &path, const QByteArray &preview, const QString &reason);
+    QString saveThumbnail(const QImage &image);
+
+    std::unique_ptr<CaptureBackend> backend;
+    QList<Request> pending;
+    QList<Capture *> running;
+    QTimer pollTimer;
+    int maxConcurrent = 1;
+    int total = 0; // Of the current run, reset once the queue is empty
+    int done = 0;
 };
 
 #endif // THUMBNAILMANAGER_H
@@ -0,0 +1,85 @@
+#ifndef THUMBNAILPACK_H
+#define THUMBNAILPACK_H
+
+#include <QString>
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QImage>
+#include "thumbnailcache.h"
+
+// Decoded thumbnails in one memory-mapped file (AppData/thumbnails/thumbnails.pack).
+//
+// Layout (native byte order, checked on open):
+//   Header  - magic, version, entry count and section offsets
+//   Pixels  - raw scanlines in QImage RGB32 / ARGB32_Premultiplied, each image 64-byte aligned
+//   Entries - fixed-size records sorted by key, found by binary search; always last
+//
+// The key is an XXH64 of the thumbnail path seeded with the variant size, so icon and card
+// bitmaps of a game sit side by side. image() wraps the mapped scanlines without copying;
+// painting a packed thumbnail therefore needs neither a PNG decode nor a file open.
+//
+// append() adds images behind everything already in the file, then a new entry table, and
+// only then points the header at that table; bytes an open mapping can see are never
+// rewritten. Replaced and dropped images and old tables stay behind as dead bytes until
+// write() builds a compacted file, which the owner swaps in after closing the old mapping.
+class ThumbnailPack {
+public:
+    ThumbnailPack();
+    ~ThumbnailPack();
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const;
+    int count() const;
+
+    // Read-only view into the mapping, null if not packed; only valid until close()
+    QImage image(quint64 key) const;
+    bool contains(quint64 key) const;
+
+    // Pixel bytes of the current entries, and file bytes nothing refers to any more
+    qint64 liveBytes() const;
+    qint64 deadBytes() const;
+
+    static quint64 keyFor(const QString &thumbnailPath, ThumbnailCache::Size size);
+
+    // Packs images plus the entries of base (may be null) that aren't in images or dropped.
+    // Entries are taken smallest first, new before old, until pixel data reaches byteBudget.
+    static bool write(const QString &path, const ThumbnailPack *base, const QHash<quint64, QImage> &images,
+                      const QSet<quint64> &dropped, qint64 byteBudget);
+    // Adds images to the pack at path, which base must have open, and drops the dropped keys
+    // from its table. No budget: the owner compacts with write() once the pack is too big.
+    static bool append(const QString &path, const ThumbnailPack *base, const QHash<quint64, QImage> &images,
+                       const QSet<quint64> &dropped);
+
+    struct Header {
+        char magic[4];
+        quint32 version;
+        quint32 byteOrder;
+        quint32 entryCount;
+        quint64 entriesOffset;
+        quint64 pixelsOffset;
+    };
+
+    struct Entry {
+        quint64 key;
+        quint64 pixelOffset; // From the start of the pixel section
+        quint32 bytesPerLine;
+        quint16 width;
+        quint16 height;
+        quint32 format;      // QImage::Format
+        quint32 reserved;
+    };
+
+private:
+    const Entry *find(quint64 key) const;
+    const Entry *entries() const;
+
+    QFile file;
+    const uchar *data = nullptr;
+    qint64 size = 0;
+    qint64 live = 0;
+    Header header;
+};
+
+#endif // THUMBNAILPACK_H
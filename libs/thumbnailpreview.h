@@ -0,0 +1,29 @@
+#ifndef THUMBNAILPREVIEW_H
+#define THUMBNAILPREVIEW_H
+
+#include <QByteArray>
+#include <QImage>
+
+// A few dozen bytes standing in for a thumbnail until the real one has loaded.
+//
+// The code is a grid of average colours, at most GRID cells on the long side and as many
+// on the short side as keep the thumbnail's aspect ratio: one byte (columns << 4 | rows)
+// followed by an RGB triple per cell, row by row. It is small enough to live in the game's
+// library record (GameItem::thumbnailPreview), so a view can paint a blurred likeness on
+// its first frame without touching the disk. Transparent pixels are averaged against the
+// placeholder grey.
+//
+// All functions are thread-safe.
+class ThumbnailPreview {
+public:
+    static const int GRID = 6;
+    static const int MAX_BYTES = 1 + GRID * GRID * 3;
+
+    // Empty if image is null
+    static QByteArray encode(const QImage &image);
+    // The grid smoothly scaled up to longSide; null if code isn't a valid preview
+    static QImage decode(const QByteArray &code, int longSide);
+    static bool isValid(const QByteArray &code);
+};
+
+#endif // THUMBNAILPREVIEW_H
@@ -0,0 +1,63 @@
+#ifndef THUMBNAILSTORE_H
+#define THUMBNAILSTORE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QImage>
+#include <QHash>
+#include <QSet>
+
+// Content-addressed home of captured, pasted and picked thumbnails.
+//
+// Files are named by the SHA-256 of their bytes (AppData/thumbnails/store/ab/abcd....png),
+// so two games with the same image share one file, names can't collide however a title
+// sanitizes, and a replaced thumbnail gets a new path instead of being overwritten.
+//
+// A stored file is referenced by every GameItem::thumbnailPath that points at it. Maintenance
+// runs in the background at startup. It first checks the files for damage (deleted when
+// found): files written since the last check are re-hashed against their name, older ones
+// only have to still read as an image (QImageReader::canRead). Then it removes files no game
+// references, oldest first, until those left take no more than the disk budget. Unreferenced
+// files younger than an hour are always kept, since an open edit dialog may be about to use
+// them, and never count against the budget. Storing an image that is already there makes
+// its file young again.
+class ThumbnailStore : public QObject {
+    Q_OBJECT
+
+public:
+    static ThumbnailStore &instance();
+
+    // Encodes image as PNG and stores it; empty on failure
+    QString store(const QImage &image);
+    // Copies an image file in as is, keeping its encoding; empty if it isn't a readable image
+    QString import(const QString &filePath);
+    bool isStored(const QString &path) const;
+
+    // Library games per stored file, from their thumbnailPath
+    QHash<QString, int> referenceCounts() const;
+
+    // Bytes of unreferenced files older than an hour that maintenance leaves in place, e.g.
+    // images just replaced by another one (default 0: all of them are removed)
+    void setDiskBudget(qint64 bytes);
+
+    // Integrity check then garbage collection on the global pool; no-op while one runs
+    void startMaintenance();
+
+signals:
+    // removed: damaged and collected files, already deleted from disk
+    void maintenanceFinished(int checked, const QStringList &damaged, const QStringList &missing,
+                             const QStringList &removed, qint64 bytesFreed);
+
+private:
+    explicit ThumbnailStore(QObject *parent = nullptr);
+
+    QString write(const QByteArray &bytes, const QString &suffix);
+    QString pathFor(const QByteArray &hash, const QString &suffix) const;
+
+    QString root;
+    qint64 diskBudget = 0;
+    bool maintaining = false;
+};
+
+#endif // THUMBNAILSTORE_H
@@ -0,0 +1,79 @@
+#ifndef TITLENORMALIZER_H
+#define TITLENORMALIZER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Turns a file or folder name into a display title and pulls out a store product code.
+//
+// "[Circle] ＲＪ123456_My Game (Full) ver1.02.zip" becomes cleanName "My Game",
+// gameCode "RJ123456", source "DLsite". Rules:
+//  - full-width ASCII is folded to half-width first
+//  - bracketed groups are dropped (circle names, tags, editions), but searched for a code
+//  - product codes (prefix + digits, e.g. RJ/VJ/BJ, d_, steam appids) are extracted and dropped
+//  - version tokens (v1.0, ver.2, version3b) are dropped; a one-letter prefix needs a
+//    dotted number (v1.0, v2.1.3), so "Doom v2" or "V8" keep theirs
+//  - underscores become spaces, runs of whitespace collapse, separators at the ends are trimmed
+//
+// The rules are compiled into per-first-character dispatch tables, so a name is handled in
+// one pass over its characters without regular expressions or intermediate strings.
+// The defaults can be replaced by AppData/title_rules.json:
+//   {"brackets": ["()", "[]"], "versionPrefixes": ["v", "ver"],
+//    "codes": [{"prefix": "RJ", "minDigits": 6, "maxDigits": 8, "source": "DLsite"},
+//              {"prefix": "steam", "separators": " _-", "minDigits": 1, "maxDigits": 10,
+//               "source": "Steam", "keepPrefix": false}]}
+//
+// normalize() is const and safe to call from any number of threads.
+class TitleNormalizer {
+public:
+    struct Result {
+        QString cleanName;
+        QString gameCode; // First code found, empty if none
+        QString source;   // Store the code belongs to
+    };
+
+    struct CodeRule {
+        QString prefix;       // Matched case-insensitively at a word start
+        QString separators;   // Optional single character allowed between prefix and digits
+        int minDigits = 6;
+        int maxDigits = 8;
+        QString source;
+        bool keepPrefix = true; // Code is prefix (upper-cased) + digits, otherwise just the digits
+    };
+
+    TitleNormalizer(); // Built-in rules
+
+    // Loaded once: title_rules.json from AppData if present and valid, else the built-in rules
+    static const TitleNormalizer &instance();
+
+    // Missing sections keep their current rules; false (and nothing changed) if unreadable
+    bool loadRules(const QString &path);
+    void setRules(const QStringList &bracketPairs, const QVector<CodeRule> &codes, const QStringList &versionPrefixes);
+
+    // isFile: strip the extension first
+    Result normalize(const QString &name, bool isFile) const;
+
+    // Changes whenever the compiled rules do; stored next to cached results (ScanIndex)
+    // so they can be redone after title_rules.json is edited
+    quint64 rulesHash() const;
+
+private:
+    void compile();
+    int matchCode(const QChar *s, int i, int end, Result &result) const;
+    int matchVersion(const QChar *s, int i, int end) const;
+
+    static const int DISPATCH_SIZE = 128;
+
+    QString openers;
+    QString closers; // Same index as the opener
+    QVector<CodeRule> codeRules;
+    QStringList versionPrefixes; // Lowercase
+
+    // Rule indices by the lowercase ASCII character a match has to start with
+    QVector<int> codesByFirst[DISPATCH_SIZE];
+    QVector<int> versionsByFirst[DISPATCH_SIZE];
+    quint64 hash = 0;
+};
+
+#endif // TITLENORMALIZER_H
@@ -0,0 +1,96 @@
+#ifndef XXHASH64_H
+#define XXHASH64_H
+
+#include <QtGlobal>
+#include <QtEndian>
+#include <cstring>
+
+// XXH64 (https://github.com/Cyan4973/xxHash), one-shot. Output matches the reference
+// implementation, so stored fingerprints stay valid across builds and platforms.
+namespace XxHash64 {
+
+static const quint64 PRIME1 = 11400714785074694791ULL;
+static const quint64 PRIME2 = 14029467366897019727ULL;
+static const quint64 PRIME3 = 1609587929392839161ULL;
+static const quint64 PRIME4 = 9650029242287828579ULL;
+static const quint64 PRIME5 = 2870177450012600261ULL;
+
+inline quint64 rotl(quint64 x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline quint64 read64(const uchar *p) {
+    return qFromLittleEndian<quint64>(p);
+}
+
+inline quint32 read32(const uchar *p) {
+    return qFromLittleEndian<quint32>(p);
+}
+
+inline quint64 round(quint64 acc, quint64 input) {
+    acc += input * PRIME2;
+    acc = rotl(acc, 31);
+    return acc * PRIME1;
+}
+
+inline quint64 mergeRound(quint64 acc, quint64 val) {
+    acc ^= round(0, val);
+    return acc * PRIME1 + PRIME4;
+}
+
+inline quint64 hash(const void *data, size_t length, quint64 seed = 0) {
+    const uchar *p = static_cast<const uchar *>(data);
+    const uchar *end = p + length;
+    quint64 h;
+
+    if (length >= 32) {
+        const uchar *limit = end - 32;
+        quint64 v1 = seed + PRIME1 + PRIME2;
+        quint64 v2 = seed + PRIME2;
+        quint64 v3 = seed;
+        quint64 v4 = seed - PRIME1;
+        do {
+            v1 = round(v1, read64(p)); p += 8;
+            v2 = round(v2, read64(p)); p += 8;
+            v3 = round(v3, read64(p)); p += 8;
+            v4 = round(v4, read64(p)); p += 8;
+        } while (p <= limit);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    } else {
+        h = seed + PRIME5;
+    }
+
+    h += quint64(length);
+
+    while (p + 8 <= end) {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= quint64(read32(p)) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= quint64(*p) * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+} // namespace XxHash64
+
+#endif // XXHASH64_H
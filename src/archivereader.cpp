@@ -0,0 +1,955 @@
+#include "archivereader.h"
+#include <QFile>
+#include <QByteArray>
+#include <QVector>
+#include <QSet>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+// Positional reads against a fixed byte budget
+class BoundedFile {
+public:
+    explicit BoundedFile(const QString &path) : file(path) {}
+
+    bool open() {
+        // Unbuffered: every read is a seek somewhere else, read-ahead would only cost bandwidth
+        return this->file.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    }
+
+    qint64 size() const {
+        return this->file.size();
+    }
+
+    qint64 remaining() const {
+        return this->budget;
+    }
+
+    // Short reads (end of file) are returned as is; false once the budget is spent
+    bool readAt(qint64 offset, qint64 length, QByteArray &out) {
+        out.clear();
+        if (offset < 0 || length <= 0) return offset >= 0;
+        if (length > this->budget) return false;
+        if (!this->file.seek(offset)) return false;
+
+        out.resize(static_cast<int>(length));
+        qint64 got = this->file.read(out.data(), length);
+        if (got < 0) return false;
+        out.resize(static_cast<int>(got));
+        this->budget -= got;
+        return true;
+    }
+
+private:
+    QFile file;
+    qint64 budget = ArchiveReader::MAX_READ_BYTES;
+};
+
+quint16 le16(const char *p) { return qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(p)); }
+quint32 le32(const char *p) { return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(p)); }
+quint64 le64(const char *p) { return qFromLittleEndian<quint64>(reinterpret_cast<const uchar *>(p)); }
+
+bool addFile(ArchiveReader::Info &info, QString name, qint64 size, qint64 offset = -1) {
+    name.replace('\\', '/');
+    while (name.startsWith('/')) name.remove(0, 1);
+    if (name.isEmpty() || name.endsWith('/')) return true;
+
+    info.files.append(name);
+    info.fileSizes.append(size);
+    info.fileOffsets.append(offset);
+    info.uncompressedSize += size;
+    if (name.endsWith(".exe", Qt::CaseInsensitive)) info.executables.append(name);
+    return info.files.size() < ArchiveReader::MAX_ENTRIES;
+}
+
+// Zip names are UTF-8 when flagged, otherwise in whatever codepage the packer used
+QString decodeName(const QByteArray &bytes, bool utf8) {
+    if (utf8) return QString::fromUtf8(bytes);
+    return QString::fromLocal8Bit(bytes);
+}
+
+// ---- Zip ----
+
+bool readZip(BoundedFile &file, ArchiveReader::Info &info) {
+    const qint64 size = file.size();
+    if (size < 22) return false;
+
+    // End of central directory: 22 bytes plus a comment of up to 64k, with the Zip64 locator before it
+    QByteArray tail;
+    const qint64 tailLength = qMin<qint64>(size, 22 + 0xFFFF + 20);
+    if (!file.readAt(size - tailLength, tailLength, tail)) return false;
+
+    int eocd = -1;
+    for (int i = tail.size() - 22; i >= 0; --i) {
+        if (le32(tail.constData() + i) == 0x06054b50) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0) return false;
+
+    const char *e = tail.constData() + eocd;
+    quint64 entries = le16(e + 10);
+    quint64 cdSize = le32(e + 12);
+    quint64 cdOffset = le32(e + 16);
+
+    if (eocd >= 20 && le32(e - 20) == 0x07064b50) {
+        QByteArray record;
+        if (file.readAt(static_cast<qint64>(le64(e - 20 + 8)), 56, record) && record.size() == 56
+            && le32(record.constData()) == 0x06064b50) {
+            entries = le64(record.constData() + 32);
+            cdSize = le64(record.constData() + 40);
+            cdOffset = le64(record.constData() + 48);
+        }
+    }
+    if (cdOffset + cdSize > quint64(size)) return false;
+
+    // A central directory larger than the budget is listed as far as the budget goes
+    QByteArray cd;
+    const qint64 wanted = static_cast<qint64>(qMin<quint64>(cdSize, quint64(file.remaining())));
+    if (!file.readAt(static_cast<qint64>(cdOffset), wanted, cd)) return false;
+    info.valid = true;
+
+    quint64 parsed = 0;
+    int pos = 0;
+    while (pos + 46 <= cd.size() && le32(cd.constData() + pos) == 0x02014b50) {
+        const char *h = cd.constData() + pos;
+        const quint16 flags = le16(h + 8);
+        quint64 compressed = le32(h + 20);
+        quint64 uncompressed = le32(h + 24);
+        const int nameLength = le16(h + 28);
+        const int extraLength = le16(h + 30);
+        const int commentLength = le16(h + 32);
+        quint64 localHeader = le32(h + 42);
+        if (pos + 46 + nameLength + extraLength + commentLength > cd.size()) break;
+
+        if (uncompressed == 0xFFFFFFFF || compressed == 0xFFFFFFFF || localHeader == 0xFFFFFFFF) {
+            // The Zip64 extra block holds, in this order, only the fields saturated above
+            for (int x = 0; x + 4 <= extraLength;) {
+                const char *field = h + 46 + nameLength + x;
+                const int fieldSize = qMin<int>(le16(field + 2), extraLength - x - 4);
+                if (le16(field) == 0x0001) {
+                    int f = 0;
+                    if (uncompressed == 0xFFFFFFFF && f + 8 <= fieldSize) { uncompressed = le64(field + 4 + f); f += 8; }
+                    if (compressed == 0xFFFFFFFF && f + 8 <= fieldSize) { compressed = le64(field + 4 + f); f += 8; }
+                    if (localHeader == 0xFFFFFFFF && f + 8 <= fieldSize) { localHeader = le64(field + 4 + f); }
+                    break;
+                }
+                x += 4 + fieldSize;
+            }
+        }
+
+        const QString name = decodeName(QByteArray(h + 46, nameLength), flags & 0x0800);
+        ++parsed;
+        pos += 46 + nameLength + extraLength + commentLength;
+        const qint64 offset = localHeader < quint64(size) ? static_cast<qint64>(localHeader) : -1;
+        if (!addFile(info, name, static_cast<qint64>(uncompressed), offset)) break;
+    }
+
+    info.complete = parsed == entries;
+    return true;
+}
+
+// ---- 7z ----
+
+// Cursor over a decoded 7z header; any overrun clears ok instead of reading past the end
+struct SevenZipStream {
+    const uchar *p;
+    const uchar *end;
+    bool ok = true;
+
+    quint8 byte() {
+        if (p >= end) { ok = false; return 0; }
+        return *p++;
+    }
+
+    quint64 number() {
+        // First byte's leading 1 bits tell how many more bytes follow
+        const quint8 first = byte();
+        quint8 mask = 0x80;
+        quint64 value = 0;
+        for (int i = 0; i < 8; ++i) {
+            if ((first & mask) == 0) {
+                value |= quint64(first & (mask - 1)) << (8 * i);
+                return value;
+            }
+            value |= quint64(byte()) << (8 * i);
+            mask >>= 1;
+        }
+        return value;
+    }
+
+    void skip(quint64 n) {
+        if (n > quint64(end - p)) { ok = false; p = end; return; }
+        p += n;
+    }
+
+    SevenZipStream take(quint64 n) {
+        SevenZipStream sub{p, p, ok};
+        if (n > quint64(end - p)) { ok = false; sub.ok = false; p = end; return sub; }
+        sub.end = p + n;
+        p += n;
+        return sub;
+    }
+
+    QVector<bool> bits(quint64 count) {
+        QVector<bool> out(static_cast<int>(qMin<quint64>(count, ArchiveReader::MAX_ENTRIES)));
+        quint8 current = 0;
+        for (quint64 i = 0; i < count && ok; ++i) {
+            if (i % 8 == 0) current = byte();
+            if (i < quint64(out.size())) out[static_cast<int>(i)] = (current & (0x80 >> (i % 8))) != 0;
+        }
+        return out;
+    }
+
+    // Returns which of count digests are present
+    QVector<bool> digests(quint64 count) {
+        const quint8 allDefined = byte();
+        QVector<bool> defined = allDefined ? QVector<bool>(static_cast<int>(qMin<quint64>(count, ArchiveReader::MAX_ENTRIES)), true) : bits(count);
+        for (bool d : defined) {
+            if (d) skip(4);
+        }
+        return defined;
+    }
+};
+
+enum SevenZipId : quint64 {
+    kEnd = 0x00, kHeader = 0x01, kArchiveProperties = 0x02, kAdditionalStreamsInfo = 0x03,
+    kMainStreamsInfo = 0x04, kFilesInfo = 0x05, kPackInfo = 0x06, kUnpackInfo = 0x07,
+    kSubStreamsInfo = 0x08, kSize = 0x09, kCRC = 0x0A, kFolder = 0x0B, kCodersUnpackSize = 0x0C,
+    kNumUnpackStream = 0x0D, kEmptyStream = 0x0E, kEmptyFile = 0x0F, kName = 0x11,
+    kEncodedHeader = 0x17
+};
+
+// Fills the unpacked size of every stream, in file order
+bool readStreamsInfo(SevenZipStream &s, QVector<quint64> &streamSizes) {
+    QVector<quint64> folderSizes;
+    QVector<bool> folderCrc;
+    QVector<quint64> streamsPerFolder;
+    bool haveSubStreams = false;
+
+    for (quint64 id = s.number(); s.ok && id != kEnd; id = s.number()) {
+        if (id == kPackInfo) {
+            s.number(); // Pack position
+            const quint64 packStreams = s.number();
+            for (quint64 t = s.number(); s.ok && t != kEnd; t = s.number()) {
+                if (t == kSize) {
+                    for (quint64 i = 0; i < packStreams && s.ok; ++i) s.number();
+                } else if (t == kCRC) {
+                    s.digests(packStreams);
+                } else {
+                    return false;
+                }
+            }
+        } else if (id == kUnpackInfo) {
+            if (s.number() != kFolder) return false;
+            const quint64 folders = s.number();
+            if (folders > quint64(ArchiveReader::MAX_ENTRIES) || s.byte() != 0) return false; // External folders aren't used by any packer
+
+            QVector<quint64> outCounts;
+            QVector<quint64> mainOut;
+            for (quint64 f = 0; f < folders && s.ok; ++f) {
+                const quint64 coders = s.number();
+                quint64 totalIn = 0, totalOut = 0;
+                for (quint64 c = 0; c < coders && s.ok; ++c) {
+                    const quint8 flags = s.byte();
+                    s.skip(flags & 0x0F); // Codec id
+                    quint64 in = 1, out = 1;
+                    if (flags & 0x10) {
+                        in = s.number();
+                        out = s.number();
+                    }
+                    totalIn += in;
+                    totalOut += out;
+                    if (flags & 0x20) s.skip(s.number()); // Codec properties
+                }
+                if (totalOut == 0 || totalOut > 64) return false;
+
+                // The folder's result is the one output stream not bound to another coder's input
+                QSet<quint64> boundOut;
+                for (quint64 b = 0; b + 1 < totalOut && s.ok; ++b) {
+                    s.number();
+                    boundOut.insert(s.number());
+                }
+                const quint64 packed = totalIn - (totalOut - 1);
+                if (packed > 1) {
+                    for (quint64 i = 0; i < packed && s.ok; ++i) s.number();
+                }
+                quint64 main = 0;
+                while (boundOut.contains(main)) ++main;
+                outCounts.append(totalOut);
+                mainOut.append(main);
+            }
+
+            if (s.number() != kCodersUnpackSize) return false;
+            for (int f = 0; f < outCounts.size() && s.ok; ++f) {
+                quint64 folderSize = 0;
+                for (quint64 o = 0; o < outCounts[f]; ++o) {
+                    const quint64 sz = s.number();
+                    if (o == mainOut[f]) folderSize = sz;
+                }
+                folderSizes.append(folderSize);
+            }
+
+            folderCrc = QVector<bool>(folderSizes.size(), false);
+            for (quint64 t = s.number(); s.ok && t != kEnd; t = s.number()) {
+                if (t != kCRC) return false;
+                folderCrc = s.digests(quint64(folderSizes.size()));
+            }
+        } else if (id == kSubStreamsInfo) {
+            haveSubStreams = true;
+            streamsPerFolder = QVector<quint64>(folderSizes.size(), 1);
+
+            quint64 t = s.number();
+            if (t == kNumUnpackStream) {
+                for (int f = 0; f < folderSizes.size() && s.ok; ++f) {
+                    streamsPerFolder[f] = s.number();
+                    if (streamsPerFolder[f] > quint64(ArchiveReader::MAX_ENTRIES)) return false;
+                }
+                t = s.number();
+            }
+
+            const bool haveSizes = (t == kSize);
+            for (int f = 0; f < folderSizes.size() && s.ok; ++f) {
+                if (streamsPerFolder[f] == 0) continue;
+                quint64 sum = 0;
+                if (haveSizes) {
+                    for (quint64 i = 1; i < streamsPerFolder[f] && s.ok; ++i) {
+                        const quint64 sz = s.number();
+                        streamSizes.append(sz);
+                        sum += sz;
+                    }
+                }
+                streamSizes.append(folderSizes[f] >= sum ? folderSizes[f] - sum : 0);
+            }
+            if (haveSizes) t = s.number();
+
+            for (; s.ok && t != kEnd; t = s.number()) {
+                if (t != kCRC) return false;
+                // Digests for every stream whose CRC isn't already the folder's
+                quint64 count = 0;
+                for (int f = 0; f < folderSizes.size(); ++f) {
+                    if (streamsPerFolder[f] != 1 || !folderCrc.value(f)) count += streamsPerFolder[f];
+                }
+                s.digests(count);
+            }
+        } else {
+            return false;
+        }
+    }
+
+    if (!haveSubStreams) {
+        for (quint64 size : folderSizes) streamSizes.append(size);
+    }
+    return s.ok;
+}
+
+bool readSevenZipFiles(SevenZipStream &s, const QVector<quint64> &streamSizes, ArchiveReader::Info &info) {
+    const quint64 count = s.number();
+    if (count > quint64(ArchiveReader::MAX_ENTRIES)) return false;
+
+    QVector<bool> emptyStream(static_cast<int>(count), false);
+    QVector<bool> emptyFile;
+    QStringList names;
+
+    for (quint64 t = s.number(); s.ok && t != kEnd; t = s.number()) {
+        SevenZipStream property = s.take(s.number());
+        if (t == kEmptyStream) {
+            emptyStream = property.bits(count);
+        } else if (t == kEmptyFile) {
+            emptyFile = property.bits(quint64(emptyStream.count(true)));
+        } else if (t == kName) {
+            if (property.byte() != 0) return false;
+            // UTF-16LE, each name terminated by a zero unit
+            QString name;
+            while (property.ok && property.end - property.p >= 2) {
+                const char16_t unit = char16_t(property.p[0] | (property.p[1] << 8));
+                property.p += 2;
+                if (unit == 0) {
+                    names.append(name);
+                    name.clear();
+                } else {
+                    name.append(QChar(unit));
+                }
+            }
+        }
+        if (!property.ok) return false;
+    }
+    if (!s.ok) return false;
+
+    int stream = 0;
+    int empty = 0;
+    for (quint64 i = 0; i < count; ++i) {
+        const QString name = names.value(static_cast<int>(i));
+        if (!emptyStream.value(static_cast<int>(i))) {
+            if (!addFile(info, name, static_cast<qint64>(streamSizes.value(stream++)))) return true;
+        } else {
+            // Empty streams are directories unless flagged as empty files
+            const bool isFile = emptyFile.value(empty++);
+            if (isFile && !addFile(info, name, 0)) return true;
+        }
+    }
+    info.complete = true;
+    return true;
+}
+
+bool readSevenZip(BoundedFile &file, ArchiveReader::Info &info) {
+    static const char signature[6] = {'7', 'z', char(0xBC), char(0xAF), 0x27, 0x1C};
+
+    QByteArray start;
+    if (!file.readAt(0, 32, start) || start.size() < 32 || std::memcmp(start.constData(), signature, 6) != 0) return false;
+
+    const quint64 nextOffset = le64(start.constData() + 12);
+    const quint64 nextSize = le64(start.constData() + 20);
+    info.valid = true;
+    if (nextSize == 0) {
+        info.complete = true; // Empty archive
+        return true;
+    }
+    if (32 + nextOffset + nextSize > quint64(file.size())) return false;
+    if (nextSize > quint64(file.remaining())) return true;
+
+    QByteArray header;
+    if (!file.readAt(static_cast<qint64>(32 + nextOffset), static_cast<qint64>(nextSize), header)) return true;
+
+    SevenZipStream s{reinterpret_cast<const uchar *>(header.constData()), reinterpret_cast<const uchar *>(header.constData()) + header.size()};
+    const quint64 kind = s.number();
+    if (kind == kEncodedHeader) {
+        // 7-Zip compresses the header itself by default; listing it would mean decompressing,
+        // so only the archive's validity is known
+        return true;
+    }
+    if (kind != kHeader) return false;
+
+    quint64 id = s.number();
+    if (id == kArchiveProperties) {
+        for (quint64 t = s.number(); s.ok && t != kEnd; t = s.number()) s.skip(s.number());
+        id = s.number();
+    }
+    if (id == kAdditionalStreamsInfo) {
+        QVector<quint64> unused;
+        if (!readStreamsInfo(s, unused)) return true;
+        id = s.number();
+    }
+
+    QVector<quint64> streamSizes;
+    if (id == kMainStreamsInfo) {
+        if (!readStreamsInfo(s, streamSizes)) return true;
+        id = s.number();
+    }
+    if (id == kFilesInfo) {
+        readSevenZipFiles(s, streamSizes, info);
+    } else if (id == kEnd) {
+        info.complete = true;
+    }
+    return true;
+}
+
+// ---- RAR ----
+
+// Block headers are small; one read usually covers the whole header including its name
+static const int RAR_HEADER_READ = 128;
+
+bool readRar4(BoundedFile &file, qint64 pos, ArchiveReader::Info &info) {
+    const qint64 size = file.size();
+    QByteArray block;
+
+    while (pos + 7 <= size) {
+        if (!file.readAt(pos, RAR_HEADER_READ, block) || block.size() < 7) return true;
+        const quint8 type = quint8(block[2]);
+        const quint16 flags = le16(block.constData() + 3);
+        const quint16 headSize = le16(block.constData() + 5);
+        if (headSize < 7) return true;
+        if (block.size() < headSize && !file.readAt(pos, headSize, block)) return true;
+        if (block.size() < headSize) return true;
+
+        quint64 dataSize = 0;
+        if (type == 0x73 && (flags & 0x0080)) {
+            return true; // Headers are encrypted; nothing to list without the password
+        } else if (type == 0x74 && headSize >= 32) {
+            const char *h = block.constData();
+            dataSize = le32(h + 7);
+            quint64 unpacked = le32(h + 11);
+            const int nameSize = le16(h + 26);
+            int nameOffset = 32;
+            if (flags & 0x0100) {
+                dataSize |= quint64(le32(h + 32)) << 32;
+                unpacked |= quint64(le32(h + 36)) << 32;
+                nameOffset = 40;
+            }
+            if (nameOffset + nameSize > headSize) return true;
+
+            QByteArray raw(h + nameOffset, nameSize);
+            QString name;
+            if (flags & 0x0200) {
+                // Unicode names: "ascii\0packed-utf16", or plain UTF-8 without the zero.
+                // The ASCII half is good enough to recognise executables.
+                const int zero = raw.indexOf('\0');
+                name = zero < 0 ? QString::fromUtf8(raw) : QString::fromLocal8Bit(raw.left(zero));
+            } else {
+                name = QString::fromLocal8Bit(raw);
+            }
+
+            const bool isDir = (flags & 0x00E0) == 0x00E0;
+            if (!isDir && !addFile(info, name, static_cast<qint64>(unpacked))) return true;
+        } else if (type == 0x7B) {
+            info.complete = true;
+            return true;
+        } else if (flags & 0x8000) {
+            dataSize = le32(block.constData() + 7);
+        }
+        pos += headSize + static_cast<qint64>(dataSize);
+    }
+    // Old archives may end without an end block
+    info.complete = pos == size;
+    return true;
+}
+
+bool readVint(const QByteArray &data, int &pos, quint64 &value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+        const quint8 b = quint8(data[pos++]);
+        value |= quint64(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+bool readRar5(BoundedFile &file, qint64 pos, ArchiveReader::Info &info) {
+    const qint64 size = file.size();
+    QByteArray block;
+
+    while (pos + 7 <= size) {
+        if (!file.readAt(pos, RAR_HEADER_READ, block) || block.size() < 7) return true;
+
+        int p = 4; // After the header CRC
+        quint64 headerSize;
+        if (!readVint(block, p, headerSize) || headerSize == 0 || headerSize > 2 * 1024 * 1024) return true;
+        const qint64 headerStart = pos + p;
+        if (p + qint64(headerSize) > block.size()) {
+            if (!file.readAt(pos, p + static_cast<qint64>(headerSize), block) || block.size() < p + qint64(headerSize)) return true;
+        }
+
+        quint64 type, flags, extraSize = 0, dataSize = 0;
+        if (!readVint(block, p, type) || !readVint(block, p, flags)) return true;
+        if ((flags & 0x01) && !readVint(block, p, extraSize)) return true;
+        if ((flags & 0x02) && !readVint(block, p, dataSize)) return true;
+
+        if (type == 2) {
+            quint64 fileFlags, unpacked, attributes, compression, hostOs, nameLength;
+            if (!readVint(block, p, fileFlags) || !readVint(block, p, unpacked) || !readVint(block, p, attributes)) return true;
+            // Lengths are compared unsigned: a crafted vint cast to qint64 would come out negative
+            if (fileFlags & 0x02) { // mtime
+                if (p + 4 > block.size()) return true;
+                p += 4;
+            }
+            if (fileFlags & 0x04) { // CRC32
+                if (p + 4 > block.size()) return true;
+                p += 4;
+            }
+            if (!readVint(block, p, compression) || !readVint(block, p, hostOs) || !readVint(block, p, nameLength)) return true;
+            if (nameLength > quint64(block.size() - p)) return true;
+
+            const QString name = QString::fromUtf8(block.constData() + p, static_cast<int>(nameLength));
+            const bool isDir = fileFlags & 0x01;
+            if (!isDir && !addFile(info, name, (fileFlags & 0x08) ? 0 : static_cast<qint64>(unpacked))) return true;
+        } else if (type == 4) {
+            return true; // Encrypted headers
+        } else if (type == 5) {
+            info.complete = true;
+            return true;
+        }
+        if (dataSize > quint64(size)) return true;
+        pos = headerStart + static_cast<qint64>(headerSize) + static_cast<qint64>(dataSize);
+    }
+    return true;
+}
+
+bool readRar(BoundedFile &file, ArchiveReader::Info &info) {
+    QByteArray signature;
+    if (!file.readAt(0, 8, signature) || signature.size() < 7 || !signature.startsWith("Rar!\x1A\x07")) return false;
+
+    info.valid = true;
+    if (signature[6] == '\x00') return readRar4(file, 7, info);
+    if (signature.size() == 8 && signature[6] == '\x01' && signature[7] == '\x00') return readRar5(file, 8, info);
+    info.valid = false;
+    return false;
+}
+
+// ---- ISO9660 ----
+
+bool readIso(BoundedFile &file, ArchiveReader::Info &info) {
+    static const qint64 SECTOR = 2048;
+
+    QByteArray primary, joliet, descriptor;
+    for (qint64 sector = 16; sector < 32; ++sector) {
+        if (!file.readAt(sector * SECTOR, SECTOR, descriptor) || descriptor.size() < SECTOR) break;
+        if (std::memcmp(descriptor.constData() + 1, "CD001", 5) != 0) break;
+
+        const quint8 type = quint8(descriptor[0]);
+        if (type == 255) break;
+        if (type == 1 && primary.isEmpty()) primary = descriptor;
+        // Joliet: a supplementary descriptor with a UCS-2 escape sequence, for names past 8.3
+        if (type == 2 && descriptor[88] == '%' && descriptor[89] == '/'
+            && (descriptor[90] == '@' || descriptor[90] == 'C' || descriptor[90] == 'E')) {
+            joliet = descriptor;
+        }
+    }
+    if (primary.isEmpty()) return false;
+    info.valid = true;
+
+    const bool useJoliet = !joliet.isEmpty();
+    auto text = [useJoliet](const char *p, int length) {
+        if (!useJoliet) return QString::fromLatin1(p, length).trimmed();
+        QString out;
+        for (int i = 0; i + 1 < length; i += 2) out.append(QChar(char16_t((quint8(p[i]) << 8) | quint8(p[i + 1]))));
+        return out.trimmed();
+    };
+
+    const QByteArray &volume = useJoliet ? joliet : primary;
+    info.volumeLabel = text(volume.constData() + 40, 32);
+
+    const qint64 blockSize = le16(volume.constData() + 128) ? le16(volume.constData() + 128) : SECTOR;
+    struct Extent {
+        quint32 block;
+        quint32 length;
+        QString prefix;
+    };
+    QVector<Extent> queue;
+    queue.append(Extent{le32(volume.constData() + 156 + 2), le32(volume.constData() + 156 + 10), QString()});
+    QSet<quint32> seen;
+
+    QByteArray data;
+    for (int next = 0; next < queue.size(); ++next) {
+        const Extent dir = queue[next];
+        if (seen.contains(dir.block)) continue;
+        seen.insert(dir.block);
+        if (!file.readAt(dir.block * blockSize, dir.length, data)) return true;
+
+        for (int pos = 0; pos < data.size();) {
+            const quint8 length = quint8(data[pos]);
+            if (length == 0) {
+                // Records never straddle a sector; the rest of this one is padding
+                pos = static_cast<int>((pos / SECTOR + 1) * SECTOR);
+                continue;
+            }
+            if (length < 34 || pos + length > data.size()) break;
+
+            const char *r = data.constData() + pos;
+            const quint32 extent = le32(r + 2);
+            const quint32 size = le32(r + 10);
+            const quint8 flags = quint8(r[25]);
+            const int nameLength = quint8(r[32]);
+            pos += length;
+
+            if (nameLength == 1 && (r[33] == 0 || r[33] == 1)) continue; // "." and ".."
+            QString name = text(r + 33, qMin(nameLength, length - 33));
+            const int version = name.indexOf(';');
+            if (version >= 0) name.truncate(version);
+            if (name.endsWith('.')) name.chop(1);
+
+            if (flags & 0x02) {
+                queue.append(Extent{extent, size, dir.prefix + name + '/'});
+            } else if (!addFile(info, dir.prefix + name, size, qint64(extent) * blockSize)) {
+                return true;
+            }
+        }
+    }
+    info.complete = true;
+    return true;
+}
+
+
+// ---- Deflate ----
+
+// Inflates a raw deflate stream (RFC 1951), as stored in zip entries. Decodes one bit at a
+// time through canonical code counts, which is slow next to zlib but more than fast enough
+// for the few small files read back out of an archive.
+class Inflater {
+public:
+    Inflater(const QByteArray &input, qint64 limit)
+        : in(reinterpret_cast<const uchar *>(input.constData())), inSize(input.size()), limit(limit) {}
+
+    // False on a damaged stream or once the output would pass limit
+    bool run(QByteArray &out) {
+        out.clear();
+        out.reserve(static_cast<int>(qMin<qint64>(this->limit, 16 * 1024 * 1024)));
+        this->out = &out;
+
+        bool last = false;
+        while (!last && this->ok) {
+            last = bits(1);
+            const int type = bits(2);
+            if (type == 0) stored();
+            else if (type == 1) fixed();
+            else if (type == 2) dynamic();
+            else this->ok = false;
+        }
+        return this->ok;
+    }
+
+private:
+    static const int MAX_BITS = 15;
+
+    struct Huffman {
+        short count[MAX_BITS + 1];
+        short symbol[288];
+    };
+
+    const uchar *in;
+    qint64 inSize;
+    qint64 inPos = 0;
+    quint32 bitBuffer = 0;
+    int bitCount = 0;
+    qint64 limit;
+    QByteArray *out = nullptr;
+    bool ok = true;
+
+    int bits(int need) {
+        quint32 value = this->bitBuffer;
+        while (this->bitCount < need) {
+            if (this->inPos == this->inSize) {
+                this->ok = false;
+                return 0;
+            }
+            value |= quint32(this->in[this->inPos++]) << this->bitCount;
+            this->bitCount += 8;
+        }
+        this->bitBuffer = value >> need;
+        this->bitCount -= need;
+        return int(value & ((1u << need) - 1));
+    }
+
+    void emitByte(char c) {
+        if (this->out->size() >= this->limit) {
+            this->ok = false;
+            return;
+        }
+        this->out->append(c);
+    }
+
+    // Returns the left-over code space: 0 complete, > 0 incomplete, < 0 over-subscribed
+    static int build(Huffman &h, const short *lengths, int n) {
+        for (int len = 0; len <= MAX_BITS; ++len) h.count[len] = 0;
+        for (int s = 0; s < n; ++s) h.count[lengths[s]]++;
+        if (h.count[0] == n) return 0;
+
+        int left = 1;
+        for (int len = 1; len <= MAX_BITS; ++len) {
+            left <<= 1;
+            left -= h.count[len];
+            if (left < 0) return left;
+        }
+
+        short offsets[MAX_BITS + 1];
+        offsets[1] = 0;
+        for (int len = 1; len < MAX_BITS; ++len) offsets[len + 1] = short(offsets[len] + h.count[len]);
+        for (int s = 0; s < n; ++s) {
+            if (lengths[s] != 0) h.symbol[offsets[lengths[s]]++] = short(s);
+        }
+        return left;
+    }
+
+    int decode(const Huffman &h) {
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len <= MAX_BITS && this->ok; ++len) {
+            code |= bits(1);
+            const int count = h.count[len];
+            if (code - count < first) return h.symbol[index + (code - first)];
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        this->ok = false;
+        return -1;
+    }
+
+    void stored() {
+        // Byte aligned: the rest of the current byte is padding
+        this->bitBuffer = 0;
+        this->bitCount = 0;
+        if (this->inPos + 4 > this->inSize) { this->ok = false; return; }
+        const quint32 length = this->in[this->inPos] | (this->in[this->inPos + 1] << 8);
+        const quint32 check = this->in[this->inPos + 2] | (this->in[this->inPos + 3] << 8);
+        this->inPos += 4;
+        if (length != (~check & 0xFFFF) || this->inPos + length > this->inSize
+            || this->out->size() + length > this->limit) {
+            this->ok = false;
+            return;
+        }
+        this->out->append(reinterpret_cast<const char *>(this->in + this->inPos), int(length));
+        this->inPos += length;
+    }
+
+    void codes(const Huffman &lengthCode, const Huffman &distanceCode) {
+        static const short lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                             35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const short lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                              3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const int distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                             257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                             8193, 12289, 16385, 24577};
+        static const short distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                                7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+        for (;;) {
+            int symbol = decode(lengthCode);
+            if (!this->ok || symbol == 256) return;
+            if (symbol < 256) {
+                emitByte(char(symbol));
+                continue;
+            }
+
+            symbol -= 257;
+            if (symbol >= 29) { this->ok = false; return; }
+            const int length = lengthBase[symbol] + bits(lengthExtra[symbol]);
+            symbol = decode(distanceCode);
+            if (!this->ok || symbol >= 30) { this->ok = false; return; }
+            const int distance = distanceBase[symbol] + bits(distanceExtra[symbol]);
+            if (!this->ok || distance > this->out->size() || this->out->size() + length > this->limit) {
+                this->ok = false;
+                return;
+            }
+
+            // Byte by byte: the copy may overlap what it is producing
+            const int from = this->out->size() - distance;
+            for (int i = 0; i < length; ++i) this->out->append(this->out->at(from + i));
+        }
+    }
+
+    void fixed() {
+        Huffman lengthCode, distanceCode;
+        short lengths[288];
+        int s = 0;
+        for (; s < 144; ++s) lengths[s] = 8;
+        for (; s < 256; ++s) lengths[s] = 9;
+        for (; s < 280; ++s) lengths[s] = 7;
+        for (; s < 288; ++s) lengths[s] = 8;
+        build(lengthCode, lengths, 288);
+        for (s = 0; s < 30; ++s) lengths[s] = 5;
+        build(distanceCode, lengths, 30);
+        codes(lengthCode, distanceCode);
+    }
+
+    void dynamic() {
+        static const short order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+        const int lengthCount = bits(5) + 257;
+        const int distanceCount = bits(5) + 1;
+        const int codeCount = bits(4) + 4;
+        if (!this->ok || lengthCount > 286 || distanceCount > 30) { this->ok = false; return; }
+
+        short lengths[286 + 30];
+        int index = 0;
+        for (; index < codeCount; ++index) lengths[order[index]] = short(bits(3));
+        for (; index < 19; ++index) lengths[order[index]] = 0;
+
+        Huffman lengthCode, distanceCode;
+        if (!this->ok || build(lengthCode, lengths, 19) != 0) { this->ok = false; return; }
+
+        // Literal/length and distance code lengths, run-length coded with the code just built
+        index = 0;
+        while (index < lengthCount + distanceCount && this->ok) {
+            int symbol = decode(lengthCode);
+            if (!this->ok) return;
+            if (symbol < 16) {
+                lengths[index++] = short(symbol);
+                continue;
+            }
+            short repeated = 0;
+            int times;
+            if (symbol == 16) {
+                if (index == 0) { this->ok = false; return; }
+                repeated = lengths[index - 1];
+                times = 3 + bits(2);
+            } else if (symbol == 17) {
+                times = 3 + bits(3);
+            } else {
+                times = 11 + bits(7);
+            }
+            if (index + times > lengthCount + distanceCount) { this->ok = false; return; }
+            while (times--) lengths[index++] = repeated;
+        }
+        if (!this->ok || lengths[256] == 0) { this->ok = false; return; }
+
+        // Incomplete codes are only allowed for a single length
+        int left = build(lengthCode, lengths, lengthCount);
+        if (left < 0 || (left > 0 && lengthCount - lengthCode.count[0] != 1)) { this->ok = false; return; }
+        left = build(distanceCode, lengths + lengthCount, distanceCount);
+        if (left < 0 || (left > 0 && distanceCount - distanceCode.count[0] != 1)) { this->ok = false; return; }
+
+        codes(lengthCode, distanceCode);
+    }
+};
+
+} // namespace
+
+ArchiveReader::Info ArchiveReader::read(const QString &path, GameType type) {
+    Info info;
+    BoundedFile file(path);
+    if (!isArchive(type) || !file.open()) return info;
+
+    bool recognised = false;
+    switch (type) {
+        case GameType::Zip: recognised = readZip(file, info); break;
+        case GameType::SevenZip: recognised = readSevenZip(file, info); break;
+        case GameType::Rar: recognised = readRar(file, info); break;
+        case GameType::Iso: recognised = readIso(file, info); break;
+        default: break;
+    }
+    if (!recognised) {
+        // Misnamed or damaged; the suffix lied, don't report half a listing
+        return Info();
+    }
+    return info;
+}
+
+bool ArchiveReader::isArchive(GameType type) {
+    return type == GameType::Zip || type == GameType::SevenZip || type == GameType::Rar || type == GameType::Iso;
+}
+
+void ArchiveReader::apply(const Info &info, GameItem &item) {
+    item.contentSize = info.uncompressedSize;
+    item.contentFiles = info.files.size();
+    item.contentExecutables = info.executables;
+    item.volumeLabel = info.volumeLabel;
+}
+
+
+QByteArray ArchiveReader::readEntry(const QString &path, GameType type, const Info &info, int index, qint64 maxBytes) {
+    const qint64 offset = info.fileOffsets.value(index, -1);
+    const qint64 size = info.fileSizes.value(index, -1);
+    if (offset < 0 || size < 0 || size > maxBytes) return QByteArray();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered) || !file.seek(offset)) return QByteArray();
+
+    if (type == GameType::Iso) {
+        // Iso files are stored whole at their extent
+        const QByteArray data = file.read(size);
+        return data.size() == size ? data : QByteArray();
+    }
+    if (type != GameType::Zip) return QByteArray();
+
+    const QByteArray local = file.read(30);
+    if (local.size() < 30 || le32(local.constData()) != 0x04034b50) return QByteArray();
+    const quint16 flags = le16(local.constData() + 6);
+    const quint16 method = le16(local.constData() + 8);
+    const qint64 dataStart = offset + 30 + le16(local.constData() + 26) + le16(local.constData() + 28);
+    if ((flags & 0x0001) || !file.seek(dataStart)) return QByteArray(); // Encrypted
+
+    if (method == 0) {
+        const QByteArray data = file.read(size);
+        return data.size() == size ? data : QByteArray();
+    }
+    if (method != 8) return QByteArray();
+
+    // The compressed size may only be in a trailing data descriptor; deflate ends by itself
+    // anyway, and no sane packer grows data by more than an eighth
+    const QByteArray compressed = file.read(qMin(file.size() - dataStart, size + size / 8 + 1024));
+    QByteArray data;
+    Inflater inflater(compressed, size);
+    if (!inflater.run(data) || data.size() != size) return QByteArray();
+    return data;
+}
@@ -0,0 +1,401 @@
+#include "capturebackend.h"
+#include <QGuiApplication>
+#include <QScreen>
+#include <QPixmap>
+#include <QPainter>
+#include <QLinearGradient>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <tlhelp32.h>
+#endif
+
+// Xlib's macros (None, Bool, Status...) clash with Qt headers, so it comes last
+#ifdef GAMEDB_HAVE_X11
+#include <QtGui/qguiapplication_platform.h>
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#endif
+
+namespace {
+
+// Screen contents under window; on Windows and X11 other windows on top show up too
+QImage grabScreenWindow(WId window) {
+    QScreen *screen = QGuiApplication::primaryScreen();
+    if (!screen) return QImage();
+    return screen->grabWindow(window).toImage();
+}
+
+// After the process starts, until the fake window opens and until it paints
+const qint64 FAKE_WINDOW_MS = 300;
+const qint64 FAKE_PAINT_MS = 1200;
+
+class FakeBackend : public CaptureBackend {
+public:
+    void attach(QProcess &process) override {
+        CaptureBackend::attach(process);
+        QElapsedTimer clock;
+        clock.start();
+        this->windows.insert(process.processId(), clock);
+    }
+
+    void killProcessTree(QProcess &process) override {
+        this->windows.remove(this->startedAs.value(&process));
+        CaptureBackend::killProcessTree(process);
+    }
+
+    WId findWindow(qint64 pid) override {
+        auto it = this->windows.constFind(pid);
+        if (it == this->windows.constEnd() || it.value().elapsed() < FAKE_WINDOW_MS) return 0;
+        return WId(pid);
+    }
+
+    void raise(WId window) override {
+        Q_UNUSED(window);
+    }
+
+    QImage grab(WId window) override {
+        auto it = this->windows.constFind(qint64(window));
+        if (it == this->windows.constEnd()) return QImage();
+
+        QImage frame(640, 360, QImage::Format_RGB32);
+        frame.fill(Qt::black);
+        if (it.value().elapsed() < FAKE_PAINT_MS) return frame;
+
+        // Distinct per game, and far from uniform so it passes as painted
+        QLinearGradient gradient(0, 0, frame.width(), frame.height());
+        gradient.setColorAt(0, QColor::fromHsv(int(window % 360), 160, 220));
+        gradient.setColorAt(1, QColor::fromHsv(int((window + 120) % 360), 200, 80));
+        QPainter painter(&frame);
+        painter.fillRect(frame.rect(), gradient);
+        return frame;
+    }
+
+    Backend backend() const override {
+        return Backend::Fake;
+    }
+
+private:
+    QHash<qint64, QElapsedTimer> windows; // pid -> time since it started
+};
+
+#ifdef Q_OS_WIN
+struct EnumData {
+    QSet<DWORD> processIds;
+    HWND best = nullptr;
+    qint64 bestArea = 0;
+};
+
+BOOL CALLBACK collectWindow(HWND hwnd, LPARAM lParam) {
+    EnumData *data = reinterpret_cast<EnumData *>(lParam);
+    DWORD processId = 0;
+    GetWindowThreadProcessId(hwnd, &processId);
+    if (!data->processIds.contains(processId)) return TRUE;
+
+    // Visible, titled and unowned: skips hidden helpers, tool windows and dialogs
+    if (!IsWindowVisible(hwnd) || GetWindowTextLengthW(hwnd) == 0 || GetWindow(hwnd, GW_OWNER)) return TRUE;
+
+    RECT rect;
+    if (!GetWindowRect(hwnd, &rect)) return TRUE;
+    const qint64 area = qint64(rect.right - rect.left) * (rect.bottom - rect.top);
+    if (area > data->bestArea) {
+        data->bestArea = area;
+        data->best = hwnd;
+    }
+    return TRUE;
+}
+
+// QProcess keeps the main thread's handle to itself, so a process created suspended is
+// resumed through its thread ids
+void resumeProcess(DWORD processId) {
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) return;
+    THREADENTRY32 entry = {};
+    entry.dwSize = sizeof(entry);
+    for (BOOL more = Thread32First(snapshot, &entry); more; more = Thread32Next(snapshot, &entry)) {
+        if (entry.th32OwnerProcessID != processId) continue;
+        HANDLE thread = OpenThread(THREAD_SUSPEND_RESUME, FALSE, entry.th32ThreadID);
+        if (!thread) continue;
+        ResumeThread(thread);
+        CloseHandle(thread);
+    }
+    CloseHandle(snapshot);
+}
+
+class WindowsBackend : public CaptureBackend {
+public:
+    ~WindowsBackend() override {
+        // Kill-on-close: whatever is still running goes with its job
+        for (HANDLE job : this->jobs) CloseHandle(job);
+    }
+
+    void prepare(QProcess &process) override {
+        CaptureBackend::prepare(process);
+        // Held until attach() has put it in its job: a launcher that ran straight away could
+        // start the game, and exit, before then, and the game would be outside the job
+        process.setCreateProcessArgumentsModifier([](QProcess::CreateProcessArguments *args) {
+            args->flags |= CREATE_SUSPENDED;
+        });
+    }
+
+    void attach(QProcess &process) override {
+        CaptureBackend::attach(process);
+        const DWORD processId = DWORD(process.processId());
+
+        HANDLE job = CreateJobObjectW(nullptr, nullptr);
+        if (job) {
+            JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+            limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+            SetInformationJobObject(job, JobObjectExtendedLimitInformation, &limits, sizeof(limits));
+
+            // Everything it starts joins the job too
+            HANDLE handle = OpenProcess(PROCESS_SET_QUOTA | PROCESS_TERMINATE, FALSE, processId);
+            if (handle && AssignProcessToJobObject(job, handle)) {
+                this->jobs.insert(&process, job);
+            } else {
+                qDebug() << "Failed to put process" << process.processId() << "in a job object";
+                CloseHandle(job);
+            }
+            if (handle) CloseHandle(handle);
+        }
+        // Runs either way; without a job, killProcessTree() falls back to taskkill /T
+        resumeProcess(processId);
+    }
+
+    void killProcessTree(QProcess &process) override {
+        const qint64 pid = this->startedAs.take(&process);
+        HANDLE job = this->jobs.take(&process);
+        if (job) {
+            TerminateJobObject(job, 1);
+            CloseHandle(job);
+        } else if (pid > 0) {
+            QProcess::startDetached("taskkill", QStringList() << "/F" << "/T" << "/PID" << QString::number(pid));
+        }
+        if (process.state() != QProcess::NotRunning) process.kill();
+    }
+
+    WId findWindow(qint64 pid) override {
+        EnumData data;
+        data.processIds.insert(DWORD(pid));
+
+        // A launcher's window usually belongs to a child it started
+        for (auto it = this->startedAs.constBegin(); it != this->startedAs.constEnd(); ++it) {
+            HANDLE job = it.value() == pid ? this->jobs.value(it.key()) : nullptr;
+            if (!job) continue;
+            QByteArray buffer(int(sizeof(JOBOBJECT_BASIC_PROCESS_ID_LIST) + 255 * sizeof(ULONG_PTR)), '\0');
+            auto *list = reinterpret_cast<JOBOBJECT_BASIC_PROCESS_ID_LIST *>(buffer.data());
+            if (QueryInformationJobObject(job, JobObjectBasicProcessIdList, list, DWORD(buffer.size()), nullptr)) {
+                for (DWORD i = 0; i < list->NumberOfProcessIdsInList; ++i) {
+                    data.processIds.insert(DWORD(list->ProcessIdList[i]));
+                }
+            }
+            break;
+        }
+
+        EnumWindows(collectWindow, reinterpret_cast<LPARAM>(&data));
+        return reinterpret_cast<WId>(data.best);
+    }
+
+    void raise(WId window) override {
+        HWND hwnd = reinterpret_cast<HWND>(window);
+        ShowWindow(hwnd, SW_RESTORE);
+        SetForegroundWindow(hwnd);
+    }
+
+    QImage grab(WId window) override {
+        if (!IsWindow(reinterpret_cast<HWND>(window))) return QImage();
+        return grabScreenWindow(window);
+    }
+
+    Backend backend() const override {
+        return Backend::Windows;
+    }
+
+private:
+    QHash<const QProcess *, HANDLE> jobs;
+};
+#endif
+
+#ifdef GAMEDB_HAVE_X11
+class X11Backend : public CaptureBackend {
+public:
+    explicit X11Backend(Display *display) : display(display) {
+        this->clientList = XInternAtom(display, "_NET_CLIENT_LIST", False);
+        this->wmPid = XInternAtom(display, "_NET_WM_PID", False);
+        this->activeWindow = XInternAtom(display, "_NET_ACTIVE_WINDOW", False);
+    }
+
+    WId findWindow(qint64 pid) override {
+        Atom type;
+        int format;
+        unsigned long count, after;
+        unsigned char *data = nullptr;
+        if (XGetWindowProperty(this->display, DefaultRootWindow(this->display), this->clientList, 0, 8192, False,
+                               XA_WINDOW, &type, &format, &count, &after, &data) != Success || !data) {
+            return 0;
+        }
+
+        // Managed top-level windows only; a game started through a script or launcher owns
+        // its window from another process of the same group
+        const Window *windows = reinterpret_cast<const Window *>(data);
+        WId best = 0;
+        qint64 bestArea = 0;
+        for (unsigned long i = 0; i < count; ++i) {
+            const qint64 owner = windowPid(windows[i]);
+            if (owner <= 0 || (owner != pid && ::getpgid(pid_t(owner)) != pid_t(pid))) continue;
+
+            XWindowAttributes attributes;
+            if (!XGetWindowAttributes(this->display, windows[i], &attributes) || attributes.map_state != IsViewable) continue;
+            const qint64 area = qint64(attributes.width) * attributes.height;
+            if (area > bestArea) {
+                bestArea = area;
+                best = WId(windows[i]);
+            }
+        }
+        XFree(data);
+        return best;
+    }
+
+    void raise(WId window) override {
+        // Asking the window manager, like a pager would, gets past focus stealing prevention
+        XEvent event = {};
+        event.xclient.type = ClientMessage;
+        event.xclient.window = Window(window);
+        event.xclient.message_type = this->activeWindow;
+        event.xclient.format = 32;
+        event.xclient.data.l[0] = 2;
+        event.xclient.data.l[1] = CurrentTime;
+        XSendEvent(this->display, DefaultRootWindow(this->display), False,
+                   SubstructureRedirectMask | SubstructureNotifyMask, &event);
+        XFlush(this->display);
+    }
+
+    QImage grab(WId window) override {
+        return grabScreenWindow(window);
+    }
+
+    Backend backend() const override {
+        return Backend::X11;
+    }
+
+private:
+    qint64 windowPid(Window window) const {
+        Atom type;
+        int format;
+        unsigned long count, after;
+        unsigned char *data = nullptr;
+        qint64 pid = 0;
+        if (XGetWindowProperty(this->display, window, this->wmPid, 0, 1, False, XA_CARDINAL,
+                               &type, &format, &count, &after, &data) == Success && data) {
+            if (count == 1 && format == 32) pid = qint64(*reinterpret_cast<const unsigned long *>(data));
+            XFree(data);
+        }
+        return pid;
+    }
+
+    Display *display;
+    Atom clientList;
+    Atom wmPid;
+    Atom activeWindow;
+};
+
+Display *x11Display() {
+    auto *x11 = qGuiApp ? qGuiApp->nativeInterface<QNativeInterface::QX11Application>() : nullptr;
+    return x11 ? x11->display() : nullptr;
+}
+#endif
+
+} // namespace
+
+void CaptureBackend::prepare(QProcess &process) {
+#ifdef Q_OS_UNIX
+    // Its own session and process group, so killProcessTree() reaches its children too
+    process.setChildProcessModifier([]() { ::setsid(); });
+#else
+    Q_UNUSED(process);
+#endif
+}
+
+void CaptureBackend::attach(QProcess &process) {
+    this->startedAs.insert(&process, process.processId());
+}
+
+void CaptureBackend::killProcessTree(QProcess &process) {
+    const qint64 pid = this->startedAs.take(&process);
+#ifdef Q_OS_UNIX
+    // The group outlives its leader, so this also works once a launcher has exited
+    if (pid > 0) ::kill(-pid_t(pid), SIGKILL);
+#else
+    Q_UNUSED(pid);
+#endif
+    if (process.state() != QProcess::NotRunning) process.kill();
+}
+
+CaptureBackend *CaptureBackend::create() {
+    return create(defaultBackend());
+}
+
+CaptureBackend *CaptureBackend::create(Backend backend) {
+    if (!isAvailable(backend)) return nullptr;
+    switch (backend) {
+#ifdef Q_OS_WIN
+        case Backend::Windows: return new WindowsBackend();
+#endif
+#ifdef GAMEDB_HAVE_X11
+        case Backend::X11: return new X11Backend(x11Display());
+#endif
+        case Backend::Fake: return new FakeBackend();
+        default: return nullptr;
+    }
+}
+
+CaptureBackend::Backend CaptureBackend::defaultBackend() {
+    const QByteArray requested = qgetenv("GAMEDB_CAPTURE_BACKEND").toLower();
+    if (requested == "windows") return Backend::Windows;
+    if (requested == "x11") return Backend::X11;
+    if (requested == "fake") return Backend::Fake;
+
+    if (QGuiApplication::platformName() == "offscreen") return Backend::Fake;
+#ifdef Q_OS_WIN
+    return Backend::Windows;
+#else
+    return Backend::X11;
+#endif
+}
+
+bool CaptureBackend::isAvailable(Backend backend) {
+    switch (backend) {
+        case Backend::Windows:
+#ifdef Q_OS_WIN
+            return true;
+#else
+            return false;
+#endif
+        case Backend::X11:
+#ifdef GAMEDB_HAVE_X11
+            return x11Display() != nullptr;
+#else
+            return false;
+#endif
+        case Backend::Fake:
+            return true;
+    }
+    return false;
+}
+
+const char *CaptureBackend::backendName(Backend backend) {
+    switch (backend) {
+        case Backend::Windows: return "windows";
+        case Backend::X11: return "x11";
+        case Backend::Fake: return "fake";
+    }
+    return "unknown";
+}
@@ -0,0 +1,174 @@
+#include "directoryenumerator.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QFile>
+#include <QDebug>
+#include <atomic>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#include <cstring>
+#include <vector>
+#endif
+
+namespace {
+
+class QDirEnumerator : public DirectoryEnumerator {
+public:
+    bool list(const QString &path, QVector<Entry> &entries) override {
+        entries.clear();
+        QDir dir(path);
+        if (!dir.exists()) return false;
+
+        const QFileInfoList list = dir.entryInfoList(QDir::NoDotAndDotDot | QDir::Files | QDir::Dirs | QDir::NoSymLinks);
+        entries.reserve(list.size());
+        for (const QFileInfo &info : list) {
+            entries.append(Entry{info.fileName(), info.isDir()});
+        }
+        return true;
+    }
+
+    Backend backend() const override {
+        return Backend::QDir;
+    }
+};
+
+#ifdef Q_OS_LINUX
+// Layout the kernel writes for getdents64; glibc only exposes it from 2.30 on
+struct LinuxDirent64 {
+    quint64 d_ino;
+    qint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+class GetdentsEnumerator : public DirectoryEnumerator {
+public:
+    GetdentsEnumerator() : buffer(64 * 1024) {}
+
+    bool list(const QString &path, QVector<Entry> &entries) override {
+        entries.clear();
+
+        int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) return false;
+
+        for (;;) {
+            long bytes = ::syscall(SYS_getdents64, fd, this->buffer.data(), this->buffer.size());
+            if (bytes == 0) break;
+            if (bytes < 0) {
+                // A partial listing would look like deleted entries to the caller
+                ::close(fd);
+                entries.clear();
+                return false;
+            }
+
+            for (long offset = 0; offset < bytes;) {
+                const LinuxDirent64 *d = reinterpret_cast<const LinuxDirent64 *>(this->buffer.data() + offset);
+                offset += d->d_reclen;
+
+                // Hidden entries (and "." / "..") are skipped, like QDir without QDir::Hidden
+                if (d->d_name[0] == '.') continue;
+
+                unsigned char type = d->d_type;
+                if (type == DT_UNKNOWN) {
+                    // Some filesystems (older XFS, some network mounts) don't fill d_type
+                    type = typeOf(fd, d->d_name);
+                }
+                if (type != DT_DIR && type != DT_REG) continue; // Symlinks, sockets, devices
+
+                entries.append(Entry{QFile::decodeName(d->d_name), type == DT_DIR});
+            }
+        }
+
+        ::close(fd);
+        return true;
+    }
+
+    Backend backend() const override {
+        return Backend::Getdents;
+    }
+
+private:
+    static unsigned char typeOf(int dirFd, const char *name) {
+#if defined(STATX_TYPE)
+        struct statx stx;
+        if (::statx(dirFd, name, AT_SYMLINK_NOFOLLOW, STATX_TYPE, &stx) != 0) return DT_UNKNOWN;
+        mode_t mode = stx.stx_mode;
+#else
+        struct stat st;
+        if (::fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) return DT_UNKNOWN;
+        mode_t mode = st.st_mode;
+#endif
+        if (S_ISDIR(mode)) return DT_DIR;
+        if (S_ISREG(mode)) return DT_REG;
+        return DT_UNKNOWN;
+    }
+
+    std::vector<char> buffer; // Reused for every directory this enumerator lists
+};
+#endif
+
+DirectoryEnumerator::Backend initialBackend() {
+    const QByteArray requested = qgetenv("GAMEDB_SCAN_BACKEND").toLower();
+    if (requested == "qdir") return DirectoryEnumerator::Backend::QDir;
+    if (requested == "getdents") {
+        if (DirectoryEnumerator::isAvailable(DirectoryEnumerator::Backend::Getdents)) {
+            return DirectoryEnumerator::Backend::Getdents;
+        }
+        qDebug() << "getdents scan backend is only available on Linux, using QDir";
+        return DirectoryEnumerator::Backend::QDir;
+    }
+#ifdef Q_OS_LINUX
+    return DirectoryEnumerator::Backend::Getdents;
+#else
+    return DirectoryEnumerator::Backend::QDir;
+#endif
+}
+
+std::atomic<int> selectedBackend{static_cast<int>(initialBackend())};
+
+} // namespace
+
+DirectoryEnumerator *DirectoryEnumerator::create() {
+    return create(defaultBackend());
+}
+
+DirectoryEnumerator *DirectoryEnumerator::create(Backend backend) {
+#ifdef Q_OS_LINUX
+    if (backend == Backend::Getdents) return new GetdentsEnumerator();
+#else
+    Q_UNUSED(backend);
+#endif
+    return new QDirEnumerator();
+}
+
+DirectoryEnumerator::Backend DirectoryEnumerator::defaultBackend() {
+    return static_cast<Backend>(selectedBackend.load());
+}
+
+void DirectoryEnumerator::setDefaultBackend(Backend backend) {
+    if (!isAvailable(backend)) return;
+    selectedBackend = static_cast<int>(backend);
+}
+
+bool DirectoryEnumerator::isAvailable(Backend backend) {
+#ifdef Q_OS_LINUX
+    Q_UNUSED(backend);
+    return true;
+#else
+    return backend == Backend::QDir;
+#endif
+}
+
+const char *DirectoryEnumerator::backendName(Backend backend) {
+    switch (backend) {
+        case Backend::Getdents: return "getdents";
+        case Backend::QDir: return "qdir";
+    }
+    return "unknown";
+}
@@ -0,0 +1,468 @@
+#include "directorywalker.h"
+#include "gamescanner.h"
+#include "spscring.h"
+#include "directoryenumerator.h"
+#include "archivereader.h"
+#include "titlenormalizer.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QThread>
+#include <QDateTime>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+static const int RESULT_RING_CAPACITY = 4096; // Per worker
+
+// A game candidate, or a directory the baseline still describes
+struct WalkResult {
+    GameItem item;
+    QString unchangedDir; // Set instead of item
+};
+
+struct WalkTask {
+    QString path;
+    int depth = 0; // Root is 0, its subdirectories 1, ...
+};
+
+// A worker's own tasks. The owner works at the back, thieves take from the front.
+// Its results go into a ring that only this worker writes and only the GUI thread reads.
+struct WalkQueue {
+    QMutex mutex;
+    std::deque<WalkTask> tasks;
+    SpscRing<WalkResult> results{RESULT_RING_CAPACITY};
+    QHash<QString, ScanIndex::DirRecord> records; // Directories this worker walked, for the new index
+};
+
+struct WalkState {
+    QString root;
+    int maxDepth = 0;
+    bool reportAll = true;
+    DirectoryEnumerator::Backend backend = DirectoryEnumerator::Backend::QDir;
+    GameFolderDetector detector;
+    QSharedPointer<const ScanIndex> baseline; // Read-only while the walk runs
+    qint64 startedAt = 0;
+    std::vector<std::unique_ptr<WalkQueue>> queues;
+
+    // Written by the worker that finishes the walk, read by the GUI once completed is set
+    QSharedPointer<ScanIndex> index;
+    QStringList removed;
+    QList<GameItem> changed;
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> completed{false}; // Every directory is walked; results may still be in the rings
+    std::atomic<int> pending{0}; // Tasks queued or being walked; 0 means the walk is done
+    std::atomic<qint64> dirs{0};
+    std::atomic<qint64> entries{0};
+    QElapsedTimer clock;
+
+    // Idle workers park here instead of spinning on empty queues
+    QMutex idleMutex;
+    QWaitCondition idle;
+    // Workers whose ring is full park here until the GUI has drained some of it
+    QMutex ringMutex;
+    QWaitCondition ringSpace;
+
+    void wakeProducers() {
+        // Under the lock, so a worker between its failed push and its wait can't miss it
+        QMutexLocker lock(&ringMutex);
+        ringSpace.wakeAll();
+    }
+
+    void push(int worker, const WalkTask &task) {
+        ++pending;
+        {
+            QMutexLocker lock(&queues[worker]->mutex);
+            queues[worker]->tasks.push_back(task);
+        }
+        idle.wakeOne();
+    }
+
+    bool popLocal(int worker, WalkTask &task) {
+        QMutexLocker lock(&queues[worker]->mutex);
+        if (queues[worker]->tasks.empty()) return false;
+        task = std::move(queues[worker]->tasks.back());
+        queues[worker]->tasks.pop_back();
+        return true;
+    }
+
+    bool steal(int thief, WalkTask &task) {
+        const int count = static_cast<int>(queues.size());
+        for (int i = 1; i < count; ++i) {
+            WalkQueue &victim = *queues[(thief + i) % count];
+            QMutexLocker lock(&victim.mutex);
+            if (victim.tasks.empty()) continue;
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    int queueDepth() {
+        int depth = 0;
+        for (auto &queue : queues) {
+            QMutexLocker lock(&queue->mutex);
+            depth += static_cast<int>(queue->tasks.size());
+        }
+        return depth;
+    }
+};
+
+// Reads item's archive contents and keeps the file's stamp with the record
+static void readArchive(GameItem &item, ScanIndex::DirRecord &record) {
+    ScanIndex::FileStamp stamp;
+    if (GameScanner::readArchive(item, stamp)) record.archives.insert(item.filePath, stamp);
+    else record.archives.remove(item.filePath);
+}
+
+DirectoryWalker::DirectoryWalker(QObject *parent) : QObject(parent) {
+    this->threads = qMax(2, QThread::idealThreadCount());
+    this->pool.setMaxThreadCount(this->threads);
+
+    this->drainTimer.setInterval(DRAIN_INTERVAL_MS);
+    connect(&this->drainTimer, &QTimer::timeout, this, &DirectoryWalker::drain);
+
+    this->progressTimer.setInterval(500);
+    connect(&this->progressTimer, &QTimer::timeout, this, &DirectoryWalker::sampleProgress);
+}
+
+DirectoryWalker::~DirectoryWalker() {
+    cancel();
+    this->pool.waitForDone();
+}
+
+void DirectoryWalker::setMaxDepth(int depth) {
+    this->depthLimit = qMax(0, depth);
+}
+
+int DirectoryWalker::maxDepth() const {
+    return this->depthLimit;
+}
+
+void DirectoryWalker::setDetector(const GameFolderDetector &detector) {
+    this->folderDetector = detector;
+}
+
+GameFolderDetector DirectoryWalker::detector() const {
+    return this->folderDetector;
+}
+
+void DirectoryWalker::setConcurrency(int threads) {
+    // Takes effect for the next walk; a running one keeps its worker count
+    this->threads = qMax(1, threads);
+}
+
+int DirectoryWalker::concurrency() const {
+    return this->threads;
+}
+
+bool DirectoryWalker::isRunning() const {
+    return this->current && this->drainTimer.isActive();
+}
+
+QSharedPointer<ScanIndex> DirectoryWalker::lastIndex() const {
+    return this->finishedIndex;
+}
+
+void DirectoryWalker::start(const QString &root, QSharedPointer<const ScanIndex> baseline, bool reportAll) {
+    cancel();
+
+    QSharedPointer<WalkState> state(new WalkState);
+    state->root = QDir::cleanPath(root);
+    state->maxDepth = this->depthLimit;
+    state->reportAll = reportAll || !baseline;
+    state->baseline = baseline;
+    state->backend = DirectoryEnumerator::defaultBackend();
+    state->detector = this->folderDetector;
+    state->startedAt = QDateTime::currentMSecsSinceEpoch();
+    for (int i = 0; i < this->threads; ++i) {
+        state->queues.emplace_back(new WalkQueue);
+    }
+    state->clock.start();
+    state->push(0, WalkTask{state->root, 0});
+    this->current = state;
+
+    // Workers of a cancelled walk may still be finishing a directory; give the new walk
+    // its own threads rather than queueing behind them. drain() takes the room back.
+    this->pool.setMaxThreadCount(this->threads + this->pool.activeThreadCount());
+    for (int i = 0; i < this->threads; ++i) {
+        this->pool.start([state, i]() { runWorker(state, i); });
+    }
+
+    this->lastDirs = 0;
+    this->lastEntries = 0;
+    this->sampleClock.start();
+    this->progressTimer.start();
+    this->drainTimer.start();
+}
+
+void DirectoryWalker::cancel() {
+    if (!this->current) return;
+
+    this->current->cancelled = true;
+    this->current->idle.wakeAll();
+    this->current->wakeProducers();
+    this->current.reset();
+    this->drainTimer.stop();
+    this->progressTimer.stop();
+}
+
+void DirectoryWalker::runWorker(QSharedPointer<WalkState> state, int worker) {
+    // One per worker: the enumerator's read buffer and the listing are reused for every directory
+    std::unique_ptr<DirectoryEnumerator> enumerator(DirectoryEnumerator::create(state->backend));
+    QVector<DirectoryEnumerator::Entry> listing;
+
+    WalkTask task;
+    while (!state->cancelled) {
+        if (state->popLocal(worker, task) || state->steal(worker, task)) {
+            walkDirectory(state, worker, *enumerator, listing, task.path, task.depth);
+
+            if (--state->pending == 0) {
+                finishWalk(state, worker);
+                // The drain timer reports completion once the rings are empty
+                state->completed = true;
+                state->idle.wakeAll();
+                break;
+            }
+            continue;
+        }
+
+        if (state->pending == 0) break;
+
+        // Someone else is still enumerating and may push more work; the timeout covers missed wakeups
+        QMutexLocker lock(&state->idleMutex);
+        if (state->pending == 0 || state->cancelled) break;
+        state->idle.wait(&state->idleMutex, 20);
+    }
+}
+
+void DirectoryWalker::walkDirectory(const QSharedPointer<WalkState> &state, int worker, DirectoryEnumerator &enumerator,
+                                    QVector<DirectoryEnumerator::Entry> &listing, const QString &path, int depth) {
+    WalkQueue &queue = *state->queues[worker];
+    ++state->dirs;
+
+    qint64 mtime = 0;
+    quint64 inode = 0;
+    if (!ScanIndex::statDirectory(path, mtime, inode)) {
+        return; // Vanished since its parent was listed
+    }
+
+    ScanIndex::DirRecord record;
+    const ScanIndex::DirRecord *cached = state->baseline ? state->baseline->reusable(path, mtime, inode) : nullptr;
+    bool archivesReread = false;
+    if (cached) {
+        // Nothing was added, removed or renamed directly in here since the last walk
+        record = *cached;
+
+        // ...but an archive may have been rewritten under the same name
+        for (GameItem &item : record.items) {
+            if (!ArchiveReader::isArchive(item.type) || state->baseline->archiveCurrent(*cached, item.filePath)) continue;
+            readArchive(item, record);
+            archivesReread = true;
+        }
+    } else {
+        if (!enumerator.list(path, listing)) {
+            return; // Unreadable or vanished
+        }
+        state->entries += listing.size();
+
+        const QString prefix = path.endsWith('/') ? path : path + '/';
+        record.mtime = mtime;
+        record.inode = inode;
+        for (const DirectoryEnumerator::Entry &entry : listing) {
+            if (state->cancelled) return;
+
+            if (entry.isDir) {
+                // Reported by its own walk, once it knows whether it is a game
+                record.subdirs.append(prefix + entry.name);
+                continue;
+            }
+            GameItem item;
+            if (GameScanner::itemForEntry(prefix, entry, item)) {
+                // Archives are read here, on the workers, and kept with the record like the listing
+                if (ArchiveReader::isArchive(item.type)) readArchive(item, record);
+                record.items.append(item);
+            }
+        }
+
+        record.self.type = GameType::Directory;
+        if (depth > 0) {
+            const int slash = path.lastIndexOf('/');
+            GameScanner::itemForEntry(path.left(slash + 1), DirectoryEnumerator::Entry{path.mid(slash + 1), true}, record.self);
+            const GameFolderDetector::Detection found = state->detector.detect(path, listing, enumerator);
+            GameScanner::classifyFolder(found, record.self);
+            record.probed = found.probed;
+        }
+    }
+
+    if (state->reportAll) {
+        if (cached && !archivesReread) {
+            // The receiver has the baseline; one marker instead of every entry again
+            WalkResult marker;
+            marker.unchangedDir = path;
+            if (!pushResult(state, queue, marker)) return;
+        } else {
+            if (depth > 0) {
+                WalkResult result{record.self, QString()};
+                if (!pushResult(state, queue, result)) return;
+            }
+            for (const GameItem &item : record.items) {
+                WalkResult result{item, QString()};
+                if (!pushResult(state, queue, result)) return;
+            }
+        }
+    }
+
+    // A game folder's insides are the game's business; don't walk through them
+    if (depth <= state->maxDepth && record.self.type != GameType::Folder) {
+        for (const QString &subdir : record.subdirs) {
+            state->push(worker, WalkTask{subdir, depth + 1});
+        }
+    }
+    queue.records.insert(path, record);
+}
+
+bool DirectoryWalker::pushResult(const QSharedPointer<WalkState> &state, WalkQueue &queue, WalkResult &result) {
+    if (queue.results.push(result)) return true;
+
+    // Ring full: the GUI is behind, so wait for it instead of buffering without bound.
+    // drain() wakes us after every pass that freed slots, cancel() when the walk is dropped.
+    QMutexLocker lock(&state->ringMutex);
+    while (!queue.results.push(result)) {
+        if (state->cancelled) return false;
+        state->ringSpace.wait(&state->ringMutex);
+    }
+    return true;
+}
+
+void DirectoryWalker::finishWalk(const QSharedPointer<WalkState> &state, int worker) {
+    // Runs on the last busy worker, so merging and diffing 100k entries stays off the GUI thread
+    QSharedPointer<ScanIndex> index(new ScanIndex);
+    index->root = state->root;
+    index->createdAt = state->startedAt;
+    index->titleRules = TitleNormalizer::instance().rulesHash();
+    for (auto &queue : state->queues) {
+        for (auto it = queue->records.constBegin(); it != queue->records.constEnd(); ++it) {
+            index->dirs.insert(it.key(), it.value());
+        }
+        queue->records.clear();
+    }
+    state->index = index;
+
+    if (state->reportAll) return;
+
+    // Refresh of a root that is already displayed: only report what differs from the baseline
+    QHash<QString, GameItem> before;
+    QHash<QString, ScanIndex::FileStamp> beforeStamps;
+    const QList<GameItem> baselineItems = state->baseline->items();
+    before.reserve(baselineItems.size());
+    for (const GameItem &item : baselineItems) before.insert(item.filePath, item);
+    for (auto it = state->baseline->dirs.constBegin(); it != state->baseline->dirs.constEnd(); ++it) {
+        beforeStamps.insert(it.value().archives);
+    }
+    QHash<QString, ScanIndex::FileStamp> stamps;
+    for (auto it = index->dirs.constBegin(); it != index->dirs.constEnd(); ++it) {
+        stamps.insert(it.value().archives);
+    }
+
+    WalkQueue &queue = *state->queues[worker];
+    const QList<GameItem> items = index->items();
+    for (const GameItem &item : items) {
+        auto old = before.find(item.filePath);
+        if (old == before.end()) {
+            WalkResult result{item, QString()};
+            if (!pushResult(state, queue, result)) return;
+            continue;
+        }
+        if (old.value().type != item.type || old.value().cleanName != item.cleanName
+            || old.value().originalName != item.originalName || old.value().exePath != item.exePath
+            || old.value().contentSize != item.contentSize || old.value().contentFiles != item.contentFiles) {
+            state->changed.append(item);
+        } else if (ArchiveReader::isArchive(item.type)) {
+            // Rewritten in place with the same totals: the file list must still drop what it had
+            const ScanIndex::FileStamp was = beforeStamps.value(item.filePath);
+            const ScanIndex::FileStamp now = stamps.value(item.filePath);
+            if (was.size != now.size || was.mtime != now.mtime) state->changed.append(item);
+        }
+        before.erase(old);
+    }
+    state->removed = before.keys();
+}
+
+void DirectoryWalker::drain() {
+    if (!this->current) return;
+    QSharedPointer<WalkState> state = this->current; // A receiver may start a new walk
+
+    // Once the stragglers of cancelled walks are gone, the pool shrinks back to this walk's workers
+    const int workers = static_cast<int>(state->queues.size());
+    if (this->pool.maxThreadCount() > workers && this->pool.activeThreadCount() <= workers) {
+        this->pool.setMaxThreadCount(workers);
+    }
+
+    QElapsedTimer budget;
+    budget.start();
+
+    // Read before draining: every push happens before completed is set, so if it is
+    // already set and the rings then drain empty, nothing can still be on its way
+    const bool done = state->completed;
+
+    // Round-robin over the workers' rings, one chunk at a time, until the budget is spent
+    bool empty = false;
+    while (!empty && budget.elapsed() < DRAIN_BUDGET_MS) {
+        QList<GameItem> chunk;
+        chunk.reserve(DRAIN_CHUNK);
+        QStringList unchanged;
+        WalkResult result;
+        empty = true;
+        const int quota = qMax(1, DRAIN_CHUNK / int(state->queues.size()));
+        for (auto &queue : state->queues) {
+            for (int taken = 0; taken < quota && queue->results.pop(result); ++taken) {
+                if (result.unchangedDir.isEmpty()) chunk.append(std::move(result.item));
+                else unchanged.append(result.unchangedDir);
+            }
+            if (!queue->results.isEmpty()) empty = false;
+        }
+
+        if (!chunk.isEmpty() || !unchanged.isEmpty()) {
+            // Before the receivers run, so blocked workers refill while the GUI is busy
+            state->wakeProducers();
+            if (!unchanged.isEmpty()) emit directoriesUnchanged(unchanged);
+            if (state != this->current) return;
+            if (!chunk.isEmpty()) emit gamesFound(chunk);
+        }
+        if (state != this->current) return;
+    }
+
+    if (empty && done) complete(state);
+}
+
+void DirectoryWalker::complete(const QSharedPointer<WalkState> &state) {
+    if (state != this->current) return;
+
+    this->drainTimer.stop();
+    this->progressTimer.stop();
+    this->finishedIndex = state->index;
+    this->pool.setMaxThreadCount(static_cast<int>(state->queues.size()));
+
+    if (!state->removed.isEmpty()) emit gamesRemoved(state->removed);
+    if (!state->changed.isEmpty()) emit gamesChanged(state->changed);
+
+    emit finished(state->dirs, state->entries, state->clock.elapsed());
+}
+
+void DirectoryWalker::sampleProgress() {
+    if (!this->current) return;
+
+    qint64 dirs = this->current->dirs;
+    qint64 entries = this->current->entries;
+    double seconds = qMax<qint64>(1, this->sampleClock.restart()) / 1000.0;
+
+    emit progress((dirs - this->lastDirs) / seconds, (entries - this->lastEntries) / seconds, this->current->queueDepth());
+    this->lastDirs = dirs;
+    this->lastEntries = entries;
+}
@@ -0,0 +1,136 @@
+#include "duplicatereportdialog.h"
+#include "gamemanager.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QFileInfo>
+#include <QDesktopServices>
+#include <QUrl>
+#include <QLocale>
+#include <QMap>
+
+DuplicateReportDialog::DuplicateReportDialog(Fingerprinter *fingerprinter, QWidget *parent)
+    : QDialog(parent), fingerprinter(fingerprinter) {
+    setWindowTitle(tr("Duplicate Games"));
+    resize(800, 500);
+    setupUI();
+
+    connect(this->fingerprinter, &Fingerprinter::progress, this, &DuplicateReportDialog::onProgress);
+    connect(this->fingerprinter, &Fingerprinter::finished, this, &DuplicateReportDialog::refreshGroups);
+
+    if (this->fingerprinter->isRunning()) {
+        // Picks up the run an earlier dialog started; progress arrives with the next poll
+        this->rescanButton->setEnabled(false);
+        refreshGroups();
+    } else {
+        rescan();
+    }
+}
+
+void DuplicateReportDialog::setupUI() {
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    QHBoxLayout *statusLayout = new QHBoxLayout();
+    this->statusLabel = new QLabel();
+    this->progressBar = new QProgressBar();
+    statusLayout->addWidget(this->statusLabel, 1);
+    statusLayout->addWidget(this->progressBar, 1);
+    mainLayout->addLayout(statusLayout);
+
+    this->groupTree = new QTreeWidget();
+    this->groupTree->setColumnCount(3);
+    this->groupTree->setHeaderLabels(QStringList() << tr("Game Name") << tr("Size") << tr("Path"));
+    this->groupTree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    connect(this->groupTree, &QTreeWidget::itemDoubleClicked, this, &DuplicateReportDialog::openLocation);
+    mainLayout->addWidget(this->groupTree);
+
+    QHBoxLayout *btnLayout = new QHBoxLayout();
+    this->rescanButton = new QPushButton(tr("Rescan"));
+    this->closeButton = new QPushButton(tr("Close"));
+    connect(this->rescanButton, &QPushButton::clicked, this, &DuplicateReportDialog::rescan);
+    connect(this->closeButton, &QPushButton::clicked, this, &QDialog::accept);
+    btnLayout->addStretch();
+    btnLayout->addWidget(this->rescanButton);
+    btnLayout->addWidget(this->closeButton);
+    mainLayout->addLayout(btnLayout);
+}
+
+void DuplicateReportDialog::rescan() {
+    this->rescanButton->setEnabled(false);
+    this->fingerprinter->start(GameManager::instance().getGames().toList());
+    refreshGroups();
+}
+
+void DuplicateReportDialog::onProgress(int done, int total) {
+    this->progressBar->setRange(0, qMax(1, total));
+    this->progressBar->setValue(done);
+    this->statusLabel->setText(tr("Fingerprinting %1 / %2").arg(done).arg(total));
+}
+
+void DuplicateReportDialog::refreshGroups() {
+    const LibraryTable &games = GameManager::instance().getGames();
+
+    // Ordered maps keep the groups in a stable order between refreshes
+    QMap<quint64, QList<int>> byFingerprint;
+    QMap<QString, QList<int>> byCode;
+    for (int row = 0; row < games.size(); ++row) {
+        quint64 fingerprint = this->fingerprinter->fingerprint(games[row].filePath);
+        if (fingerprint != 0) byFingerprint[fingerprint].append(row);
+        QString code = games[row].gameCode.trimmed().toUpper();
+        if (!code.isEmpty()) byCode[code].append(row);
+    }
+
+    this->groupTree->clear();
+    int groups = 0;
+
+    QTreeWidgetItem *contentSection = new QTreeWidgetItem(this->groupTree, QStringList() << tr("Same content"));
+    for (auto it = byFingerprint.constBegin(); it != byFingerprint.constEnd(); ++it) {
+        if (it.value().size() < 2) continue;
+        addGroup(contentSection, games[it.value().first()].cleanName, it.value());
+        ++groups;
+    }
+
+    QTreeWidgetItem *codeSection = new QTreeWidgetItem(this->groupTree, QStringList() << tr("Same game code"));
+    for (auto it = byCode.constBegin(); it != byCode.constEnd(); ++it) {
+        if (it.value().size() < 2) continue;
+        addGroup(codeSection, it.key(), it.value());
+        ++groups;
+    }
+
+    contentSection->setText(0, tr("Same content (%1)").arg(contentSection->childCount()));
+    codeSection->setText(0, tr("Same game code (%1)").arg(codeSection->childCount()));
+    this->groupTree->expandAll();
+
+    if (!this->fingerprinter->isRunning()) {
+        this->rescanButton->setEnabled(true);
+        this->progressBar->setRange(0, 1);
+        this->progressBar->setValue(1);
+        this->statusLabel->setText(tr("%1 groups of possible duplicates").arg(groups));
+    }
+}
+
+void DuplicateReportDialog::addGroup(QTreeWidgetItem *section, const QString &title, const QList<int> &rows) {
+    const LibraryTable &games = GameManager::instance().getGames();
+
+    QTreeWidgetItem *group = new QTreeWidgetItem(section, QStringList() << QString("%1 (%2)").arg(title).arg(rows.size()));
+    for (int row : rows) {
+        const GameItem &game = games[row];
+        QTreeWidgetItem *item = new QTreeWidgetItem(group);
+        item->setText(0, game.cleanName);
+        if (game.contentSize > 0) {
+            item->setText(1, QLocale().formattedDataSize(game.contentSize));
+        } else if (game.type != GameType::Folder) {
+            item->setText(1, QLocale().formattedDataSize(QFileInfo(game.filePath).size()));
+        }
+        item->setText(2, game.filePath);
+    }
+}
+
+void DuplicateReportDialog::openLocation(QTreeWidgetItem *item) {
+    QString path = item->text(2);
+    if (path.isEmpty()) return;
+
+    QFileInfo info(path);
+    QString folderPath = info.isDir() ? info.absoluteFilePath() : info.absolutePath();
+    QDesktopServices::openUrl(QUrl::fromLocalFile(folderPath));
+}
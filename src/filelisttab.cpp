@@ -8,6 +8,37 @@
 #include <QFileInfo>
 #include <QComboBox>
 #include <QDir>
+#include <QLocale>
+
+// Entries that can hold other entries in the tree
+static bool isContainer(GameType type) {
+    return type == GameType::Folder || type == GameType::Directory;
+}
+
+// Archive contents ride along on the Type column until the entry is added to the library
+static const int ContentSizeRole = Qt::UserRole;
+static const int ContentFilesRole = Qt::UserRole + 1;
+static const int ContentExecutablesRole = Qt::UserRole + 2;
+static const int VolumeLabelRole = Qt::UserRole + 3;
+// Product code and store the name revealed (TitleNormalizer), on the Original Name column
+static const int GameCodeRole = Qt::UserRole + 4;
+static const int SourceRole = Qt::UserRole + 5;
+
+static void setContents(QTreeWidgetItem *treeItem, const GameItem &item) {
+    treeItem->setData(1, ContentSizeRole, item.contentSize);
+    treeItem->setData(1, ContentFilesRole, item.contentFiles);
+    treeItem->setData(1, ContentExecutablesRole, item.contentExecutables);
+    treeItem->setData(1, VolumeLabelRole, item.volumeLabel);
+
+    if (item.contentFiles > 0) {
+        QString tip = QString("%1 files, %2").arg(item.contentFiles).arg(QLocale().formattedDataSize(item.contentSize));
+        if (!item.volumeLabel.isEmpty()) tip += "\nVolume: " + item.volumeLabel;
+        if (!item.contentExecutables.isEmpty()) tip += "\n" + item.contentExecutables.mid(0, 5).join("\n");
+        treeItem->setToolTip(1, tip);
+    } else {
+        treeItem->setToolTip(1, QString());
+    }
+}
 
 FileListTab::FileListTab() {
     setMainUI();
@@ -34,7 +65,7 @@ void FileListTab::filterItems(QTreeWidgetItem *item) {
     }
 
     // Determine visibility
-    // Logic: Folders are ALWAYS visible to allow navigation.
+    // Logic: Plain directories are ALWAYS visible to allow navigation.
     // Files are visible if filter is All (-1) OR type matches.
     // Need to parse type from column 1 text or store data?
     // Storing data is better but text parsing is easier given current structure.
@@ -42,7 +73,7 @@ void FileListTab::filterItems(QTreeWidgetItem *item) {
     bool isFolder = (typeStr == "Folder");
     
     bool visible = true;
-    if (this->currentFilterType != -1) {
+    if (this->currentFilterType != -1 && typeStr != "Directory") {
         GameType targetType = static_cast<GameType>(this->currentFilterType);
         bool match = false;
         
@@ -72,6 +103,7 @@ void FileListTab::setMainUI() {
     this->mainTree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
     this->mainTree->setContextMenuPolicy(Qt::CustomContextMenu);
     this->mainTree->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    this->mainTree->setSelectionMode(QAbstractItemView::ExtendedSelection);
     this->mainTree->setSortingEnabled(true); // Enable User Sorting
     
     // IMPORTANT: Connect expanded signal for lazy loading
@@ -96,63 +128,202 @@ void FileListTab::setMainUI() {
 }
 
 void FileListTab::addGameItem(const GameItem &item) {
-    QTreeWidgetItem *parentItem = nullptr;
-    
-    // Find parent by path
-    QFileInfo info(item.filePath);
-    QString parentPath = info.absolutePath(); // Should end up being the parent directory's path
-    
-    // Normalize path separators just in case
-    // parentPath = QDir::cleanPath(parentPath);
-    
-    if (this->itemMap.contains(parentPath)) {
-        parentItem = this->itemMap.value(parentPath);
-    }
-    
-    // Create new item
-    QTreeWidgetItem *newItem;
-    if (parentItem) {
-        newItem = new QTreeWidgetItem(parentItem);
-    } else {
-        newItem = new QTreeWidgetItem(this->mainTree);
-    }
-    
-    // Set text
+    addGameItems(QList<GameItem>() << item);
+}
+
+QTreeWidgetItem *FileListTab::createTreeItem(const GameItem &item) const {
+    // Filled in before it is attached, so setting the texts doesn't notify the view
+    QTreeWidgetItem *newItem = new QTreeWidgetItem();
     newItem->setText(0, item.cleanName);
-    QString typeStr;
-    switch(item.type) {
-        case GameType::Folder: typeStr = "Folder"; break;
-        case GameType::Zip: typeStr = "Zip"; break;
-        case GameType::SevenZip: typeStr = "7z"; break;
-        case GameType::Rar: typeStr = "Rar"; break;
-        case GameType::Iso: typeStr = "Iso"; break; 
-        default: typeStr = "Unknown"; break;
-    }
-    newItem->setText(1, typeStr);
+    newItem->setText(1, typeName(item.type));
     newItem->setText(2, item.originalName);
     newItem->setText(3, item.filePath);
-    
-    // Save to map if it's a folder, so children can find it
-    if (item.type == GameType::Folder) {
-        this->itemMap.insert(item.filePath, newItem);
-        
+    newItem->setData(2, GameCodeRole, item.gameCode);
+    newItem->setData(2, SourceRole, item.source);
+    newItem->setData(3, Qt::UserRole, item.exePath);
+    setContents(newItem, item);
+
+    if (isContainer(item.type)) {
         // Add a dummy child to make it expandable (Lazy Load)
         new QTreeWidgetItem(newItem, QStringList() << "Loading...");
     }
-    
-    // Apply initial filter visibility
-    filterItems(newItem);
-    
-    // Check if already in library
-    GameItem existing = GameManager::instance().getGameByPath(item.filePath);
-    if (!existing.filePath.isEmpty()) {
-        updateItemHighlight(newItem, true);
+    return newItem;
+}
+
+void FileListTab::addGameItems(const QList<GameItem> &items) {
+    QList<QTreeWidgetItem*> topLevel;
+    QList<QTreeWidgetItem*> parents; // In first-seen order
+    QHash<QTreeWidgetItem*, QList<QTreeWidgetItem*>> children;
+    QList<QTreeWidgetItem*> created;
+
+    // Grows while we go: adding a folder releases the entries that were waiting for it
+    QList<GameItem> pending = items;
+    for (int i = 0; i < pending.size(); ++i) {
+        const GameItem item = pending[i];
+
+        // The recursive walk and an on-demand expand scan can both report the same entry
+        if (this->pathItems.contains(item.filePath)) continue;
+
+        // Find parent by path
+        QString parentPath = QFileInfo(item.filePath).absolutePath();
+        QTreeWidgetItem *parentItem = this->itemMap.value(parentPath);
+
+        if (!parentItem && !this->rootPath.isEmpty() && parentPath != this->rootPath
+            && parentPath.startsWith(this->rootPath + '/')) {
+            this->orphans[parentPath].append(item);
+            continue;
+        }
+
+        QTreeWidgetItem *newItem = createTreeItem(item);
+        created.append(newItem);
+        this->pathItems.insert(item.filePath, newItem);
+
+        if (parentItem) {
+            // Real children arrived; the lazy-load placeholder is no longer needed
+            if (parentItem->childCount() == 1 && parentItem->child(0)->text(0) == "Loading...") {
+                delete parentItem->takeChild(0);
+            }
+            if (!children.contains(parentItem)) parents.append(parentItem);
+            children[parentItem].append(newItem);
+        } else {
+            topLevel.append(newItem);
+        }
+
+        // Save to map if it's a folder, so children can find it
+        if (isContainer(item.type)) {
+            this->itemMap.insert(item.filePath, newItem);
+            auto waiting = this->orphans.find(item.filePath);
+            if (waiting != this->orphans.end()) {
+                pending.append(waiting.value());
+                this->orphans.erase(waiting);
+            }
+        }
+    }
+
+    if (created.isEmpty()) return;
+
+    // One model insert per parent instead of one per item
+    if (!topLevel.isEmpty()) this->mainTree->addTopLevelItems(topLevel);
+    for (QTreeWidgetItem *parentItem : parents) {
+        parentItem->addChildren(children.value(parentItem));
+    }
+
+    for (QTreeWidgetItem *newItem : created) {
+        // Apply initial filter visibility (needs the item to be in the tree)
+        filterItems(newItem);
+
+        // Check if already in library
+        if (GameManager::instance().containsPath(newItem->text(3))) {
+            updateItemHighlight(newItem, true);
+        }
     }
 }
 
+void FileListTab::removeGameItems(const QStringList &paths) {
+    for (const QString &path : paths) {
+        this->orphans.remove(QFileInfo(path).absolutePath());
+        QTreeWidgetItem *treeItem = this->pathItems.value(path);
+        if (!treeItem) continue; // Already gone with a removed parent
+
+        forgetItem(treeItem);
+        delete treeItem;
+    }
+}
+
+void FileListTab::updateGameItems(const QList<GameItem> &items) {
+    for (const GameItem &item : items) {
+        QTreeWidgetItem *treeItem = this->pathItems.value(item.filePath);
+        if (!treeItem) continue;
+
+        treeItem->setText(0, item.cleanName);
+        treeItem->setText(1, typeName(item.type));
+        treeItem->setText(2, item.originalName);
+        treeItem->setData(2, GameCodeRole, item.gameCode);
+        treeItem->setData(2, SourceRole, item.source);
+        treeItem->setData(3, Qt::UserRole, item.exePath);
+        setContents(treeItem, item);
+        filterItems(treeItem);
+    }
+}
+
+QStringList FileListTab::syncDirectory(const QString &dir, const QList<GameItem> &items) {
+    QList<QTreeWidgetItem*> shown;
+    if (dir == this->rootPath) {
+        for (int i = 0; i < this->mainTree->topLevelItemCount(); ++i) shown.append(this->mainTree->topLevelItem(i));
+    } else if (QTreeWidgetItem *folder = this->itemMap.value(dir)) {
+        if (folder->childCount() == 1 && folder->child(0)->text(0) == "Loading...") return QStringList();
+        for (int i = 0; i < folder->childCount(); ++i) shown.append(folder->child(i));
+    } else {
+        return QStringList();
+    }
+
+    QHash<QString, GameItem> current;
+    for (const GameItem &item : items) current.insert(item.filePath, item);
+
+    QStringList gone;
+    QList<GameItem> changed;
+    for (QTreeWidgetItem *child : shown) {
+        QString path = child->text(3);
+        auto it = current.find(path);
+        if (it == current.end()) {
+            gone.append(path);
+            continue;
+        }
+        if (child->text(0) != it.value().cleanName || child->text(1) != typeName(it.value().type)
+            || child->data(3, Qt::UserRole).toString() != it.value().exePath
+            || child->data(1, ContentSizeRole).toLongLong() != it.value().contentSize) {
+            changed.append(it.value());
+        }
+        current.erase(it);
+    }
+
+    removeGameItems(gone);
+    updateGameItems(changed);
+
+    QStringList newFolders;
+    const QList<GameItem> added = current.values();
+    for (const GameItem &item : added) {
+        if (isContainer(item.type)) newFolders.append(item.filePath);
+    }
+    addGameItems(added);
+    return newFolders;
+}
+
+QString FileListTab::currentRoot() const {
+    return this->rootPath;
+}
+
+void FileListTab::forgetItem(QTreeWidgetItem *item) {
+    QString path = item->text(3);
+    if (this->pathItems.value(path) == item) this->pathItems.remove(path);
+    if (this->itemMap.value(path) == item) this->itemMap.remove(path);
+    for (int i = 0; i < item->childCount(); ++i) {
+        forgetItem(item->child(i));
+    }
+}
+
+QString FileListTab::typeName(GameType type) {
+    switch(type) {
+        case GameType::Folder: return "Folder";
+        case GameType::Zip: return "Zip";
+        case GameType::SevenZip: return "7z";
+        case GameType::Rar: return "Rar";
+        case GameType::Iso: return "Iso";
+        case GameType::Directory: return "Directory";
+        default: return "Unknown";
+    }
+}
+
+void FileListTab::setRootPath(const QString &path) {
+    this->rootPath = QDir::cleanPath(path);
+    this->orphans.clear();
+}
+
 void FileListTab::clearItems() {
     this->mainTree->clear();
     this->itemMap.clear();
+    this->pathItems.clear();
+    this->orphans.clear();
 }
 
 void FileListTab::onItemExpanded(QTreeWidgetItem *item) {
@@ -173,6 +344,7 @@ void FileListTab::showContextMenu(const QPoint &pos) {
     QMenu myMenu;
     myMenu.addAction("Open Location", this, SLOT(openFileLocation()));
     myMenu.addAction("Rename to Game Name", this, SLOT(renameFolder()));
+    myMenu.addAction("Add Selected to Library", this, SLOT(addSelectedToLibrary()));
 
     myMenu.exec(globalPos);
 }
@@ -232,6 +404,8 @@ void FileListTab::renameFolder() {
             
             this->itemMap.remove(currentPath);
             this->itemMap.insert(newPath, item);
+            this->pathItems.remove(currentPath);
+            this->pathItems.insert(newPath, item);
             
             QMessageBox::information(this, "Success", "Renamed successfully.");
         } else {
@@ -240,26 +414,55 @@ void FileListTab::renameFolder() {
     }
 }
 
+void FileListTab::addSelectedToLibrary() {
+    // Skips the dialog so a whole scanned folder can be imported in one go
+    QList<GameItem> items;
+    const QList<QTreeWidgetItem*> selected = this->mainTree->selectedItems();
+    for (QTreeWidgetItem *treeItem : selected) {
+        if (treeItem->text(3).isEmpty()) continue; // "Loading..." placeholder
+
+        GameItem gameItem = gameItemFromTreeItem(treeItem);
+        gameItem.folderName = QFileInfo(gameItem.filePath).fileName();
+        items.append(gameItem);
+    }
+
+    if (!items.isEmpty()) {
+        emit requestAddGames(items);
+    }
+}
+
 void FileListTab::onDoubleClicked(QTreeWidgetItem *item, int column) {
     Q_UNUSED(column);
     if (!item) return;
-    
+
+    emit requestAddGame(gameItemFromTreeItem(item));
+}
+
+GameItem FileListTab::gameItemFromTreeItem(QTreeWidgetItem *item) const {
     // Construct GameItem from tree item
     GameItem gameItem;
     gameItem.cleanName = item->text(0);
     gameItem.originalName = item->text(2);
     gameItem.filePath = item->text(3);
+    gameItem.gameCode = item->data(2, GameCodeRole).toString();
+    gameItem.source = item->data(2, SourceRole).toString();
+    gameItem.exePath = item->data(3, Qt::UserRole).toString();
+    gameItem.contentSize = item->data(1, ContentSizeRole).toLongLong();
+    gameItem.contentFiles = item->data(1, ContentFilesRole).toInt();
+    gameItem.contentExecutables = item->data(1, ContentExecutablesRole).toStringList();
+    gameItem.volumeLabel = item->data(1, VolumeLabelRole).toString();
     
     QString typeStr = item->text(1);
     GameType type = GameType::Unknown;
-    if (typeStr == "Folder") type = GameType::Folder;
+    // A plain directory the user picks by hand goes into the library as a game folder
+    if (typeStr == "Folder" || typeStr == "Directory") type = GameType::Folder;
     else if (typeStr == "Zip") type = GameType::Zip;
     else if (typeStr == "7z") type = GameType::SevenZip;
     else if (typeStr == "Rar") type = GameType::Rar;
     else if (typeStr == "Iso") type = GameType::Iso;
     gameItem.type = type;
 
-    emit requestAddGame(gameItem);
+    return gameItem;
 }
 
 void FileListTab::updateItemHighlight(QTreeWidgetItem *item, bool isSaved) {
@@ -283,19 +486,13 @@ void FileListTab::updateItemHighlight(QTreeWidgetItem *item, bool isSaved) {
 }
 
 void FileListTab::onGameAdded(const GameItem &item) {
-    // We need to find the item in the tree.
-    // Iterating whole tree might be slow, but let's try finding by match.
-    // Since our tree structure is Folder -> File, native findItems might work if we search recursively.
-    
-    QList<QTreeWidgetItem*> items = this->mainTree->findItems(item.filePath, Qt::MatchExactly | Qt::MatchRecursive, 3);
-    for (auto *treeItem : items) {
+    if (QTreeWidgetItem *treeItem = this->pathItems.value(item.filePath)) {
         updateItemHighlight(treeItem, true);
     }
 }
 
 void FileListTab::onGameRemoved(const QString &path) {
-    QList<QTreeWidgetItem*> items = this->mainTree->findItems(path, Qt::MatchExactly | Qt::MatchRecursive, 3);
-    for (auto *treeItem : items) {
+    if (QTreeWidgetItem *treeItem = this->pathItems.value(path)) {
         updateItemHighlight(treeItem, false);
     }
 }
\ No newline at end of file
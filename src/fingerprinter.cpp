@@ -0,0 +1,321 @@
+#include "fingerprinter.h"
+#include "archivereader.h"
+#include "directoryenumerator.h"
+#include "xxhash64.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+static const quint32 FINGERPRINT_CACHE_MAGIC = 0x47444650; // "GDFP"
+static const quint32 FINGERPRINT_CACHE_VERSION = 1;
+
+static const qint64 SAMPLE_BLOCK = 64 * 1024;
+static const int MAX_FOLDER_FILES = 200000;
+// A stat or an archive directory read counts against the read limit like one small block
+static const qint64 METADATA_COST = 4096;
+
+struct FingerprintJob {
+    QHash<QString, Fingerprinter::CacheEntry> cache; // Read-only while the job runs
+    qint64 readLimit = 0;
+    int total = 0;
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> done{0};
+    std::atomic<qint64> bytesRead{0};
+    QElapsedTimer clock;
+
+    QMutex mutex;
+    QHash<QString, Fingerprinter::CacheEntry> results;
+};
+
+Fingerprinter::Fingerprinter(QObject *parent) : QObject(parent) {
+    this->pool.setMaxThreadCount(2);
+    this->savePool.setMaxThreadCount(1);
+
+    this->pollTimer.setInterval(200);
+    connect(&this->pollTimer, &QTimer::timeout, this, &Fingerprinter::poll);
+
+    loadCache();
+}
+
+Fingerprinter::~Fingerprinter() {
+    // cancel() drops the queued games; the running ones return at their next check,
+    // so the pools' destructors wait for one sampled read and the last save at most
+    cancel();
+}
+
+void Fingerprinter::setConcurrency(int threads) {
+    this->pool.setMaxThreadCount(qMax(1, threads));
+}
+
+void Fingerprinter::setReadLimit(qint64 bytesPerSec) {
+    // Takes effect for the next job
+    this->readLimit = qMax<qint64>(0, bytesPerSec);
+}
+
+bool Fingerprinter::isRunning() const {
+    return !this->current.isNull();
+}
+
+quint64 Fingerprinter::fingerprint(const QString &path) const {
+    return this->cache.value(path).fingerprint;
+}
+
+void Fingerprinter::start(const QList<GameItem> &games) {
+    cancel();
+
+    QSharedPointer<FingerprintJob> job(new FingerprintJob);
+    job->cache = this->cache;
+    job->readLimit = this->readLimit;
+    job->total = games.size();
+    job->clock.start();
+    this->current = job;
+
+    for (const GameItem &game : games) {
+        this->pool.start([job, game]() { runGame(job, game); });
+    }
+
+    emit progress(0, job->total);
+    this->pollTimer.start();
+}
+
+void Fingerprinter::cancel() {
+    if (!this->current) return;
+    QSharedPointer<FingerprintJob> job = this->current;
+
+    // Running tasks return as soon as they see the flag; queued ones never start
+    job->cancelled = true;
+    this->pool.clear();
+    this->current.reset();
+    this->pollTimer.stop();
+
+    // Finished games are worth keeping, but without pruning: the run didn't see every game
+    {
+        QMutexLocker lock(&job->mutex);
+        if (job->results.isEmpty()) return;
+        for (auto it = job->results.constBegin(); it != job->results.constEnd(); ++it) {
+            this->cache.insert(it.key(), it.value());
+        }
+    }
+    queueSave();
+}
+
+void Fingerprinter::queueSave() {
+    QHash<QString, CacheEntry> snapshot = this->cache;
+    this->savePool.start([snapshot]() { saveCache(snapshot); });
+}
+
+void Fingerprinter::poll() {
+    if (!this->current) return;
+    QSharedPointer<FingerprintJob> job = this->current;
+
+    const int done = job->done;
+    emit progress(done, job->total);
+    if (done < job->total) return;
+
+    this->pollTimer.stop();
+    this->current.reset();
+    {
+        QMutexLocker lock(&job->mutex);
+        this->cache = job->results;
+    }
+
+    queueSave();
+    emit finished();
+}
+
+void Fingerprinter::runGame(const QSharedPointer<FingerprintJob> &job, const GameItem &game) {
+    struct DoneGuard {
+        FingerprintJob &job;
+        ~DoneGuard() { ++job.done; }
+    } guard{*job};
+
+    if (job->cancelled) return;
+
+    QFileInfo info(game.filePath);
+    throttle(job, METADATA_COST);
+    if (!info.exists()) return;
+
+    CacheEntry entry;
+    entry.mtime = info.lastModified().toMSecsSinceEpoch();
+    entry.size = info.isDir() ? 0 : info.size();
+
+    auto cached = job->cache.constFind(game.filePath);
+    if (cached != job->cache.constEnd() && cached.value().mtime == entry.mtime && cached.value().size == entry.size) {
+        entry.fingerprint = cached.value().fingerprint;
+    } else if (info.isDir()) {
+        entry.fingerprint = fingerprintFolder(job, game.filePath);
+    } else {
+        if (ArchiveReader::isArchive(game.type)) {
+            // A complete listing makes the archive comparable with its extracted folder
+            const ArchiveReader::Info archive = ArchiveReader::read(game.filePath, game.type);
+            throttle(job, METADATA_COST);
+            if (archive.complete && !archive.files.isEmpty()) {
+                QVector<QPair<QString, qint64>> files;
+                files.reserve(archive.files.size());
+                for (int i = 0; i < archive.files.size(); ++i) {
+                    files.append(qMakePair(archive.files[i], archive.fileSizes.value(i)));
+                }
+                entry.fingerprint = fingerprintFileSet(files);
+            }
+        }
+        if (entry.fingerprint == 0) {
+            throttle(job, qMin(entry.size, 3 * SAMPLE_BLOCK));
+            entry.fingerprint = fingerprintFile(game.filePath, entry.size);
+        }
+    }
+
+    if (job->cancelled || entry.fingerprint == 0) return;
+    QMutexLocker lock(&job->mutex);
+    job->results.insert(game.filePath, entry);
+}
+
+quint64 Fingerprinter::fingerprintFolder(const QSharedPointer<FingerprintJob> &job, const QString &path) {
+    std::unique_ptr<DirectoryEnumerator> enumerator(DirectoryEnumerator::create());
+    QVector<DirectoryEnumerator::Entry> listing;
+    QVector<QPair<QString, qint64>> files;
+
+    const int rootLength = path.size() + (path.endsWith('/') ? 0 : 1);
+    QStringList pending{path};
+    while (!pending.isEmpty() && files.size() < MAX_FOLDER_FILES) {
+        if (job->cancelled) return 0;
+
+        const QString dir = pending.takeLast();
+        if (!enumerator->list(dir, listing)) continue;
+        throttle(job, METADATA_COST);
+
+        const QString prefix = dir.endsWith('/') ? dir : dir + '/';
+        for (const DirectoryEnumerator::Entry &entry : listing) {
+            const QString full = prefix + entry.name;
+            if (entry.isDir) {
+                pending.append(full);
+            } else {
+                files.append(qMakePair(full.mid(rootLength), QFileInfo(full).size()));
+                throttle(job, METADATA_COST);
+            }
+        }
+    }
+    return fingerprintFileSet(files);
+}
+
+quint64 Fingerprinter::fingerprintFileSet(QVector<QPair<QString, qint64>> files) {
+    if (files.isEmpty()) return 0;
+
+    for (auto &file : files) file.first = file.first.toLower();
+
+    // "Game/data/..." in an archive is the same game as "data/..." in the folder it was extracted to
+    for (;;) {
+        const int slash = files.first().first.indexOf('/');
+        if (slash < 0) break;
+        const QString top = files.first().first.left(slash + 1);
+        bool shared = std::all_of(files.cbegin(), files.cend(), [&top](const QPair<QString, qint64> &file) {
+            return file.first.startsWith(top);
+        });
+        if (!shared) break;
+        for (auto &file : files) file.first.remove(0, top.size());
+    }
+
+    std::sort(files.begin(), files.end());
+
+    QByteArray data;
+    for (const auto &file : files) {
+        data += file.first.toUtf8();
+        data += '\0';
+        const quint64 size = qToLittleEndian<quint64>(quint64(file.second));
+        data.append(reinterpret_cast<const char *>(&size), sizeof(size));
+    }
+    return XxHash64::hash(data.constData(), size_t(data.size()));
+}
+
+quint64 Fingerprinter::fingerprintFile(const QString &path, qint64 size) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) return 0;
+
+    QByteArray data;
+    const quint64 sizeLe = qToLittleEndian<quint64>(quint64(size));
+    data.append(reinterpret_cast<const char *>(&sizeLe), sizeof(sizeLe));
+
+    if (size <= 3 * SAMPLE_BLOCK) {
+        data += file.readAll();
+    } else {
+        const qint64 offsets[3] = {0, size / 2 - SAMPLE_BLOCK / 2, size - SAMPLE_BLOCK};
+        for (qint64 offset : offsets) {
+            if (!file.seek(offset)) return 0;
+            data += file.read(SAMPLE_BLOCK);
+        }
+    }
+    return XxHash64::hash(data.constData(), size_t(data.size()));
+}
+
+void Fingerprinter::throttle(const QSharedPointer<FingerprintJob> &job, qint64 bytes) {
+    const qint64 total = (job->bytesRead += bytes);
+    if (job->readLimit <= 0) return;
+
+    // Sleep until the average rate since the job started is back under the limit
+    const qint64 dueMs = total * 1000 / job->readLimit;
+    qint64 ahead = dueMs - job->clock.elapsed();
+    while (ahead > 0 && !job->cancelled) {
+        QThread::msleep(static_cast<unsigned long>(qMin<qint64>(ahead, 100)));
+        ahead = dueMs - job->clock.elapsed();
+    }
+}
+
+QString Fingerprinter::cachePath() {
+    QString dataLocation = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    return QDir(dataLocation).filePath("fingerprints.dat");
+}
+
+void Fingerprinter::loadCache() {
+    QFile file(cachePath());
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QDataStream in(&file);
+    quint32 magic, version, count;
+    in >> magic >> version;
+    if (magic != FINGERPRINT_CACHE_MAGIC || version != FINGERPRINT_CACHE_VERSION) {
+        qDebug() << "Ignoring fingerprint cache with unknown format";
+        return;
+    }
+
+    in >> count;
+    this->cache.reserve(count);
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString path;
+        CacheEntry entry;
+        in >> path >> entry.mtime >> entry.size >> entry.fingerprint;
+        this->cache.insert(path, entry);
+    }
+    if (in.status() != QDataStream::Ok) this->cache.clear();
+}
+
+bool Fingerprinter::saveCache(const QHash<QString, CacheEntry> &cache) {
+    QString path = cachePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&file);
+    out << FINGERPRINT_CACHE_MAGIC << FINGERPRINT_CACHE_VERSION << quint32(cache.size());
+    for (auto it = cache.constBegin(); it != cache.constEnd(); ++it) {
+        out << it.key() << it.value().mtime << it.value().size << it.value().fingerprint;
+    }
+
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        qDebug() << "Failed to write fingerprint cache" << path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,107 @@
+#include "folderwatcher.h"
+#include <QDebug>
+#include <algorithm>
+
+FolderWatcher::FolderWatcher(QObject *parent) : QObject(parent) {
+    connect(&this->watcher, &QFileSystemWatcher::directoryChanged, this, &FolderWatcher::onDirectoryChanged);
+
+    this->debounceTimer.setSingleShot(true);
+    this->debounceTimer.setInterval(DEBOUNCE_MS);
+    connect(&this->debounceTimer, &QTimer::timeout, this, &FolderWatcher::flush);
+
+    this->fallbackTimer.setInterval(5 * 60 * 1000);
+    connect(&this->fallbackTimer, &QTimer::timeout, this, &FolderWatcher::fallbackScanDue);
+}
+
+void FolderWatcher::setBudget(int maxDirectories) {
+    this->maxDirectories = qMax(0, maxDirectories);
+}
+
+int FolderWatcher::budget() const {
+    return this->maxDirectories;
+}
+
+void FolderWatcher::setFallbackInterval(int msecs) {
+    this->fallbackTimer.setInterval(msecs);
+}
+
+void FolderWatcher::watchDirectories(QStringList dirs) {
+    clear();
+
+    // Shallow directories first: a change high up in the tree is the most likely to matter,
+    // and a watched parent still notices a deeper folder being added or removed
+    std::sort(dirs.begin(), dirs.end(), [](const QString &a, const QString &b) {
+        int depthA = a.count('/');
+        int depthB = b.count('/');
+        return depthA != depthB ? depthA < depthB : a < b;
+    });
+    dirs.removeDuplicates();
+
+    bool over = dirs.size() > this->maxDirectories;
+    if (over) dirs = dirs.mid(0, this->maxDirectories);
+    if (!dirs.isEmpty()) {
+        const QStringList failed = this->watcher.addPaths(dirs);
+        if (!failed.isEmpty()) {
+            // Usually the OS limit (fs.inotify.max_user_watches) is lower than our budget
+            qDebug() << "Could not watch" << failed.size() << "directories";
+            over = true;
+        }
+    }
+    setOverBudget(over);
+}
+
+bool FolderWatcher::watch(const QString &dir) {
+    if (this->watcher.directories().contains(dir)) return true;
+    if (watchedCount() >= this->maxDirectories || !this->watcher.addPath(dir)) {
+        setOverBudget(true);
+        return false;
+    }
+    return true;
+}
+
+void FolderWatcher::clear() {
+    const QStringList dirs = this->watcher.directories();
+    if (!dirs.isEmpty()) this->watcher.removePaths(dirs);
+    this->dirty.clear();
+    this->debounceTimer.stop();
+    setOverBudget(false);
+}
+
+int FolderWatcher::watchedCount() const {
+    return this->watcher.directories().size();
+}
+
+bool FolderWatcher::isOverBudget() const {
+    return this->overBudget;
+}
+
+void FolderWatcher::setOverBudget(bool over) {
+    this->overBudget = over;
+    if (over && !this->fallbackTimer.isActive()) {
+        this->fallbackTimer.start();
+    } else if (!over) {
+        this->fallbackTimer.stop();
+    }
+}
+
+void FolderWatcher::onDirectoryChanged(const QString &path) {
+    if (this->dirty.isEmpty()) this->dirtySince.start();
+    this->dirty.insert(path);
+
+    // Quiet period restarts on every event, but a never-ending burst still gets reported
+    if (this->dirtySince.elapsed() >= MAX_LATENCY_MS) {
+        flush();
+    } else {
+        this->debounceTimer.start();
+    }
+}
+
+void FolderWatcher::flush() {
+    this->debounceTimer.stop();
+    if (this->dirty.isEmpty()) return;
+
+    QStringList dirs(this->dirty.begin(), this->dirty.end());
+    this->dirty.clear();
+    std::sort(dirs.begin(), dirs.end());
+    emit directoriesChanged(dirs);
+}
@@ -1,4 +1,5 @@
 #include "gamecarddelegate.h"
+#include "gamelibrarymodel.h"
 #include <QApplication>
 #include <QPainterPath>
 
@@ -13,7 +14,7 @@ void GameCardDelegate::paint(QPainter *painter, const QStyleOptionViewItem &opti
     painter->save();
 
     // Data
-    QIcon icon = qvariant_cast<QIcon>(index.data(Qt::DecorationRole));
+    QIcon icon = qvariant_cast<QIcon>(index.data(GameRoles::CardIconRole));
     QString text = index.data(Qt::DisplayRole).toString();
 
     // Layout Constants
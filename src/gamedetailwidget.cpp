@@ -1,4 +1,7 @@
 #include "gamedetailwidget.h"
+#include "tagmanager.h"
+#include "imageprovider.h"
+#include "thumbnailpreview.h"
 #include <QFileInfo>
 #include <QDesktopServices>
 #include <QUrl>
@@ -21,13 +24,8 @@ void GameDetailWidget::setupUI() {
     this->thumbnailLabel->setStyleSheet("border: 1px solid #ccc; background-color: #000;");
     this->thumbnailLabel->setAlignment(Qt::AlignCenter);
     
-    if (!this->item.thumbnailPath.isEmpty() && QFile::exists(this->item.thumbnailPath)) {
-        QPixmap pix(this->item.thumbnailPath);
-        this->thumbnailLabel->setPixmap(pix.scaled(this->thumbnailLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
-    } else {
-        this->thumbnailLabel->setText("No Image");
-        this->thumbnailLabel->setStyleSheet("border: 1px solid #ccc; background-color: #eee; color: #555;");
-    }
+    connect(&ImageProvider::instance(), &ImageProvider::imagesLoaded, this, &GameDetailWidget::onImagesLoaded);
+    showThumbnail();
     mainLayout->addWidget(this->thumbnailLabel);
     
     // Right: Info & Buttons
@@ -47,7 +45,7 @@ void GameDetailWidget::setupUI() {
         .arg(static_cast<int>(this->item.type)) // Simplified for now
         .arg(this->item.folderName)
         .arg(this->item.koreanSupport ? "O" : "X")
-        .arg(this->item.tags.join(", "))
+        .arg(TagManager::instance().tagNames(this->item.tags).join(", "))
         .arg(sourceStr)
         .arg(codeStr);
     
@@ -98,3 +96,23 @@ void GameDetailWidget::onOpenClicked() {
 void GameDetailWidget::onEditClicked() {
     emit requestEdit(this->item.filePath);
 }
+
+void GameDetailWidget::showThumbnail() {
+    const QSize labelSize = this->thumbnailLabel->size();
+    bool failed = false;
+    QPixmap pix = ImageProvider::instance().pixmap(this->item.thumbnailPath, ThumbnailCache::sizeFor(labelSize), &failed);
+    if (pix.isNull() && !failed) {
+        pix = QPixmap::fromImage(ThumbnailPreview::decode(this->item.thumbnailPreview, qMax(labelSize.width(), labelSize.height())));
+    }
+
+    if (!pix.isNull()) {
+        this->thumbnailLabel->setPixmap(pix.scaled(labelSize, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    } else if (failed) {
+        this->thumbnailLabel->setText("No Image");
+        this->thumbnailLabel->setStyleSheet("border: 1px solid #ccc; background-color: #eee; color: #555;");
+    }
+}
+
+void GameDetailWidget::onImagesLoaded(const QStringList &thumbnailPaths) {
+    if (thumbnailPaths.contains(this->item.thumbnailPath)) showThumbnail();
+}
@@ -0,0 +1,173 @@
+#include "gamefolderdetector.h"
+#include "scanindex.h"
+#include <QFileInfo>
+
+namespace {
+
+struct LevelScan {
+    bool marker = false;
+    QString exeName;
+    int exeRank = 3; // Lower is a better launch candidate
+    int archives = 0;
+    int others = 0; // Files that are neither archives nor documents
+    bool hasWww = false;
+    bool hasPackageJson = false;
+    bool hasRenpy = false;
+    bool hasGameDir = false;
+};
+
+QString suffixOf(const QString &name) {
+    int lastDot = name.lastIndexOf('.');
+    return lastDot < 0 ? QString() : name.mid(lastDot + 1).toLower();
+}
+
+bool isArchiveSuffix(const QString &suffix) {
+    return suffix == "zip" || suffix == "7z" || suffix == "rar" || suffix == "iso";
+}
+
+bool isDocumentSuffix(const QString &suffix) {
+    return suffix == "txt" || suffix == "nfo" || suffix == "url" || suffix == "md" || suffix == "pdf" || suffix == "html" || suffix == "htm";
+}
+
+LevelScan scanLevel(const QString &dirName, const QVector<DirectoryEnumerator::Entry> &entries) {
+    LevelScan scan;
+    const QString lowerDir = dirName.toLower();
+
+    for (const DirectoryEnumerator::Entry &entry : entries) {
+        const QString lower = entry.name.toLower();
+        if (entry.isDir) {
+            if (lower == "www") scan.hasWww = true;
+            else if (lower == "renpy") scan.hasRenpy = true;
+            else if (lower == "game") scan.hasGameDir = true;
+            continue;
+        }
+
+        const QString suffix = suffixOf(lower);
+        if (lower == "data.win" || lower == "unityplayer.dll" || suffix == "rpgproject"
+            || suffix == "rgssad" || suffix == "rgss2a" || suffix == "rgss3a") {
+            scan.marker = true;
+        } else if (lower == "package.json") {
+            scan.hasPackageJson = true;
+        }
+
+        if (suffix == "exe" || suffix == "x86_64") {
+            if (GameFolderDetector::isHelperExecutable(lower)) continue;
+
+            // Prefer the exe named like its folder, then the RPG Maker default, then any;
+            // ties go to the smallest name so the choice doesn't depend on listing order
+            const QString base = lower.left(lower.size() - suffix.size() - 1);
+            int rank = base == lowerDir ? 0 : (base == "game" ? 1 : 2);
+            if (rank < scan.exeRank || (rank == scan.exeRank && entry.name < scan.exeName)) {
+                scan.exeRank = rank;
+                scan.exeName = entry.name;
+            }
+        } else if (isArchiveSuffix(suffix)) {
+            ++scan.archives;
+        } else if (!isDocumentSuffix(suffix)) {
+            ++scan.others;
+        }
+    }
+
+    if ((scan.hasWww && scan.hasPackageJson) || (scan.hasRenpy && scan.hasGameDir)) scan.marker = true;
+    return scan;
+}
+
+} // namespace
+
+void GameFolderDetector::setMaxDepth(int depth) {
+    this->depthLimit = qMax(0, depth);
+}
+
+int GameFolderDetector::maxDepth() const {
+    return this->depthLimit;
+}
+
+void GameFolderDetector::setIoBudget(int listings) {
+    this->listingBudget = qMax(1, listings);
+}
+
+int GameFolderDetector::ioBudget() const {
+    return this->listingBudget;
+}
+
+GameFolderDetector::Detection GameFolderDetector::detect(const QString &path, DirectoryEnumerator &enumerator) const {
+    QVector<DirectoryEnumerator::Entry> listing;
+    if (!enumerator.list(path, listing)) return Detection();
+    return detect(path, listing, enumerator);
+}
+
+GameFolderDetector::Detection GameFolderDetector::detect(const QString &path, const QVector<DirectoryEnumerator::Entry> &listing,
+                                                         DirectoryEnumerator &enumerator) const {
+    struct Pending {
+        QString path;
+        int depth;
+    };
+
+    Detection result;
+    QVector<Pending> queue;
+    QVector<DirectoryEnumerator::Entry> scratch;
+    int listings = 1; // The caller's listing of path
+
+    QString dir = path;
+    int depth = 0;
+    const QVector<DirectoryEnumerator::Entry> *entries = &listing;
+    for (int next = 0;;) {
+        const LevelScan scan = scanLevel(QFileInfo(dir).fileName(), *entries);
+        const QString prefix = dir.endsWith('/') ? dir : dir + '/';
+
+        // Breadth-first, so the shallowest signal wins and its exe is the one launched
+        if (!scan.exeName.isEmpty() || scan.marker) {
+            result.isGame = true;
+            if (!scan.exeName.isEmpty()) result.exePath = prefix + scan.exeName;
+            return result;
+        }
+
+        if (depth == 0) {
+            bool hasSubdirs = false;
+            for (const DirectoryEnumerator::Entry &entry : *entries) {
+                if (entry.isDir) { hasSubdirs = true; break; }
+            }
+            // A download wrapped in a folder, maybe next to a readme
+            if (!hasSubdirs && scan.archives > 0 && scan.others == 0) {
+                result.isGame = true;
+                return result;
+            }
+        }
+
+        if (depth < this->depthLimit) {
+            for (const DirectoryEnumerator::Entry &entry : *entries) {
+                if (entry.isDir) queue.append(Pending{prefix + entry.name, depth + 1});
+            }
+        }
+
+        // Next readable directory, if the budget still allows listing one
+        bool listed = false;
+        while (next < queue.size() && listings < this->listingBudget) {
+            const Pending pending = queue[next++];
+            ++listings;
+            qint64 mtime = 0;
+            quint64 inode = 0;
+            if (ScanIndex::statDirectory(pending.path, mtime, inode) && enumerator.list(pending.path, scratch)) {
+                result.probed.insert(pending.path, mtime);
+                dir = pending.path;
+                depth = pending.depth;
+                entries = &scratch;
+                listed = true;
+                break;
+            }
+        }
+        if (!listed) return result;
+    }
+}
+
+bool GameFolderDetector::isHelperExecutable(const QString &fileName) {
+    static const char *const prefixes[] = {
+        "unins", "uninstall", "setup", "install", "vcredist", "vc_redist", "dxsetup", "dxwebsetup",
+        "dotnetfx", "oalinst", "unitycrashhandler", "crashpad", "crashreport", "notification_helper"
+    };
+    const QString lowerName = fileName.toLower();
+    for (const char *prefix : prefixes) {
+        if (lowerName.startsWith(QLatin1String(prefix))) return true;
+    }
+    return false;
+}
@@ -1,4 +1,7 @@
 #include "gameinfodialog.h"
+#include "imageprovider.h"
+#include "thumbnailstore.h"
+#include "thumbnailpreview.h"
 #include <QMimeData>
 
 GameInfoDialog::GameInfoDialog(const GameItem &item, QWidget *parent) 
@@ -79,7 +82,7 @@ void GameInfoDialog::setupUI() {
     for (const QString &tag : allTags) {
         QListWidgetItem *item = new QListWidgetItem(tag, this->tagList);
         item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
-        if (this->item.tags.contains(tag)) {
+        if (this->item.tags.contains(TagManager::instance().findTagId(tag))) {
             item->setCheckState(Qt::Checked);
         } else {
             item->setCheckState(Qt::Unchecked);
@@ -107,14 +110,15 @@ void GameInfoDialog::setupUI() {
     this->imagePreview->setStyleSheet("border: 1px solid #ccc; background-color: #eee;");
     this->imagePreview->setAlignment(Qt::AlignCenter);
     this->imagePreview->setText("No Image");
+    connect(&ImageProvider::instance(), &ImageProvider::imagesLoaded, this, &GameInfoDialog::onImagesLoaded);
     updateThumbnailPreview(); // Load existing if any
     
     // Capture Controls
     QHBoxLayout *capLayout = new QHBoxLayout();
-    capLayout->addWidget(new QLabel(tr("Delay (sec):")));
+    capLayout->addWidget(new QLabel(tr("Wait up to (sec):")));
     this->delaySpin = new QSpinBox();
-    this->delaySpin->setRange(1, 60);
-    this->delaySpin->setValue(10);
+    this->delaySpin->setRange(5, 120);
+    this->delaySpin->setValue(30);
     capLayout->addWidget(this->delaySpin);
     
     QPushButton *btnCapture = new QPushButton(tr("Auto Capture"));
@@ -190,14 +194,40 @@ void GameInfoDialog::setupUI() {
 }
 
 void GameInfoDialog::updateThumbnailPreview() {
-    if (!this->item.thumbnailPath.isEmpty() && QFile::exists(this->item.thumbnailPath)) {
-        QPixmap pix(this->item.thumbnailPath);
-        this->imagePreview->setPixmap(pix.scaled(this->imagePreview->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
-    } else {
+    const QSize previewSize = this->imagePreview->size();
+    bool failed = false;
+    const QPixmap pix = ImageProvider::instance().pixmap(this->item.thumbnailPath, ThumbnailCache::sizeFor(previewSize), &failed);
+    if (!pix.isNull()) {
+        // Saved with the game, so lists can paint it before their own load of the image
+        if (this->item.thumbnailPreview.isEmpty()) this->item.thumbnailPreview = ThumbnailPreview::encode(pix.toImage());
+        this->imagePreview->setPixmap(pix.scaled(previewSize, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    } else if (failed) {
+        this->item.thumbnailPreview.clear();
         this->imagePreview->setText("No Image");
+    } else {
+        // Still decoding; onImagesLoaded() brings us back
+        const QImage preview = ThumbnailPreview::decode(this->item.thumbnailPreview, qMax(previewSize.width(), previewSize.height()));
+        if (!preview.isNull()) {
+            this->imagePreview->setPixmap(QPixmap::fromImage(preview).scaled(previewSize, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+        } else {
+            this->imagePreview->setText("Loading...");
+        }
     }
 }
 
+void GameInfoDialog::setThumbnailPath(const QString &path) {
+    if (path != this->item.thumbnailPath) {
+        // The code described the old image
+        this->item.thumbnailPreview.clear();
+        this->item.thumbnailPath = path;
+    }
+    updateThumbnailPreview();
+}
+
+void GameInfoDialog::onImagesLoaded(const QStringList &thumbnailPaths) {
+    if (thumbnailPaths.contains(this->item.thumbnailPath)) updateThumbnailPreview();
+}
+
 void GameInfoDialog::onBrowseExeClicked() {
     QString dir = this->item.filePath;
     if (QFileInfo(dir).isFile()) dir = QFileInfo(dir).absolutePath();
@@ -218,20 +248,18 @@ void GameInfoDialog::onCaptureClicked() {
     this->saveButton->setEnabled(false);
     this->imagePreview->setText("Capturing...");
     
-    QString name = this->nameEdit->text();
-    if (name.isEmpty()) name = this->item.cleanName;
-    
-    this->thumbManager->startCapture(exe, name, this->delaySpin->value());
+    this->thumbManager->enqueue(this->item.filePath, exe, this->delaySpin->value());
 }
 
-void GameInfoDialog::onCaptureFinished(const QString &path) {
-    this->item.thumbnailPath = path;
-    updateThumbnailPreview();
+void GameInfoDialog::onCaptureFinished(const QString &id, const QString &path) {
+    Q_UNUSED(id);
+    setThumbnailPath(path);
     this->saveButton->setEnabled(true);
     QMessageBox::information(this, tr("Success"), tr("Thumbnail captured successfully!"));
 }
 
-void GameInfoDialog::onCaptureFailed(const QString &reason) {
+void GameInfoDialog::onCaptureFailed(const QString &id, const QString &reason) {
+    Q_UNUSED(id);
     this->imagePreview->setText("Failed");
     this->saveButton->setEnabled(true);
     QMessageBox::critical(this, tr("Capture Failed"), reason);
@@ -246,8 +274,9 @@ void GameInfoDialog::onToggleAdvanced() {
 void GameInfoDialog::onBrowseThumbnail() {
     QString path = QFileDialog::getOpenFileName(this, tr("Select Thumbnail"), "", "Images (*.png *.jpg *.jpeg *.bmp)");
     if (!path.isEmpty()) {
-        this->item.thumbnailPath = path;
-        updateThumbnailPreview();
+        // A copy in the store survives the original being moved or deleted
+        QString stored = ThumbnailStore::instance().import(path);
+        setThumbnailPath(stored.isEmpty() ? path : stored);
     }
 }
 
@@ -258,25 +287,10 @@ void GameInfoDialog::onPasteThumbnail() {
     if (mime->hasImage()) {
         QPixmap pix = qvariant_cast<QPixmap>(mime->imageData());
         if (!pix.isNull()) {
-            // Save to file
-            QString name = this->item.cleanName;
-            // Sanitize name
-            static QRegularExpression re("[\\\\/:*?\"<>|]");
-            name.replace(re, "");
-            name = name.simplified().replace(" ", "_");
-            if (name.isEmpty()) name = "game";
-            
-            QString fileName = QString("%1_thumb_manual.png").arg(name);
-            QString saveLocation = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-            QDir dir(saveLocation);
-            // Ensure thumbnails dir? Just put in root of AppData for now or create subfolder.
-            // Following existing pattern (ThumbnailManager seems to use SaveLocation directly or passed path).
-            // Let's use same dir as games.json
-            
-            QString fullPath = dir.filePath(fileName);
-            if (pix.save(fullPath, "PNG")) {
-                this->item.thumbnailPath = fullPath;
-                updateThumbnailPreview();
+            // Into the content-addressed store, so names can't collide and pasting the same image twice costs nothing
+            QString fullPath = ThumbnailStore::instance().store(pix.toImage());
+            if (!fullPath.isEmpty()) {
+                setThumbnailPath(fullPath);
                 QMessageBox::information(this, tr("Success"), tr("Image pasted and saved."));
             } else {
                 QMessageBox::warning(this, tr("Error"), tr("Failed to save pasted image."));
@@ -307,11 +321,14 @@ void GameInfoDialog::save() {
     
     qDebug() << "Saving GameItem. Thumbnail:" << this->item.thumbnailPath;
     
-    this->item.tags.clear();
+    // Only touch the tags listed here; names the game carries that aren't user tags survive
     for (int i = 0; i < this->tagList->count(); ++i) {
         QListWidgetItem *tItem = this->tagList->item(i);
+        int id = TagManager::instance().tagId(tItem->text());
         if (tItem->checkState() == Qt::Checked) {
-            this->item.tags.append(tItem->text());
+            this->item.tags.insert(id);
+        } else {
+            this->item.tags.remove(id);
         }
     }
     
@@ -1,43 +1,151 @@
 #include "gamelibrarymodel.h"
 #include "gamemanager.h"
 #include "imageprovider.h"
+#include "tagmanager.h"
 #include <QColor>
 #include <QIcon>
 #include <QPixmap>
 #include <QFileInfo>
+#include <QSet>
+#include <algorithm>
 
 GameLibraryModel::GameLibraryModel(QObject *parent)
     : QAbstractTableModel(parent)
 {
     // Connect to GameManager to receive updates
     connect(&GameManager::instance(), &GameManager::libraryUpdated, this, &GameLibraryModel::onLibraryUpdated);
+    connect(&GameManager::instance(), &GameManager::gamesAboutToBeInserted, this, &GameLibraryModel::onGamesAboutToBeInserted);
+    connect(&GameManager::instance(), &GameManager::gamesInserted, this, &GameLibraryModel::onGamesInserted);
+    connect(&GameManager::instance(), &GameManager::gamesAboutToBeRemoved, this, &GameLibraryModel::onGamesAboutToBeRemoved);
+    connect(&GameManager::instance(), &GameManager::gamesRemoved, this, &GameLibraryModel::onGamesRemoved);
+    connect(&GameManager::instance(), &GameManager::gamesChanged, this, &GameLibraryModel::onGamesChanged);
     libraryRef = &GameManager::instance().getGames();
+    rows = libraryRef->size();
     
     // Connect to ImageProvider to repaint cells when images load via background thread
-    connect(&ImageProvider::instance(), &ImageProvider::imageLoaded, this, [this](const QString &path) {
-        if (!libraryRef) return;
-        for (int i = 0; i < libraryRef->size(); ++i) {
-            if (libraryRef->at(i).thumbnailPath == path) {
-                QModelIndex idx = index(i, 0);
-                emit dataChanged(idx, idx, {Qt::DecorationRole});
-            }
-        }
-    });
+    connect(&ImageProvider::instance(), &ImageProvider::imagesLoaded, this, &GameLibraryModel::onImagesLoaded);
 }
 
 void GameLibraryModel::onLibraryUpdated()
 {
-    // For now, the safest and simplest approach is a full reset since the underlying list can change entirely.
+    // Only used for loads; everything else arrives as row-level signals
     beginResetModel();
     libraryRef = &GameManager::instance().getGames();
+    rows = libraryRef->size();
     endResetModel();
 }
 
+void GameLibraryModel::onGamesAboutToBeInserted(int first, int last)
+{
+    beginInsertRows(QModelIndex(), first, last);
+}
+
+void GameLibraryModel::onGamesInserted(int first, int last)
+{
+    rows += last - first + 1;
+    endInsertRows();
+}
+
+void GameLibraryModel::onGamesAboutToBeRemoved(int first, int last)
+{
+    beginRemoveRows(QModelIndex(), first, last);
+}
+
+void GameLibraryModel::onGamesRemoved(int first, int last)
+{
+    rows -= last - first + 1;
+    endRemoveRows();
+}
+
+void GameLibraryModel::onGamesChanged(const QList<int> &changedRows, GameFields fields)
+{
+    // Translate the changed fields into the columns and roles that actually show them,
+    // so the proxy only re-filters/re-sorts when something it looks at changed.
+    int firstColumn = columnCount();
+    int lastColumn = -1;
+    QVector<int> roles;
+    roles << GameRoles::GameItemRole;
+
+    auto touch = [&](GameField field, int column, std::initializer_list<int> fieldRoles) {
+        if (!fields.testFlag(field)) return;
+        firstColumn = qMin(firstColumn, column);
+        lastColumn = qMax(lastColumn, column);
+        for (int role : fieldRoles) {
+            if (!roles.contains(role)) roles << role;
+        }
+    };
+    touch(GameField::Name, 0, {Qt::DisplayRole, GameRoles::CleanNameRole});
+    touch(GameField::Thumbnail, 0, {Qt::DecorationRole, GameRoles::CardIconRole});
+    touch(GameField::FolderName, 1, {Qt::DisplayRole, GameRoles::FolderNameRole});
+    touch(GameField::Type, 2, {Qt::DisplayRole, GameRoles::TypeRole});
+    touch(GameField::Korean, 3, {Qt::DisplayRole, Qt::ForegroundRole, GameRoles::KoreanSupportRole});
+    touch(GameField::Tags, 4, {Qt::DisplayRole, GameRoles::TagsRole});
+    touch(GameField::LastPlayed, 5, {Qt::DisplayRole, GameRoles::LastPlayedRole});
+    touch(GameField::Path, 6, {Qt::DisplayRole, GameRoles::FilePathRole});
+    // Missing greys out the whole row and tags the path column
+    touch(GameField::Missing, 0, {Qt::ForegroundRole});
+    touch(GameField::Missing, 6, {Qt::DisplayRole});
+    if (lastColumn == -1) {
+        // Only fields without a column (source, code) changed
+        firstColumn = lastColumn = 0;
+    }
+
+    // Rows arrive sorted
+    emitRowRuns(changedRows, firstColumn, lastColumn, roles);
+}
+
+void GameLibraryModel::onImagesLoaded(const QStringList &thumbnailPaths)
+{
+    // Several batches can land in one event-loop pass; repaint for all of them once
+    const bool queued = !this->loadedThumbnails.isEmpty();
+    for (const QString &path : thumbnailPaths) this->loadedThumbnails.insert(path);
+    if (!queued && !this->loadedThumbnails.isEmpty()) {
+        QMetaObject::invokeMethod(this, &GameLibraryModel::flushLoadedThumbnails, Qt::QueuedConnection);
+    }
+}
+
+void GameLibraryModel::flushLoadedThumbnails()
+{
+    const QSet<QString> paths = this->loadedThumbnails;
+    this->loadedThumbnails.clear();
+    if (!libraryRef) return;
+
+    // Rows come from GameManager's thumbnail index instead of a scan of the library
+    QList<int> changedRows;
+    for (const QString &path : paths) {
+        const QList<int> pathRows = GameManager::instance().rowsForThumbnail(path);
+        for (int row : pathRows) {
+            // Inside a batch the library can hold rows not announced yet
+            if (row < rows) changedRows.append(row);
+        }
+    }
+    std::sort(changedRows.begin(), changedRows.end());
+    changedRows.erase(std::unique(changedRows.begin(), changedRows.end()), changedRows.end());
+
+    emitRowRuns(changedRows, 0, 0, {Qt::DecorationRole, GameRoles::CardIconRole});
+}
+
+void GameLibraryModel::emitRowRuns(const QList<int> &sortedRows, int firstColumn, int lastColumn, const QVector<int> &roles)
+{
+    // One dataChanged per contiguous run
+    int i = 0;
+    while (i < sortedRows.size()) {
+        int first = sortedRows[i];
+        int last = first;
+        while (i + 1 < sortedRows.size() && sortedRows[i + 1] == last + 1) {
+            ++i;
+            ++last;
+        }
+        emit dataChanged(index(first, firstColumn), index(last, lastColumn), roles);
+        ++i;
+    }
+}
+
 int GameLibraryModel::rowCount(const QModelIndex &parent) const
 {
     if (parent.isValid() || !libraryRef)
         return 0;
-    return libraryRef->size();
+    return rows;
 }
 
 int GameLibraryModel::columnCount(const QModelIndex &parent) const
@@ -49,7 +157,7 @@ int GameLibraryModel::columnCount(const QModelIndex &parent) const
 
 QVariant GameLibraryModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid() || index.row() >= libraryRef->size())
+    if (!index.isValid() || index.row() >= rows || index.row() >= libraryRef->size())
         return QVariant();
 
     const GameItem &game = libraryRef->at(index.row());
@@ -66,9 +174,13 @@ QVariant GameLibraryModel::data(const QModelIndex &index, int role) const
     } else if (role == GameRoles::TypeRole) {
         return QVariant::fromValue(static_cast<int>(game.type));
     } else if (role == GameRoles::TagsRole) {
-        return game.tags;
+        return TagManager::instance().tagNames(game.tags);
     } else if (role == GameRoles::LastPlayedRole) {
         return game.lastPlayed;
+    } else if (role == GameRoles::KoreanSupportRole) {
+        return game.koreanSupport;
+    } else if (role == GameRoles::CardIconRole) {
+        return ImageProvider::instance().getIcon(game.thumbnailPath, ThumbnailCache::Card, game.thumbnailPreview);
     }
 
     // Default Display Roles for TableView
@@ -86,16 +198,20 @@ QVariant GameLibraryModel::data(const QModelIndex &index, int role) const
                     default: return "Unknown";
                 }
             case 3: return game.koreanSupport ? "Yes" : "No";
-            case 4: return game.tags.join(", ");
+            case 4: return TagManager::instance().tagNames(game.tags).join(", ");
             case 5: return game.lastPlayed.isValid() ? game.lastPlayed.toString("yyyy-MM-dd HH:mm") : "Never";
-            case 6: return game.filePath;
+            case 6:
+                return GameManager::instance().isMissing(game.filePath) ? game.filePath + " (missing)" : game.filePath;
         }
     } else if (role == Qt::ForegroundRole) {
         if (index.column() == 3) { // Korean Support 
             return game.koreanSupport ? QVariant(QColor(Qt::darkGreen)) : QVariant(QColor(Qt::transparent));
         }
+        if (GameManager::instance().isMissing(game.filePath)) {
+            return QColor(Qt::gray);
+        }
     } else if (role == Qt::DecorationRole && index.column() == 0) {
-        return ImageProvider::instance().getIcon(game.thumbnailPath);
+        return ImageProvider::instance().getIcon(game.thumbnailPath, ThumbnailCache::Icon, game.thumbnailPreview);
     }
 
     return QVariant();
@@ -124,3 +240,11 @@ GameItem GameLibraryModel::getGame(int row) const
     }
     return GameItem();
 }
+
+const GameItem *GameLibraryModel::gameAt(int row) const
+{
+    if (row >= 0 && row < rows && row < libraryRef->size()) {
+        return &libraryRef->at(row);
+    }
+    return nullptr;
+}
@@ -2,6 +2,7 @@
 #include "gamedetailwidget.h"
 #include "gameinfodialog.h"
 #include "gamecarddelegate.h"
+#include "imageprovider.h"
 #include <QTimer>
 #include <QVBoxLayout>
 #include <QHeaderView>
@@ -15,6 +16,7 @@
 #include <QDialog>
 #include <QLineEdit>
 #include <QSortFilterProxyModel>
+#include <QScrollBar>
 #include "tagmanager.h"
 
 // Custom Proxy Model for advanced filtering
@@ -24,8 +26,8 @@ public:
 
     QString searchText;
     int typeFilter = -1;
-    QStringList tagFilters;
-    bool filterAllTags = true;
+    TagSet tagFilter; // Empty means no tag filtering
+    bool matchAnyTag = false;
 
     void updateFilter() {
         invalidateFilter();
@@ -33,24 +35,23 @@ public:
 
 protected:
     bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const override {
-        QModelIndex index = sourceModel()->index(source_row, 0, source_parent);
-        
-        GameType type = static_cast<GameType>(sourceModel()->data(index, GameRoles::TypeRole).toInt());
-        QString cleanName = sourceModel()->data(index, GameRoles::CleanNameRole).toString().toLower();
-        QString folderName = sourceModel()->data(index, GameRoles::FolderNameRole).toString().toLower();
-        QStringList tags = sourceModel()->data(index, GameRoles::TagsRole).toStringList();
+        Q_UNUSED(source_parent);
+        // Read the item in place: going through data() would build QVariants and lowered copies per row
+        const GameItem *game = static_cast<GameLibraryModel *>(sourceModel())->gameAt(source_row);
+        if (!game)
+            return false;
 
-        if (typeFilter != -1 && static_cast<int>(type) != typeFilter)
+        if (typeFilter != -1 && static_cast<int>(game->type) != typeFilter)
             return false;
 
-        if (!searchText.isEmpty() && !cleanName.contains(searchText) && !folderName.contains(searchText))
+        if (!searchText.isEmpty()
+            && !game->cleanName.contains(searchText, Qt::CaseInsensitive)
+            && !game->folderName.contains(searchText, Qt::CaseInsensitive))
             return false;
 
-        if (!filterAllTags) {
-            for (const QString &t : tagFilters) {
-                if (!tags.contains(t))
-                    return false;
-            }
+        if (!tagFilter.isEmpty()) {
+            if (matchAnyTag ? !game->tags.intersects(tagFilter) : !game->tags.containsAll(tagFilter))
+                return false;
         }
         return true;
     }
@@ -62,8 +63,8 @@ protected:
         if (sortCol == 2) {
             return sourceModel()->data(left, GameRoles::TypeRole).toInt() < sourceModel()->data(right, GameRoles::TypeRole).toInt();
         } else if (sortCol == 3) {
-            bool lKor = sourceModel()->data(left, Qt::ForegroundRole).value<QColor>() == QColor(Qt::darkGreen);
-            bool rKor = sourceModel()->data(right, Qt::ForegroundRole).value<QColor>() == QColor(Qt::darkGreen);
+            bool lKor = sourceModel()->data(left, GameRoles::KoreanSupportRole).toBool();
+            bool rKor = sourceModel()->data(right, GameRoles::KoreanSupportRole).toBool();
             return lKor < rKor;
         } else if (sortCol == 5) {
             return sourceModel()->data(left, GameRoles::LastPlayedRole).toDateTime() < sourceModel()->data(right, GameRoles::LastPlayedRole).toDateTime();
@@ -74,7 +75,7 @@ protected:
     }
 };
 
-GameListTab::GameListTab() : expandedRow(-1) {
+GameListTab::GameListTab() {
     libraryModel = new GameLibraryModel(this);
     proxyModel = new GameListFilterProxyModel(this);
     proxyModel->setSourceModel(libraryModel);
@@ -87,6 +88,21 @@ GameListTab::GameListTab() : expandedRow(-1) {
     connect(&TagManager::instance(), &TagManager::tagAdded, [&](const QString &){ updateTagFilterCombo(); });
     connect(&TagManager::instance(), &TagManager::tagRemoved, [&](const QString &){ updateTagFilterCombo(); });
     connect(&TagManager::instance(), &TagManager::tagRenamed, [&](const QString &, const QString &){ updateTagFilterCombo(); });
+    connect(&GameManager::instance(), &GameManager::tagCountsChanged, this, &GameListTab::updateTagFilterCombo);
+
+    // Scrolling, resizing and re-filtering all change what is on screen; report it once things settle
+    this->viewportTimer = new QTimer(this);
+    this->viewportTimer->setSingleShot(true);
+    this->viewportTimer->setInterval(30);
+    connect(this->viewportTimer, &QTimer::timeout, this, &GameListTab::updateThumbnailViewport);
+    for (QAbstractItemView *view : {static_cast<QAbstractItemView *>(this->gameTable), static_cast<QAbstractItemView *>(this->gameListView)}) {
+        connect(view->verticalScrollBar(), &QScrollBar::valueChanged, this->viewportTimer, qOverload<>(&QTimer::start));
+        connect(view->verticalScrollBar(), &QScrollBar::rangeChanged, this->viewportTimer, qOverload<>(&QTimer::start));
+    }
+    connect(proxyModel, &QAbstractItemModel::layoutChanged, this->viewportTimer, qOverload<>(&QTimer::start));
+    connect(proxyModel, &QAbstractItemModel::modelReset, this->viewportTimer, qOverload<>(&QTimer::start));
+    connect(proxyModel, &QAbstractItemModel::rowsInserted, this->viewportTimer, qOverload<>(&QTimer::start));
+    connect(proxyModel, &QAbstractItemModel::rowsRemoved, this->viewportTimer, qOverload<>(&QTimer::start));
 }
 
 void GameListTab::setupUI() {
@@ -117,6 +133,16 @@ void GameListTab::setupUI() {
     updateTagFilterCombo();
     connect(this->tagFilterCombo, &MultiSelectComboBox::selectionChanged, this, &GameListTab::onTagFilterChanged);
     topLayout->addWidget(this->tagFilterCombo);
+
+    // Tag Match Mode: games must have all selected tags, or any of them
+    this->tagMatchBtn = new QToolButton();
+    this->tagMatchBtn->setText("Match All");
+    this->tagMatchBtn->setCheckable(true);
+    connect(this->tagMatchBtn, &QToolButton::toggled, this, [this](bool any) {
+        this->tagMatchBtn->setText(any ? "Match Any" : "Match All");
+        refreshList();
+    });
+    topLayout->addWidget(this->tagMatchBtn);
     
     // View Toggle
     this->viewToggleBtn = new QToolButton();
@@ -160,6 +186,7 @@ void GameListTab::setupUI() {
     this->gameTable->setColumnWidth(5, 140); 
     
     this->gameTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    this->gameTable->setSelectionMode(QAbstractItemView::ExtendedSelection);
     this->gameTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
     this->gameTable->setContextMenuPolicy(Qt::CustomContextMenu);
     this->gameTable->setIconSize(QSize(48, 48)); 
@@ -200,8 +227,14 @@ void GameListTab::refreshList() {
     proxyModel->searchText = this->searchEdit->text().toLower();
     proxyModel->typeFilter = this->typeFilterCombo->currentData().toInt();
     
-    proxyModel->tagFilters = this->tagFilterCombo->getSelectedData();
-    proxyModel->filterAllTags = proxyModel->tagFilters.contains("All") || proxyModel->tagFilters.isEmpty();
+    proxyModel->tagFilter.clear();
+    QStringList selectedTags = this->tagFilterCombo->getSelectedData();
+    if (!selectedTags.contains("All")) {
+        for (const QString &tag : selectedTags) {
+            proxyModel->tagFilter.insert(TagManager::instance().findTagId(tag));
+        }
+    }
+    proxyModel->matchAnyTag = this->tagMatchBtn->isChecked();
     
     proxyModel->updateFilter();
 }
@@ -222,17 +255,25 @@ void GameListTab::onTagFilterChanged() {
 }
 
 void GameListTab::updateTagFilterCombo() {
+    // Already sorted by TagManager
+    const QStringList tags = TagManager::instance().getTags();
+
+    // Only counts changed: relabel in place, so an open popup and its checks survive
+    if (this->tagFilterCombo->itemDataList() == QStringList("All") + tags) {
+        for (const QString &tag : tags) {
+            this->tagFilterCombo->setItemTextForData(tag, QString("%1 (%2)").arg(tag).arg(GameManager::instance().tagCount(tag)));
+        }
+        return;
+    }
+
     QStringList currentSelection = this->tagFilterCombo->getSelectedData();
     this->tagFilterCombo->blockSignals(true);
     this->tagFilterCombo->clearItems();
     
     this->tagFilterCombo->addCheckableItem("All Tags", "All");
     
-    QStringList tags = TagManager::instance().getTags();
-    tags.sort();
-    
     for (const QString &tag : tags) {
-        this->tagFilterCombo->addCheckableItem(tag, tag);
+        this->tagFilterCombo->addCheckableItem(QString("%1 (%2)").arg(tag).arg(GameManager::instance().tagCount(tag)), tag);
     }
     
     if (currentSelection.isEmpty()) {
@@ -282,6 +323,7 @@ void GameListTab::showContextMenu(const QPoint &pos) {
     QMenu myMenu;
     myMenu.addAction("Open Location", this, SLOT(openFileLocation()));
     myMenu.addAction("Remove from Library", this, SLOT(removeGame()));
+    myMenu.addAction("Capture Thumbnails", this, SLOT(captureSelected()));
 
     myMenu.exec(globalPos);
 }
@@ -295,37 +337,49 @@ void GameListTab::openFileLocation() {
 }
 
 void GameListTab::removeGame() {
-    QModelIndex index = this->gameTable->currentIndex();
-    if (!index.isValid()) return;
+    QStringList paths;
+    const QModelIndexList rows = this->gameTable->selectionModel()->selectedRows();
+    for (const QModelIndex &index : rows) {
+        paths.append(proxyModel->data(index, GameRoles::FilePathRole).toString());
+    }
+    if (paths.isEmpty()) return;
     
-    QString path = proxyModel->data(index, GameRoles::FilePathRole).toString();
+    QString question = paths.size() == 1
+        ? QString("Are you sure you want to remove this game from the library?")
+        : QString("Are you sure you want to remove %1 games from the library?").arg(paths.size());
     
-    if (QMessageBox::question(this, "Remove Game", "Are you sure you want to remove this game from the library?") == QMessageBox::Yes) {
-        GameManager::instance().removeGameByPath(path);
+    if (QMessageBox::question(this, "Remove Game", question) == QMessageBox::Yes) {
+        GameManager::instance().removeGames(paths);
     }
 }
 
+void GameListTab::captureSelected() {
+    QList<GameItem> games;
+    const QModelIndexList rows = this->gameTable->selectionModel()->selectedRows();
+    for (const QModelIndex &index : rows) {
+        games.append(proxyModel->data(index, GameRoles::GameItemRole).value<GameItem>());
+    }
+    if (!games.isEmpty()) emit captureRequested(games);
+}
+
 void GameListTab::onRowClicked(const QModelIndex &index) {
     if (!index.isValid()) return;
-    int row = index.row();
+    QModelIndex rowIndex = proxyModel->index(index.row(), 0);
     
     // Logic for index expansion using Index widget mapping
     // QTableView handles this via setIndexWidget natively!
-    if (this->expandedRow == row) {
-        // Collapse
-        this->gameTable->setIndexWidget(proxyModel->index(row, 0), nullptr);
-        this->gameTable->setRowHeight(row, gameTable->verticalHeader()->defaultSectionSize());
-        this->expandedRow = -1;
+    if (this->expandedIndex == rowIndex) {
+        collapseDetail();
         return;
     }
     
     // Collapse old
-    if (this->expandedRow != -1) {
-        this->gameTable->setIndexWidget(proxyModel->index(this->expandedRow, 0), nullptr);
-        this->gameTable->setRowHeight(this->expandedRow, gameTable->verticalHeader()->defaultSectionSize());
-    }
-    
-    GameItem item = proxyModel->data(index, GameRoles::GameItemRole).value<GameItem>();
+    collapseDetail();
+    expandDetail(rowIndex);
+}
+
+void GameListTab::expandDetail(const QModelIndex &rowIndex) {
+    GameItem item = proxyModel->data(rowIndex, GameRoles::GameItemRole).value<GameItem>();
     
     GameDetailWidget *detail = new GameDetailWidget(item);
     connect(detail, &GameDetailWidget::playGame, this, &GameListTab::runGame);
@@ -333,10 +387,19 @@ void GameListTab::onRowClicked(const QModelIndex &index) {
     connect(detail, &GameDetailWidget::requestEdit, this, &GameListTab::onEditGameRequested);
     
     // Expand new row (span across columns inside the index 0)
-    this->gameTable->setIndexWidget(proxyModel->index(row, 0), detail);
-    this->gameTable->setRowHeight(row, 280); 
+    this->gameTable->setIndexWidget(rowIndex, detail);
+    this->gameTable->setRowHeight(rowIndex.row(), 280); 
     
-    this->expandedRow = row;
+    this->expandedIndex = QPersistentModelIndex(rowIndex);
+}
+
+void GameListTab::collapseDetail() {
+    // Invalid if nothing is expanded or the expanded game was removed
+    if (this->expandedIndex.isValid()) {
+        this->gameTable->setIndexWidget(this->expandedIndex, nullptr);
+        this->gameTable->setRowHeight(this->expandedIndex.row(), gameTable->verticalHeader()->defaultSectionSize());
+    }
+    this->expandedIndex = QPersistentModelIndex();
 }
 
 void GameListTab::runGame(QString exePath) {
@@ -345,12 +408,11 @@ void GameListTab::runGame(QString exePath) {
     QFileInfo info(exePath);
     QString workingDir = info.absolutePath();
     
-    QList<GameItem> games = GameManager::instance().getGames();
-    for (const auto &g : games) {
-        if (g.exePath == exePath || g.filePath == exePath) {
-            GameManager::instance().updateLastPlayed(g.filePath);
-            break;
-        }
+    GameManager &manager = GameManager::instance();
+    int row = manager.indexOfExePath(exePath);
+    if (row == -1) row = manager.indexOfPath(exePath);
+    if (row != -1) {
+        manager.updateLastPlayed(manager.getGames().at(row).filePath);
     }
 
     bool success = QProcess::startDetached(exePath, QStringList(), workingDir);
@@ -376,6 +438,16 @@ void GameListTab::onEditGameRequested(QString path) {
     GameInfoDialog dialog(item, this);
     if (dialog.exec() == QDialog::Accepted) {
         GameManager::instance().updateGame(dialog.getGameItem());
+        
+        // The row is updated in place now, so rebuild the open detail widget with the new data.
+        // Deferred because this slot may be running inside that widget's own signal.
+        QTimer::singleShot(0, this, [this, path]() {
+            if (this->expandedIndex.isValid() && this->expandedIndex.data(GameRoles::FilePathRole).toString() == path) {
+                QModelIndex rowIndex = this->expandedIndex;
+                collapseDetail();
+                expandDetail(rowIndex);
+            }
+        });
     }
 }
 
@@ -387,12 +459,55 @@ void GameListTab::onViewToggle() {
         this->viewStack->setCurrentWidget(this->gameTable);
         this->viewToggleBtn->setText("Card View");
         // Reset row expansion if any
-        if (this->expandedRow != -1) {
-            this->gameTable->setIndexWidget(proxyModel->index(this->expandedRow, 0), nullptr);
-            this->gameTable->setRowHeight(this->expandedRow, gameTable->verticalHeader()->defaultSectionSize());
-            this->expandedRow = -1;
-        }
+        collapseDetail();
+    }
+    this->viewportTimer->start();
+}
+
+void GameListTab::updateThumbnailViewport() {
+    const bool cards = this->viewStack->currentWidget() == this->gameListView;
+    const ThumbnailCache::Size size = cards ? ThumbnailCache::Card : ThumbnailCache::Icon;
+    const int count = proxyModel->rowCount();
+    if (count == 0) {
+        ImageProvider::instance().setViewport(size, QStringList(), QStringList());
+        return;
+    }
+
+    // Proxy rows on screen
+    int first = 0;
+    int last = count - 1;
+    if (cards) {
+        const QSize grid = this->gameListView->gridSize();
+        const QRect area = this->gameListView->viewport()->rect();
+        const int columns = qMax(1, area.width() / grid.width());
+        const int rowsShown = area.height() / grid.height() + 2; // Partly visible rows at both edges
+        QModelIndex top = this->gameListView->indexAt(QPoint(grid.width() / 2, grid.height() / 4));
+        first = top.isValid() ? top.row() - top.row() % columns : 0;
+        last = qMin(count - 1, first + rowsShown * columns - 1);
+    } else {
+        const int height = this->gameTable->viewport()->height();
+        first = qMax(0, this->gameTable->rowAt(0));
+        const int bottom = this->gameTable->rowAt(height - 1);
+        last = bottom < 0 ? count - 1 : bottom;
     }
+
+    auto thumbnailAt = [this](int row) {
+        const GameItem *game = libraryModel->gameAt(proxyModel->mapToSource(proxyModel->index(row, 0)).row());
+        return game ? game->thumbnailPath : QString();
+    };
+
+    QStringList visible;
+    for (int row = first; row <= last; ++row) visible.append(thumbnailAt(row));
+
+    // One screen ahead and one behind, nearest first, ahead before behind
+    QStringList prefetch;
+    const int span = last - first + 1;
+    for (int distance = 1; distance <= span; ++distance) {
+        if (last + distance < count) prefetch.append(thumbnailAt(last + distance));
+        if (first - distance >= 0) prefetch.append(thumbnailAt(first - distance));
+    }
+
+    ImageProvider::instance().setViewport(size, visible, prefetch);
 }
 
 void GameListTab::onCardClicked(const QModelIndex &index) {
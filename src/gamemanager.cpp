@@ -1,13 +1,24 @@
 #include "gamemanager.h"
 #include "tagmanager.h"
+#include "librarysnapshot.h"
+#include "thumbnailpreview.h"
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QStandardPaths>
 #include <QDir>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <QtConcurrent>
 #include <QDebug>
 
+// Compact once the active journal holds this many records or bytes
+static const int JOURNAL_COMPACT_RECORDS = 512;
+static const qint64 JOURNAL_COMPACT_BYTES = 4 * 1024 * 1024;
+
 GameManager& GameManager::instance() {
     static GameManager _instance;
     return _instance;
@@ -22,131 +33,638 @@ GameManager::GameManager(QObject *parent) : QObject(parent) {
     if (!dir.exists()) {
         dir.mkpath(".");
     }
-    this->savePath = dir.filePath("games.json");
+    this->savePath = dir.filePath("games.gdb");
+    this->legacyJsonPath = dir.filePath("games.json");
+    this->journal = new LibraryJournal(dir.filePath("games.journal"));
+
+    // One thread is enough and keeps compactions strictly ordered
+    this->compactionPool.setMaxThreadCount(1);
+    connect(&this->compactionWatcher, &QFutureWatcher<bool>::finished, this, [this]() {
+        if (this->compactionWatcher.result()) {
+            this->journal->discardRotated();
+            installPendingSnapshot();
+        }
+        this->compacting = false;
+    });
     
     // Connect TagManager signals for consistency
     connect(&TagManager::instance(), &TagManager::tagRenamed, this, &GameManager::onTagRenamed);
     connect(&TagManager::instance(), &TagManager::tagRemoved, this, &GameManager::onTagRemoved);
+    connect(&TagManager::instance(), &TagManager::tagsMerged, this, &GameManager::onTagsMerged);
     
     loadGames();
 }
 
 GameManager::~GameManager() {
-    saveGames();
+    // Every mutation is already in the journal; just let a running compaction land
+    this->compactionPool.waitForDone();
+    delete this->journal;
 }
 
 void GameManager::addGame(const GameItem &item) {
     // Check for duplicates by path
-    for (const auto &g : library) {
-        if (g.filePath == item.filePath) {
-            // Already exists
-            return;
-        }
+    if (containsPath(item.filePath)) {
+        // Already exists
+        return;
     }
     
-    this->library.append(item);
+    int row = this->library.size();
+    if (this->batchDepth > 0) {
+        if (this->batchInsertFrom == -1) this->batchInsertFrom = row;
+        insertRow(item);
+    } else {
+        emit gamesAboutToBeInserted(row, row);
+        insertRow(item);
+        emit gamesInserted(row, row);
+    }
+
+    appendJournal(QJsonObject{{"op", "add"}, {"game", gameToJson(item, TagManager::instance())}});
     emit gameAdded(item);
-    emit libraryUpdated();
-    saveGames();
 }
 
 void GameManager::updateGame(const GameItem &item) {
-    for (int i = 0; i < this->library.size(); ++i) {
-        if (this->library[i].filePath == item.filePath) {
-            this->library[i] = item;
-            emit libraryUpdated();
-            saveGames();
-            return;
-        }
+    int row = indexOfPath(item.filePath);
+    if (row == -1) return;
+
+    GameItem game = item;
+    // A copy of the game whose thumbnail was swapped still carries the old image's preview
+    const GameItem &before = this->library.at(row);
+    if (game.thumbnailPath != before.thumbnailPath && game.thumbnailPreview == before.thumbnailPreview) {
+        game.thumbnailPreview.clear();
     }
+
+    GameFields fields = changedFields(before, game);
+    replaceRow(row, game);
+    appendJournal(QJsonObject{{"op", "update"}, {"game", gameToJson(game, TagManager::instance())}});
+    notifyRowsChanged(QList<int>() << row, fields);
 }
 
 void GameManager::removeGame(int index) {
     if (index >= 0 && index < this->library.size()) {
-        QString path = this->library[index].filePath;
-        this->library.removeAt(index);
+        QString path = this->library.filePathAt(index);
+        if (this->batchDepth > 0) {
+            recordBatchRemoval(index);
+            removeRow(index);
+        } else {
+            emit gamesAboutToBeRemoved(index, index);
+            removeRow(index);
+            emit gamesRemoved(index, index);
+        }
+        appendJournal(QJsonObject{{"op", "remove"}, {"path", path}});
         emit gameRemoved(path);
-        emit libraryUpdated();
-        saveGames();
     }
 }
 
 void GameManager::removeGameByPath(const QString &path) {
-    for (int i = 0; i < this->library.size(); ++i) {
-        if (this->library[i].filePath == path) {
-            removeGame(i);
-            return;
-        }
+    removeGame(indexOfPath(path));
+}
+
+void GameManager::removeGames(const QStringList &paths) {
+    QList<int> rows;
+    rows.reserve(paths.size());
+    for (const QString &path : paths) {
+        int row = indexOfPath(path);
+        if (row != -1) rows.append(row);
     }
+    // Bottom up, so each removal only leaves rows behind it stale and the indexes
+    // are fixed up once at the end instead of after every game
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    BatchGuard batch(*this);
+    for (int row : rows) removeGame(row);
 }
 
-const QList<GameItem>& GameManager::getGames() const {
+const LibraryTable& GameManager::getGames() const {
     return this->library;
 }
 
-void GameManager::saveGames() {
-    QJsonArray array;
-    for (const auto &game : this->library) {
-        array.append(gameToJson(game));
+bool GameManager::containsPath(const QString &path) const {
+    return this->pathIndex.contains(path);
+}
+
+int GameManager::indexOfPath(const QString &path) const {
+    int row = this->pathIndex.value(path, -1);
+    // Rows at or after staleRowsFrom may still carry their number from before a removal
+    if (this->staleRowsFrom != -1 && row >= this->staleRowsFrom) {
+        reindexStaleRows();
+        row = this->pathIndex.value(path, -1);
     }
-    
-    QJsonObject root;
-    root["games"] = array;
-    
-    QFile file(this->savePath);
-    if (file.open(QIODevice::WriteOnly)) {
-        QJsonDocument doc(root);
-        file.write(doc.toJson());
-        file.close();
+    return row;
+}
+
+int GameManager::indexOfExePath(const QString &exePath) const {
+    if (exePath.isEmpty()) return -1;
+    int row = this->exeIndex.value(exePath, -1);
+    if (this->staleRowsFrom != -1 && row >= this->staleRowsFrom) {
+        reindexStaleRows();
+        row = this->exeIndex.value(exePath, -1);
+    }
+    return row;
+}
+
+QList<int> GameManager::rowsForThumbnail(const QString &thumbnailPath) const {
+    if (thumbnailPath.isEmpty()) return QList<int>();
+    reindexStaleRows();
+    return this->thumbnailIndex.values(thumbnailPath);
+}
+
+int GameManager::tagCount(const QString &tag) const {
+    return tagCount(TagManager::instance().findTagId(tag));
+}
+
+int GameManager::tagCount(int tagId) const {
+    auto it = this->tagIndex.constFind(tagId);
+    return it != this->tagIndex.constEnd() ? it.value().size() : 0;
+}
+
+QStringList GameManager::pathsInDirectory(const QString &dir) const {
+    return this->dirIndex.values(dir);
+}
+
+QStringList GameManager::libraryDirectories() const {
+    return this->dirIndex.uniqueKeys();
+}
+
+QString GameManager::parentDirectory(const QString &path) {
+    // String-only (no QFileInfo) since it runs for every game on load
+    int slash = path.lastIndexOf('/');
+    if (slash == -1) return QString();
+    if (slash == 0) return QStringLiteral("/");
+    if (path.at(slash - 1) == ':') return path.left(slash + 1); // Drive root, "C:/"
+    return path.left(slash);
+}
+
+bool GameManager::isMissing(const QString &path) const {
+    return this->missingPaths.contains(path);
+}
+
+void GameManager::setMissing(const QString &path, bool missing) {
+    int row = indexOfPath(path);
+    if (row == -1) return;
+    if (missing == this->missingPaths.contains(path)) return;
+
+    if (missing) {
+        this->missingPaths.insert(path);
     } else {
-        qDebug() << "Failed to save games to" << this->savePath;
+        this->missingPaths.remove(path);
     }
+    notifyRowsChanged(QList<int>() << row, GameField::Missing);
+}
+
+void GameManager::verifyPaths() {
+    QStringList paths = this->pathIndex.keys();
+    QThreadPool::globalInstance()->start([this, paths]() {
+        // One stat per game; on a slow or unplugged drive this can take a while
+        QSet<QString> missing;
+        for (const QString &path : paths) {
+            if (!QFileInfo::exists(path)) missing.insert(path);
+        }
+        QMetaObject::invokeMethod(this, [this, missing]() {
+            BatchGuard batch(*this);
+            const QSet<QString> wasMissing = this->missingPaths;
+            for (const QString &path : wasMissing) {
+                if (!missing.contains(path)) setMissing(path, false);
+            }
+            for (const QString &path : missing) setMissing(path, true);
+        }, Qt::QueuedConnection);
+    });
+}
+
+// Indexing reads single fields, so rows still in the snapshot stay undecoded
+void GameManager::indexRow(int row) {
+    if (this->staleRowsFrom != -1 && row >= this->staleRowsFrom) reindexStaleRows();
+    const QString filePath = this->library.filePathAt(row);
+    const QString exePath = this->library.exePathAt(row);
+    const QString thumbnailPath = this->library.thumbnailPathAt(row);
+    this->pathIndex.insert(filePath, row);
+    this->dirIndex.insert(parentDirectory(filePath), filePath);
+    if (!exePath.isEmpty()) this->exeIndex.insert(exePath, row);
+    if (!thumbnailPath.isEmpty()) this->thumbnailIndex.insert(thumbnailPath, row);
+
+    const QList<int> tagIds = this->library.tagIdsAt(row);
+    if (!tagIds.isEmpty()) {
+        for (int id : tagIds) this->tagIndex[id].insert(filePath);
+        scheduleTagCountsChanged();
+    }
+}
+
+void GameManager::unindexRow(int row) {
+    if (this->staleRowsFrom != -1 && row >= this->staleRowsFrom) reindexStaleRows();
+    const QString filePath = this->library.filePathAt(row);
+    this->pathIndex.remove(filePath);
+    this->dirIndex.remove(parentDirectory(filePath), filePath);
+    this->exeIndex.remove(this->library.exePathAt(row), row);
+    this->thumbnailIndex.remove(this->library.thumbnailPathAt(row), row);
+
+    const QList<int> tagIds = this->library.tagIdsAt(row);
+    if (!tagIds.isEmpty()) {
+        for (int id : tagIds) {
+            auto it = this->tagIndex.find(id);
+            if (it == this->tagIndex.end()) continue;
+            it.value().remove(filePath);
+            if (it.value().isEmpty()) this->tagIndex.erase(it);
+        }
+        scheduleTagCountsChanged();
+    }
+}
+
+void GameManager::rebuildIndexes() {
+    this->staleRowsFrom = -1;
+    this->pathIndex.clear();
+    this->exeIndex.clear();
+    this->thumbnailIndex.clear();
+    this->tagIndex.clear();
+    this->dirIndex.clear();
+    this->pathIndex.reserve(this->library.size());
+    for (int i = 0; i < this->library.size(); ++i) {
+        indexRow(i);
+    }
+}
+
+void GameManager::insertRow(const GameItem &item) {
+    this->library.append(item);
+    indexRow(this->library.size() - 1);
+}
+
+void GameManager::replaceRow(int row, const GameItem &item) {
+    unindexRow(row);
+    this->library.replace(row, item);
+    indexRow(row);
+}
+
+void GameManager::removeRow(int row) {
+    this->missingPaths.remove(this->library.filePathAt(row));
+    unindexRow(row);
+    this->library.removeAt(row);
+
+    // Everything behind the removed row moved up by one. Renumbered on the next lookup
+    // that needs it, so removing many games bottom up renumbers once rather than per game.
+    if (row < this->library.size()) this->staleRowsFrom = row;
+}
+
+void GameManager::reindexStaleRows() const {
+    const int from = this->staleRowsFrom;
+    if (from == -1) return;
+    this->staleRowsFrom = -1;
+
+    auto dropStale = [from](QMultiHash<QString, int> &index) {
+        for (auto it = index.begin(); it != index.end();) {
+            if (it.value() >= from) it = index.erase(it);
+            else ++it;
+        }
+    };
+    dropStale(this->exeIndex);
+    dropStale(this->thumbnailIndex);
+    for (int i = from; i < this->library.size(); ++i) {
+        const QString exePath = this->library.exePathAt(i);
+        const QString thumbnailPath = this->library.thumbnailPathAt(i);
+        this->pathIndex.insert(this->library.filePathAt(i), i);
+        if (!exePath.isEmpty()) this->exeIndex.insert(exePath, i);
+        if (!thumbnailPath.isEmpty()) this->thumbnailIndex.insert(thumbnailPath, i);
+    }
+}
+
+void GameManager::saveGames() {
+    if (this->snapshotBlocked) return;
+    // Don't race a background compaction writing the same file
+    this->compactionPool.waitForDone();
+
+    if (LibrarySnapshot::write(this->savePath + ".new", this->library.toList(), TagManager::instance().tagDictionary())) {
+        this->journal->reset();
+        installPendingSnapshot();
+    }
+}
+
+void GameManager::installPendingSnapshot() {
+    // Snapshots are written next to the mapped one. Unix lets the mapped file be replaced
+    // (the mapping keeps the old inode); Windows refuses, so there the new one waits for the
+    // next start, where loadGames() installs it before anything is mapped.
+    const QString pending = this->savePath + ".new";
+    if (!QFile::exists(pending)) return;
+    if (QFile::exists(this->savePath) && !QFile::remove(this->savePath)) return;
+    QFile::rename(pending, this->savePath);
+}
+
+QList<int> GameManager::rowsForTag(int tagId) const {
+    QList<int> rows;
+    const QSet<QString> paths = this->tagIndex.value(tagId);
+    rows.reserve(paths.size());
+    for (const QString &path : paths) {
+        int row = indexOfPath(path);
+        if (row != -1) rows.append(row);
+    }
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+void GameManager::moveTag(int fromId, int intoId) {
+    if (fromId == -1 || fromId == intoId) return;
+
+    const QSet<QString> paths = this->tagIndex.take(fromId);
+    if (paths.isEmpty()) return;
+
+    QSet<QString> &into = this->tagIndex[intoId];
+    for (const QString &path : paths) {
+        int row = indexOfPath(path);
+        if (row == -1) continue;
+        this->library[row].tags.replace(fromId, intoId);
+        into.insert(path);
+    }
+    scheduleTagCountsChanged();
+}
+
+QList<int> GameManager::dropTag(int tagId) {
+    QList<int> rows = rowsForTag(tagId);
+    if (rows.isEmpty()) return rows;
+
+    for (int row : rows) {
+        this->library[row].tags.remove(tagId);
+    }
+    this->tagIndex.remove(tagId);
+    scheduleTagCountsChanged();
+    return rows;
+}
+
+void GameManager::scheduleTagCountsChanged() {
+    if (this->tagCountsPending) return;
+    this->tagCountsPending = true;
+    QMetaObject::invokeMethod(this, [this]() {
+        this->tagCountsPending = false;
+        emit tagCountsChanged();
+    }, Qt::QueuedConnection);
+}
+
+void GameManager::beginBatch() {
+    ++this->batchDepth;
+}
+
+void GameManager::commitBatch() {
+    if (this->batchDepth == 0) return;
+    if (--this->batchDepth > 0) return;
+
+    // Persist once
+    if (!this->batchRecords.isEmpty()) {
+        this->journal->append(this->batchRecords);
+        this->batchRecords.clear();
+        if (this->journal->recordCount() >= JOURNAL_COMPACT_RECORDS || this->journal->size() >= JOURNAL_COMPACT_BYTES) {
+            compactJournal();
+        }
+    }
+
+    // Notify once. Removed rows go first, as contiguous ranges from the bottom so each range
+    // is still numbered the way receivers know it; appends then follow as one range.
+    for (int i = this->batchRemoved.size() - 1; i >= 0; --i) {
+        const int last = this->batchRemoved[i];
+        int first = last;
+        while (i > 0 && this->batchRemoved[i - 1] == first - 1) {
+            --i;
+            --first;
+        }
+        emit gamesAboutToBeRemoved(first, last);
+        emit gamesRemoved(first, last);
+    }
+
+    if (this->batchInsertFrom != -1) {
+        int last = this->library.size() - 1;
+        emit gamesAboutToBeInserted(this->batchInsertFrom, last);
+        emit gamesInserted(this->batchInsertFrom, last);
+    }
+
+    QList<int> rows;
+    GameFields fields;
+    for (auto it = this->batchChanges.constBegin(); it != this->batchChanges.constEnd(); ++it) {
+        // Games removed later in the batch are gone; rows appended in it are new to receivers anyway
+        int row = indexOfPath(it.key());
+        if (row == -1 || (this->batchInsertFrom != -1 && row >= this->batchInsertFrom)) continue;
+        rows.append(row);
+        fields |= it.value();
+    }
+    if (!rows.isEmpty()) {
+        std::sort(rows.begin(), rows.end());
+        emit gamesChanged(rows, fields);
+    }
+
+    this->batchChanges.clear();
+    this->batchInsertFrom = -1;
+    this->batchRemoved.clear();
+}
+
+void GameManager::recordBatchRemoval(int row) {
+    if (this->batchInsertFrom != -1 && row >= this->batchInsertFrom) {
+        // Appended in this batch, so never announced; just one fewer to announce
+        if (this->library.size() - this->batchInsertFrom == 1) this->batchInsertFrom = -1;
+        return;
+    }
+
+    // Back to the number receivers know: skip over the rows removed before it
+    int original = row;
+    for (int removed : std::as_const(this->batchRemoved)) {
+        if (removed > original) break;
+        ++original;
+    }
+    this->batchRemoved.insert(std::lower_bound(this->batchRemoved.begin(), this->batchRemoved.end(), original), original);
+    if (this->batchInsertFrom != -1) --this->batchInsertFrom;
+}
+
+void GameManager::notifyRowsChanged(const QList<int> &rows, GameFields fields) {
+    if (!fields) return;
+
+    if (this->batchDepth > 0) {
+        for (int row : rows) this->batchChanges[this->library.filePathAt(row)] |= fields;
+        return;
+    }
+    emit gamesChanged(rows, fields);
+}
+
+GameFields GameManager::changedFields(const GameItem &before, const GameItem &after) {
+    GameFields fields;
+    if (before.cleanName != after.cleanName || before.originalName != after.originalName) fields |= GameField::Name;
+    if (before.folderName != after.folderName) fields |= GameField::FolderName;
+    if (before.type != after.type) fields |= GameField::Type;
+    if (before.koreanSupport != after.koreanSupport) fields |= GameField::Korean;
+    if (before.tags != after.tags) fields |= GameField::Tags;
+    if (before.lastPlayed != after.lastPlayed) fields |= GameField::LastPlayed;
+    if (before.filePath != after.filePath || before.exePath != after.exePath) fields |= GameField::Path;
+    if (before.thumbnailPath != after.thumbnailPath || before.thumbnailPreview != after.thumbnailPreview) fields |= GameField::Thumbnail;
+    if (before.source != after.source || before.gameCode != after.gameCode) fields |= GameField::Metadata;
+    if (before.contentSize != after.contentSize || before.contentFiles != after.contentFiles
+        || before.contentExecutables != after.contentExecutables || before.volumeLabel != after.volumeLabel) fields |= GameField::Contents;
+    return fields;
+}
+
+void GameManager::appendJournal(const QJsonObject &record) {
+    if (this->batchDepth > 0) {
+        this->batchRecords.append(record);
+        return;
+    }
+
+    this->journal->append(record);
+
+    if (this->journal->recordCount() >= JOURNAL_COMPACT_RECORDS || this->journal->size() >= JOURNAL_COMPACT_BYTES) {
+        compactJournal();
+    }
+}
+
+void GameManager::compactJournal() {
+    // Records written while a compaction runs stay in the active segment for the next one
+    if (this->compacting || this->snapshotBlocked) return;
+    if (!this->journal->rotate()) return;
+    this->compacting = true;
+
+    // The table is implicitly shared, so the copy is cheap until the GUI thread mutates again.
+    // Rows still in the mapped snapshot are decoded on the worker.
+    LibraryTable snapshot = this->library;
+    QString path = this->savePath + ".new";
+    QStringList tagDictionary = TagManager::instance().tagDictionary();
+    this->compactionWatcher.setFuture(QtConcurrent::run(&this->compactionPool, [path, snapshot, tagDictionary]() {
+        return LibrarySnapshot::write(path, snapshot.toList(), tagDictionary);
+    }));
 }
 
 void GameManager::loadGames() {
-    QFile file(this->savePath);
+    this->library.clear();
+    installPendingSnapshot();
+
+    // The snapshot is mapped, not parsed, and stays mapped as the backing store of the rows;
+    // a row is only decoded once something reads it
+    bool migrated = false;
+    auto snapshot = std::make_shared<LibrarySnapshot>();
+    const QString corruptPath = this->savePath + ".corrupt";
+    if (snapshot->open(this->savePath)) {
+        // Once, here, so copies of the table can decode rows on worker threads
+        snapshot->resolveTags();
+        this->library = LibraryTable(snapshot);
+        this->snapshotBlocked = false;
+    } else if (QFile::exists(this->savePath)) {
+        // games.json is older than the snapshot, so it isn't a fallback. The damaged file is
+        // kept for recovery, and nothing rewrites the snapshot until one loads again; the
+        // journal keeps collecting every change meanwhile.
+        QString aside = corruptPath;
+        for (int n = 1; QFile::exists(aside); ++n) aside = corruptPath + '.' + QString::number(n);
+        QFile::rename(this->savePath, aside);
+        qDebug() << "Library snapshot is damaged, moved to" << aside << "- compaction is off until a snapshot loads";
+        this->snapshotBlocked = true;
+    } else if (QFile::exists(corruptPath)) {
+        // Moved aside in an earlier session and not restored yet
+        qDebug() << "Library snapshot was damaged and is still at" << corruptPath << "- compaction stays off";
+        this->snapshotBlocked = true;
+    } else if (QFile::exists(this->legacyJsonPath)) {
+        loadLegacyJson();
+        migrated = true;
+    }
+    rebuildIndexes();
+
+    // Replay everything that happened after the snapshot was taken
+    const QList<QJsonObject> records = this->journal->readAll();
+    for (const QJsonObject &record : records) {
+        applyJournalRecord(record);
+    }
+    if (migrated || !records.isEmpty()) {
+        compactJournal();
+    }
+
+
+    emit libraryUpdated();
+}
+
+void GameManager::loadLegacyJson() {
+    // games.json is left in place as a backup; from now on games.gdb is authoritative
+    QFile file(this->legacyJsonPath);
     if (!file.open(QIODevice::ReadOnly)) {
-        return; // File doesn't exist yet
+        return;
     }
-    
+
     QByteArray data = file.readAll();
     file.close();
-    
+
     QJsonDocument doc = QJsonDocument::fromJson(data);
     QJsonObject root = doc.object();
-    
-    this->library.clear();
+
     if (root.contains("games") && root["games"].isArray()) {
         QJsonArray array = root["games"].toArray();
         for (const auto &val : array) {
-            this->library.append(jsonToGame(val.toObject()));
+            this->library.append(jsonToGame(val.toObject(), TagManager::instance()));
         }
     }
-    
-    emit libraryUpdated();
 }
 
-GameItem GameManager::getGameByPath(const QString &path) const {
-    for (const auto &game : this->library) {
-        if (game.filePath == path) {
-            return game;
+void GameManager::applyJournalRecord(const QJsonObject &record) {
+    // Records must stay idempotent: a segment may be replayed on top of a snapshot that already has it
+    const QString op = record["op"].toString();
+
+    if (op == "add" || op == "update") {
+        GameItem item = jsonToGame(record["game"].toObject(), TagManager::instance());
+        int row = indexOfPath(item.filePath);
+        if (row != -1) {
+            replaceRow(row, item);
+        } else if (op == "add") {
+            insertRow(item);
         }
+    } else if (op == "remove") {
+        int row = indexOfPath(record["path"].toString());
+        if (row != -1) {
+            removeRow(row);
+        }
+    } else if (op == "played") {
+        int row = indexOfPath(record["path"].toString());
+        if (row != -1) {
+            this->library[row].lastPlayed = QDateTime::fromString(record["time"].toString(), Qt::ISODate);
+        }
+    } else if (op == "preview") {
+        int row = indexOfPath(record["path"].toString());
+        const QByteArray code = QByteArray::fromBase64(record["code"].toString().toLatin1());
+        if (row != -1 && ThumbnailPreview::isValid(code)) {
+            this->library[row].thumbnailPreview = code;
+        }
+    } else if (op == "renameTag") {
+        // Games loaded from the snapshot still carry the old name under its own id
+        int from = TagManager::instance().findTagId(record["from"].toString());
+        if (from == -1) return;
+        moveTag(from, TagManager::instance().tagId(record["to"].toString()));
+    } else if (op == "removeTag") {
+        int id = TagManager::instance().findTagId(record["tag"].toString());
+        if (id != -1) dropTag(id);
+    } else {
+        qDebug() << "Unknown journal record" << op;
     }
-    return GameItem(); // Return empty item if not found
+}
+
+GameItem GameManager::getGameByPath(const QString &path) const {
+    int row = indexOfPath(path);
+    if (row == -1) {
+        return GameItem(); // Return empty item if not found
+    }
+    return this->library[row];
 }
 
 void GameManager::updateLastPlayed(const QString &path) {
-    for (int i = 0; i < library.size(); ++i) {
-        if (library[i].filePath == path) {
-            library[i].lastPlayed = QDateTime::currentDateTime();
-            saveGames();
-            emit libraryUpdated(); // Or emit a specific signal if needed
-            return;
+    int row = indexOfPath(path);
+    if (row == -1) return;
+
+    library[row].lastPlayed = QDateTime::currentDateTime();
+    appendJournal(QJsonObject{{"op", "played"}, {"path", path}, {"time", library[row].lastPlayed.toString(Qt::ISODate)}});
+    notifyRowsChanged(QList<int>() << row, GameField::LastPlayed);
+}
+
+void GameManager::setThumbnailPreviews(const QHash<QString, QByteArray> &previews) {
+    BatchGuard batch(*this);
+    for (auto it = previews.constBegin(); it != previews.constEnd(); ++it) {
+        if (!ThumbnailPreview::isValid(it.value())) continue;
+        QList<int> rows;
+        for (int row : rowsForThumbnail(it.key())) {
+            if (!this->library[row].thumbnailPreview.isEmpty()) continue;
+            // Not indexed, so no replaceRow(); and a few dozen bytes of journal, not the whole game
+            this->library[row].thumbnailPreview = it.value();
+            appendJournal(QJsonObject{{"op", "preview"}, {"path", this->library[row].filePath},
+                                      {"code", QString::fromLatin1(it.value().toBase64())}});
+            rows.append(row);
         }
+        notifyRowsChanged(rows, GameField::Thumbnail);
     }
 }
 
-QJsonObject GameManager::gameToJson(const GameItem &item) {
+QJsonObject GameManager::gameToJson(const GameItem &item, const TagManager &tags) {
     QJsonObject obj;
     obj["originalName"] = item.originalName;
     obj["cleanName"] = item.cleanName;
@@ -156,24 +674,36 @@ QJsonObject GameManager::gameToJson(const GameItem &item) {
     obj["folderName"] = item.folderName;
     
     QJsonArray tagArray;
-    for (const QString &tag : item.tags) {
-        tagArray.append(tag);
+    const QList<int> tagIds = item.tags.ids();
+    for (int id : tagIds) {
+        const QString name = tags.tagName(id);
+        if (!name.isEmpty()) tagArray.append(name);
     }
     obj["tags"] = tagArray;
     
     obj["source"] = item.source;
     obj["gameCode"] = item.gameCode;
     obj["thumbnailPath"] = item.thumbnailPath;
+    if (!item.thumbnailPreview.isEmpty()) {
+        obj["thumbnailPreview"] = QString::fromLatin1(item.thumbnailPreview.toBase64());
+    }
     obj["exePath"] = item.exePath;
     
     if (item.lastPlayed.isValid()) {
         obj["lastPlayed"] = item.lastPlayed.toString(Qt::ISODate);
     }
 
+    if (item.contentFiles > 0 || !item.volumeLabel.isEmpty()) {
+        obj["contentSize"] = static_cast<double>(item.contentSize);
+        obj["contentFiles"] = item.contentFiles;
+        obj["contentExecutables"] = QJsonArray::fromStringList(item.contentExecutables);
+        obj["volumeLabel"] = item.volumeLabel;
+    }
+
     return obj;
 }
 
-GameItem GameManager::jsonToGame(const QJsonObject &obj) {
+GameItem GameManager::jsonToGame(const QJsonObject &obj, TagManager &tags) {
     GameItem item;
     item.originalName = obj["originalName"].toString();
     item.cleanName = obj["cleanName"].toString();
@@ -184,13 +714,21 @@ GameItem GameManager::jsonToGame(const QJsonObject &obj) {
     
     QJsonArray tagArray = obj["tags"].toArray();
     for (const QJsonValue &val : tagArray) {
-        item.tags.append(val.toString());
+        item.tags.insert(tags.tagId(val.toString()));
     }
     
     item.source = obj["source"].toString();
     item.gameCode = obj["gameCode"].toString();
     item.thumbnailPath = obj["thumbnailPath"].toString();
+    item.thumbnailPreview = QByteArray::fromBase64(obj["thumbnailPreview"].toString().toLatin1());
+    if (!ThumbnailPreview::isValid(item.thumbnailPreview)) item.thumbnailPreview.clear();
     item.exePath = obj["exePath"].toString();
+    item.contentSize = static_cast<qint64>(obj["contentSize"].toDouble());
+    item.contentFiles = obj["contentFiles"].toInt();
+    for (const QJsonValue &val : obj["contentExecutables"].toArray()) {
+        item.contentExecutables.append(val.toString());
+    }
+    item.volumeLabel = obj["volumeLabel"].toString();
     
     if (obj.contains("lastPlayed")) {
         item.lastPlayed = QDateTime::fromString(obj["lastPlayed"].toString(), Qt::ISODate);
@@ -200,32 +738,25 @@ GameItem GameManager::jsonToGame(const QJsonObject &obj) {
 }
 
 void GameManager::onTagRenamed(const QString &oldTag, const QString &newTag) {
-    bool changed = false;
-    for (GameItem &game : this->library) {
-        if (game.tags.contains(oldTag)) {
-            int idx = game.tags.indexOf(oldTag);
-            game.tags.replace(idx, newTag);
-            changed = true;
-        }
-    }
+    // The id keeps pointing at the tag, so games need no rewrite; only views have to refresh
+    QList<int> changedRows = rowsForTag(TagManager::instance().findTagId(newTag));
     
-    if (changed) {
-        saveGames();
-        emit libraryUpdated();
+    if (!changedRows.isEmpty()) {
+        appendJournal(QJsonObject{{"op", "renameTag"}, {"from", oldTag}, {"to", newTag}});
+        notifyRowsChanged(changedRows, GameField::Tags);
     }
 }
 
+void GameManager::onTagsMerged(int fromId, int intoId) {
+    // Rows are reported by the tagRenamed that follows
+    moveTag(fromId, intoId);
+}
+
 void GameManager::onTagRemoved(const QString &tag) {
-    bool changed = false;
-    for (GameItem &game : this->library) {
-        if (game.tags.contains(tag)) {
-            game.tags.removeAll(tag);
-            changed = true;
-        }
-    }
+    QList<int> changedRows = dropTag(TagManager::instance().findTagId(tag));
     
-    if (changed) {
-        saveGames();
-        emit libraryUpdated();
+    if (!changedRows.isEmpty()) {
+        appendJournal(QJsonObject{{"op", "removeTag"}, {"tag", tag}});
+        notifyRowsChanged(changedRows, GameField::Tags);
     }
 }
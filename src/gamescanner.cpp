@@ -1,64 +1,143 @@
 #include "gamescanner.h"
+#include "archivereader.h"
+#include "titlenormalizer.h"
 #include <QDebug>
+#include <atomic>
 
-GameScanner::GameScanner(QObject *parent) : QObject(parent) {
+GameScanner::GameScanner(QObject *parent) : QObject(parent), enumerator(DirectoryEnumerator::create()) {
+    this->pool.setMaxThreadCount(QThread::idealThreadCount());
+}
 
+void GameScanner::setDetector(const GameFolderDetector &detector) {
+    this->detector = detector;
 }
 
 void GameScanner::scanDirectory(const QString &path) {
-    QDir dir(path);
-    if (!dir.exists()) return;
-
-    QFileInfoList list = dir.entryInfoList(QDir::NoDotAndDotDot | QDir::Files | QDir::Dirs | QDir::NoSymLinks);
-
-    for (const QFileInfo &info : list) {
-        if (info.isDir()) {
-            // Check if this directory itself is a game
-            // For now, if it contains an executable or is a leaf node, we might consider it.
-            // But let's stick to the user's request: "find games within subdirectories".
-            // Implementation detail: Deep scan.
-            
-            // Simple heuristic: If it looks like a game folder, add it.
-            // For now, let's treat every folder as a potential game container and recurse,
-            // BUT also check if the folder ITSELF is the game.
-            // A simple strategy: Treat all leaf folders or folders with archives/exes as games?
-            // "compressed files AND sub directory games"
-            
-            // Current Strategy:
-            // 1. Recurse.
-            // 2. Also process the folder itself if it matches criteria (TODO: finer criteria).
-            // For the first version, let's just recurse and find COMPRESSED files, 
-            // and treating immediate sub-folders of the Root as games? 
-            // Or just List all folders?
-            
-            // Non-recursive scan.
-            // Just add the folder itself if it's a directory.
-            processEntry(info);
-
-        } else {
-            processEntry(info);
-        }
+    if (!QDir(path).exists()) return;
+
+    // Collected first so the GUI gets one event instead of one per entry
+    QList<GameItem> items = listDirectory(path);
+    if (!items.isEmpty()) {
+        emit gamesFound(items);
     }
     emit scanFinished();
 }
 
-void GameScanner::processEntry(const QFileInfo &info) {
-    GameType type = determineType(info);
-    if (type == GameType::Unknown) return;
+void GameScanner::rescanDirectories(const QStringList &paths) {
+    for (const QString &path : paths) {
+        ScanIndex::DirRecord record;
+        const QList<GameItem> items = listDirectory(path, &record);
+        emit directoryScanned(path, items, record);
+    }
+}
+
+void GameScanner::checkPaths(const QStringList &paths) {
+    // One stat each; on a slow or unplugged drive this is where the wait goes
+    QStringList missing;
+    QStringList present;
+    for (const QString &path : paths) {
+        if (QFileInfo::exists(path)) present.append(path);
+        else missing.append(path);
+    }
+    emit pathsChecked(missing, present);
+}
+
+QList<GameItem> GameScanner::listDirectory(const QString &path, ScanIndex::DirRecord *record) {
+    QList<GameItem> items;
+    // Stat before listing: a change in between then shows up as a newer mtime next time
+    qint64 mtime = 0;
+    quint64 inode = 0;
+    if (record && !ScanIndex::statDirectory(path, mtime, inode)) return items;
+    if (!this->enumerator->list(path, this->listing)) return items;
+
+    // Non-recursive scan: folders and archives directly inside path
+    const QString prefix = path.endsWith('/') ? path : path + '/';
+    items.reserve(this->listing.size());
+    for (const DirectoryEnumerator::Entry &entry : this->listing) {
+        GameItem item;
+        if (itemForEntry(prefix, entry, item)) items.append(item);
+    }
+
+    // Subfolders are probed and archives read in parallel, so one slow entry doesn't hold up the rest.
+    // Each worker pulls the next entry and keeps one enumerator (and its buffer) for all of them.
+    const GameFolderDetector &detector = this->detector;
+    QVector<ScanIndex::FileStamp> stamps(items.size());
+    QVector<bool> stamped(items.size(), false);
+    std::atomic<int> next(0);
+    const int workers = qMin(this->pool.maxThreadCount(), int(items.size()));
+    for (int w = 0; w < workers; ++w) {
+        this->pool.start([&items, &stamps, &stamped, &next, &detector]() {
+            std::unique_ptr<DirectoryEnumerator> enumerator(DirectoryEnumerator::create());
+            for (int i = next++; i < items.size(); i = next++) {
+                GameItem &item = items[i];
+                if (item.type == GameType::Directory) {
+                    classifyFolder(detector.detect(item.filePath, *enumerator), item);
+                } else if (ArchiveReader::isArchive(item.type)) {
+                    stamped[i] = readArchive(item, stamps[i]);
+                }
+            }
+        });
+    }
+    this->pool.waitForDone();
 
-    GameItem item;
-    item.filePath = info.absoluteFilePath();
-    item.originalName = info.fileName();
+    if (record) {
+        // Same shape as DirectoryWalker's records, so the next walk can reuse it
+        record->mtime = mtime;
+        record->inode = inode;
+        for (const DirectoryEnumerator::Entry &entry : this->listing) {
+            if (entry.isDir) record->subdirs.append(prefix + entry.name);
+        }
+        for (int i = 0; i < items.size(); ++i) {
+            const GameItem &item = items[i];
+            if (item.type == GameType::Directory || item.type == GameType::Folder) continue;
+            record->items.append(item);
+            if (stamped[i]) record->archives.insert(item.filePath, stamps[i]);
+        }
+        record->self.type = GameType::Directory;
+        const int slash = path.lastIndexOf('/');
+        itemForEntry(path.left(slash + 1), DirectoryEnumerator::Entry{path.mid(slash + 1), true}, record->self);
+        const GameFolderDetector::Detection found = this->detector.detect(path, this->listing, *this->enumerator);
+        classifyFolder(found, record->self);
+        record->probed = found.probed;
+    }
+    return items;
+}
+
+bool GameScanner::itemForEntry(const QString &prefix, const DirectoryEnumerator::Entry &entry, GameItem &item) {
+    GameType type = determineType(entry.name, entry.isDir);
+    if (type == GameType::Unknown) return false;
+
+    item.filePath = prefix + entry.name;
+    item.originalName = entry.name;
     item.type = type;
-    item.cleanName = cleanGameName(item.originalName);
 
-    emit gameFound(item);
+    // Code and source come from the name too, so library entries start with them filled in
+    TitleNormalizer::Result title = TitleNormalizer::instance().normalize(entry.name, !entry.isDir);
+    item.cleanName = title.cleanName;
+    item.gameCode = title.gameCode;
+    item.source = title.source;
+    return true;
+}
+
+bool GameScanner::readArchive(GameItem &item, ScanIndex::FileStamp &stamp) {
+    // Stat first: a rewrite during the read then shows up as a newer stamp next time
+    const bool stamped = ScanIndex::statFile(item.filePath, stamp);
+    ArchiveReader::apply(ArchiveReader::read(item.filePath, item.type), item);
+    return stamped;
+}
+
+void GameScanner::classifyFolder(const GameFolderDetector::Detection &found, GameItem &item) {
+    item.type = found.isGame ? GameType::Folder : GameType::Directory;
+    item.exePath = found.exePath;
 }
 
-GameType GameScanner::determineType(const QFileInfo &info) {
-    if (info.isDir()) return GameType::Folder;
+GameType GameScanner::determineType(const QString &name, bool isDir) {
+    if (isDir) return GameType::Directory;
     
-    QString suffix = info.suffix().toLower();
+    // Same as QFileInfo::suffix(), without touching the filesystem
+    int lastDot = name.lastIndexOf('.');
+    if (lastDot < 0) return GameType::Unknown;
+    QString suffix = name.mid(lastDot + 1).toLower();
     if (suffix == "zip") return GameType::Zip;
     if (suffix == "7z") return GameType::SevenZip;
     if (suffix == "rar") return GameType::Rar;
@@ -66,26 +145,3 @@ GameType GameScanner::determineType(const QFileInfo &info) {
     
     return GameType::Unknown;
 }
-
-QString GameScanner::cleanGameName(const QString &name) {
-    QString clean = name;
-    
-    // Remove extension if file
-    int lastDot = clean.lastIndexOf('.');
-    if (lastDot > 0) clean = clean.left(lastDot);
-
-    // Common scene release patterns removal
-    // e.g. (USA), [JP], v1.0, etc.
-    
-    // Remove brackets [] and () and content within
-    static QRegularExpression re("\\[.*?\\]|\\(.*?\\)");
-    clean.replace(re, "");
-    
-    // Remove underscores
-    clean = clean.replace("_", " ");
-    
-    // Trim extra spaces
-    clean = clean.simplified();
-    
-    return clean;
-}
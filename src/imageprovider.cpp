@@ -1,9 +1,28 @@
 #include "imageprovider.h"
-#include <QtConcurrent>
-#include <QFutureWatcher>
+#include "thumbnailpreview.h"
 #include <QPixmap>
 #include <QColor>
 #include <QPainter>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent>
+
+// GUI time spent turning decoded images into pixmaps per event-loop pass
+static const qint64 CONVERSION_BUDGET_MS = 8;
+
+// Pixel data kept in the pack; the smallest thumbnails win when it's full
+static const qint64 PACK_BUDGET_BYTES = 256 * 1024 * 1024;
+// New decodes are packed after this much quiet, or as soon as they add up to PACK_FLUSH_BYTES
+static const int PACK_DELAY_MS = 5000;
+static const qint64 PACK_FLUSH_BYTES = 32 * 1024 * 1024;
+// Flushes append to the pack; it is rewritten once replaced and dropped images make up
+// this share of it, or it would pass PACK_BUDGET_BYTES
+static const double PACK_COMPACT_DEAD_RATIO = 0.25;
+
+static const ThumbnailCache::Size ALL_SIZES[] = {ThumbnailCache::Icon, ThumbnailCache::Preview, ThumbnailCache::Card};
 
 ImageProvider& ImageProvider::instance() {
     static ImageProvider _instance;
@@ -18,49 +37,259 @@ ImageProvider::ImageProvider(QObject *parent) : QObject(parent) {
     
     // Increase cache size if needed (default usually 10MB, set to 50MB for thumbnails)
     QPixmapCache::setCacheLimit(50 * 1024);
+
+    connect(&this->loader, &ThumbnailLoader::loaded, this, &ImageProvider::onLoaded);
+
+    // Zero interval: runs once the queued completions of this pass have all arrived
+    this->conversionTimer.setSingleShot(true);
+    this->conversionTimer.setInterval(0);
+    connect(&this->conversionTimer, &QTimer::timeout, this, &ImageProvider::convertBatch);
+
+    QString dataLocation = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    this->packPath = QDir(dataLocation).filePath("thumbnails/thumbnails.pack");
+    QDir().mkpath(QFileInfo(this->packPath).absolutePath());
+
+    // A pack written just before the last exit that never got swapped in
+    const QString newPath = this->packPath + ".new";
+    if (QFile::exists(newPath)) {
+        QFile::remove(this->packPath);
+        QFile::rename(newPath, this->packPath);
+    }
+    this->pack.open(this->packPath);
+
+    this->packPool.setMaxThreadCount(1);
+    this->previewPool.setMaxThreadCount(1);
+    this->packTimer.setSingleShot(true);
+    this->packTimer.setInterval(PACK_DELAY_MS);
+    connect(&this->packTimer, &QTimer::timeout, this, &ImageProvider::flushPack);
+    connect(&this->packWatcher, &QFutureWatcher<bool>::finished, this, &ImageProvider::onPackWritten);
+}
+
+ImageProvider::~ImageProvider() {
+    // The write reads the mapped pack; it has to finish before the mapping goes away
+    this->packPool.waitForDone();
+    this->previewPool.waitForDone();
+}
+
+QString ImageProvider::cacheKey(const QString &thumbnailPath, ThumbnailCache::Size size) {
+    // Each variant is cached on its own, so the table and the card view don't evict each other's size
+    return thumbnailPath + '@' + QString::number(int(size));
+}
+
+QIcon ImageProvider::previewIcon(const QByteArray &preview, ThumbnailCache::Size size) {
+    if (preview.isEmpty()) return placeholderIcon;
+
+    // Games sharing a thumbnail share the code, so it keys the cache like a path would
+    const QString key = "preview:" + QString::fromLatin1(preview.toBase64()) + '@' + QString::number(int(size));
+    QPixmap pixmap;
+    if (!QPixmapCache::find(key, &pixmap)) {
+        const QImage image = ThumbnailPreview::decode(preview, int(size));
+        if (image.isNull()) return placeholderIcon;
+        pixmap = QPixmap::fromImage(image);
+        QPixmapCache::insert(key, pixmap);
+    }
+    return QIcon(pixmap);
 }
 
-ImageProvider::~ImageProvider() {}
+void ImageProvider::takePreview(const QString &thumbnailPath, const QByteArray &preview) {
+    if (this->previewedPaths.contains(thumbnailPath)) return;
+    this->previewedPaths.insert(thumbnailPath);
+    if (!preview.isEmpty()) this->computedPreviews.insert(thumbnailPath, preview);
+}
+
+void ImageProvider::encodePreview(const QString &thumbnailPath, const QImage &packed) {
+    this->previewedPaths.insert(thumbnailPath);
+    // A copy: the mapping may be swapped for a compacted pack before the worker gets to it
+    const QImage image = packed.copy();
+    this->previewPool.start([this, thumbnailPath, image]() {
+        const QByteArray preview = ThumbnailPreview::encode(image);
+        QMetaObject::invokeMethod(this, [this, thumbnailPath, preview]() {
+            // Invalidated in the meantime
+            if (preview.isEmpty() || !this->previewedPaths.contains(thumbnailPath)) return;
+            this->computedPreviews.insert(thumbnailPath, preview);
+            if (!this->conversionTimer.isActive()) this->conversionTimer.start();
+        }, Qt::QueuedConnection);
+    });
+}
 
-QIcon ImageProvider::getIcon(const QString &thumbnailPath) {
+QIcon ImageProvider::getIcon(const QString &thumbnailPath, ThumbnailCache::Size size, const QByteArray &preview) {
     if (thumbnailPath.isEmpty()) {
         return placeholderIcon;
     }
-    
+    if (!preview.isEmpty()) this->previewedPaths.insert(thumbnailPath);
+
+    bool failed = false;
+    const QPixmap loaded = pixmap(thumbnailPath, size, &failed);
+    if (!loaded.isNull()) return QIcon(loaded);
+    return failed ? placeholderIcon : previewIcon(preview, size);
+}
+
+QPixmap ImageProvider::pixmap(const QString &thumbnailPath, ThumbnailCache::Size size, bool *failed) {
+    if (failed) *failed = thumbnailPath.isEmpty();
+    if (thumbnailPath.isEmpty()) return QPixmap();
+
+    const QString key = cacheKey(thumbnailPath, size);
     QPixmap pixmap;
-    if (QPixmapCache::find(thumbnailPath, &pixmap)) {
-        return QIcon(pixmap);
+    if (QPixmapCache::find(key, &pixmap)) {
+        return pixmap;
     }
-    
-    // Check if it's already being loaded to avoid redundant background tasks
-    QMutexLocker locker(&mutex);
-    if (!pendingLoads.contains(thumbnailPath)) {
-        pendingLoads.append(thumbnailPath);
-        
-        // Asynchronously load the image
-        QFutureWatcher<QPixmap> *watcher = new QFutureWatcher<QPixmap>(this);
-        connect(watcher, &QFutureWatcher<QPixmap>::finished, this, [this, watcher, thumbnailPath]() {
-            QPixmap result = watcher->result();
-            if (!result.isNull()) {
-                QPixmapCache::insert(thumbnailPath, result);
+    if (this->failedLoads.contains(key)) {
+        if (failed) *failed = true;
+        return QPixmap();
+    }
+
+    // Packed bitmaps are already decoded; wrapping and copying one is cheaper than queueing a load
+    const quint64 packKey = ThumbnailPack::keyFor(thumbnailPath, size);
+    if (!this->packDropped.contains(packKey)) {
+        QImage packed = this->pack.image(packKey);
+        if (!packed.isNull()) {
+            pixmap = QPixmap::fromImage(packed);
+            QPixmapCache::insert(key, pixmap);
+            // This runs while a view paints, so the preview is encoded off the GUI thread
+            if (!this->previewedPaths.contains(thumbnailPath)) encodePreview(thumbnailPath, packed);
+            return pixmap;
+        }
+    }
+
+    // Being painted, so it's on screen; the loader dedups and just moves it up if already queued
+    this->loader.request(thumbnailPath, size, ThumbnailLoader::VISIBLE);
+    return QPixmap();
+}
+
+void ImageProvider::setViewport(ThumbnailCache::Size size, const QStringList &visible, const QStringList &prefetch) {
+    auto uncached = [this, size](const QStringList &paths) {
+        QStringList result;
+        QPixmap pixmap;
+        for (const QString &path : paths) {
+            if (path.isEmpty()) continue;
+            const QString key = cacheKey(path, size);
+            if (this->failedLoads.contains(key) || QPixmapCache::find(key, &pixmap)) continue;
+            const quint64 packKey = ThumbnailPack::keyFor(path, size);
+            if (this->pack.contains(packKey) && !this->packDropped.contains(packKey)) continue;
+            result.append(path);
+        }
+        return result;
+    };
+    this->loader.setViewport(size, uncached(visible), uncached(prefetch));
+}
+
+ThumbnailLoader::Stats ImageProvider::loaderStats() const {
+    return this->loader.stats();
+}
+
+void ImageProvider::onLoaded(const QString &thumbnailPath, ThumbnailCache::Size size, const QImage &image,
+                             const QByteArray &preview) {
+    this->decoded.append(Decoded{thumbnailPath, size, image, preview});
+    if (!this->conversionTimer.isActive()) this->conversionTimer.start();
+}
+
+void ImageProvider::convertBatch() {
+    QElapsedTimer budget;
+    budget.start();
+
+    QStringList paths;
+    QSet<QString> seen;
+    int converted = 0;
+    while (converted < this->decoded.size() && (converted == 0 || budget.elapsed() < CONVERSION_BUDGET_MS)) {
+        const Decoded &item = this->decoded[converted++];
+        const QString key = cacheKey(item.thumbnailPath, item.size);
+        if (item.image.isNull()) {
+            this->failedLoads.insert(key);
+        } else {
+            QPixmapCache::insert(key, QPixmap::fromImage(item.image));
+            takePreview(item.thumbnailPath, item.preview);
+
+            const quint64 packKey = ThumbnailPack::keyFor(item.thumbnailPath, item.size);
+            if ((!this->pack.contains(packKey) || this->packDropped.contains(packKey)) && !this->packAdditions.contains(packKey)) {
+                this->packAdditions.insert(packKey, item.image);
+                this->packAdditionBytes += item.image.sizeInBytes();
             }
-            
-            QMutexLocker lock(&mutex);
-            pendingLoads.removeAll(thumbnailPath);
-            lock.unlock(); // Unlock before emitting to prevent deadlock if emit hooks back
-            
-            emit imageLoaded(thumbnailPath);
-            watcher->deleteLater();
-        });
-        
-        // Execute background read
-        QFuture<QPixmap> future = QtConcurrent::run([thumbnailPath]() {
-            QPixmap img(thumbnailPath);
-            return img;
-        });
-        
-        watcher->setFuture(future);
+        }
+        if (!seen.contains(item.thumbnailPath)) {
+            seen.insert(item.thumbnailPath);
+            paths.append(item.thumbnailPath);
+        }
     }
-    
-    return placeholderIcon;
+    this->decoded.erase(this->decoded.begin(), this->decoded.begin() + converted);
+
+    // The rest goes in the next pass, after the views have had a chance to paint
+    if (!this->decoded.isEmpty()) this->conversionTimer.start();
+
+    if (this->packAdditionBytes >= PACK_FLUSH_BYTES) {
+        flushPack();
+    } else if (!this->packAdditions.isEmpty()) {
+        this->packTimer.start();
+    }
+
+    if (!paths.isEmpty()) emit imagesLoaded(paths);
+    if (!this->computedPreviews.isEmpty()) {
+        const QHash<QString, QByteArray> previews = this->computedPreviews;
+        this->computedPreviews.clear();
+        emit previewsComputed(previews);
+    }
+}
+
+void ImageProvider::invalidate(const QString &thumbnailPath) {
+    this->previewedPaths.remove(thumbnailPath);
+    this->computedPreviews.remove(thumbnailPath);
+    for (ThumbnailCache::Size size : ALL_SIZES) {
+        const QString key = cacheKey(thumbnailPath, size);
+        QPixmapCache::remove(key);
+        this->failedLoads.remove(key);
+
+        const quint64 packKey = ThumbnailPack::keyFor(thumbnailPath, size);
+        if (this->packAdditions.contains(packKey)) {
+            this->packAdditionBytes -= this->packAdditions.take(packKey).sizeInBytes();
+        }
+        // A running write may be packing the old image under this key
+        if (this->pack.contains(packKey) || this->packWatcher.isRunning()) {
+            this->packDropped.insert(packKey);
+            this->packTimer.start();
+        }
+    }
+}
+
+void ImageProvider::flushPack() {
+    // The finished write re-arms the timer if more arrived meanwhile
+    if (this->packWatcher.isRunning()) return;
+    this->packTimer.stop();
+    if (this->packAdditions.isEmpty() && this->packDropped.isEmpty()) return;
+
+    QHash<quint64, QImage> additions = this->packAdditions;
+    const qint64 additionBytes = this->packAdditionBytes;
+    this->packAdditions.clear();
+    this->packAdditionBytes = 0;
+    this->packWriting = this->packDropped;
+
+    const qint64 live = this->pack.liveBytes();
+    const qint64 dead = this->pack.deadBytes();
+    this->packCompacting = !this->pack.isOpen() || live + additionBytes > PACK_BUDGET_BYTES
+        || dead > (live + dead) * PACK_COMPACT_DEAD_RATIO;
+
+    const QString path = this->packCompacting ? this->packPath + ".new" : this->packPath;
+    const bool compacting = this->packCompacting;
+    const ThumbnailPack *base = &this->pack;
+    const QSet<quint64> dropped = this->packWriting;
+    this->packWatcher.setFuture(QtConcurrent::run(&this->packPool, [path, compacting, base, additions, dropped]() {
+        if (!compacting) return ThumbnailPack::append(path, base, additions, dropped);
+        return ThumbnailPack::write(path, base, additions, dropped, PACK_BUDGET_BYTES);
+    }));
+}
+
+void ImageProvider::onPackWritten() {
+    if (this->packWatcher.result()) {
+        // Pixmaps made from the old mapping are copies, so nothing still points into it.
+        // An append only grew the file; mapping it again picks up the new table.
+        this->pack.close();
+        if (this->packCompacting) {
+            QFile::remove(this->packPath);
+            QFile::rename(this->packPath + ".new", this->packPath);
+        }
+        this->pack.open(this->packPath);
+
+        for (quint64 key : this->packWriting) this->packDropped.remove(key);
+    }
+    this->packWriting.clear();
+
+    if (!this->packAdditions.isEmpty() || !this->packDropped.isEmpty()) this->packTimer.start();
 }
@@ -0,0 +1,124 @@
+#include "libraryjournal.h"
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QDebug>
+
+LibraryJournal::LibraryJournal(const QString &path)
+    : path(path), rotatedPath(path + ".rotated") {
+    // Count what is already in the active segment so compaction thresholds survive restarts
+    QList<QJsonObject> existing;
+    readSegment(this->path, existing);
+    this->records = existing.size();
+
+    openActive();
+}
+
+LibraryJournal::~LibraryJournal() {
+    this->file.close();
+}
+
+bool LibraryJournal::openActive() {
+    this->file.setFileName(this->path);
+    if (!this->file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "Failed to open library journal" << this->path;
+        return false;
+    }
+    return true;
+}
+
+bool LibraryJournal::append(const QJsonObject &record) {
+    return append(QList<QJsonObject>() << record);
+}
+
+bool LibraryJournal::append(const QList<QJsonObject> &records) {
+    if (records.isEmpty()) return true;
+    if (!this->file.isOpen() && !openActive()) return false;
+
+    // Build all lines first so a batch hits the disk in a single write
+    QByteArray data;
+    for (const QJsonObject &record : records) {
+        data.append(QJsonDocument(record).toJson(QJsonDocument::Compact));
+        data.append('\n');
+    }
+
+    if (this->file.write(data) != data.size()) {
+        qDebug() << "Failed to append to library journal" << this->path;
+        return false;
+    }
+    this->file.flush();
+    this->records += records.size();
+    return true;
+}
+
+int LibraryJournal::recordCount() const {
+    return this->records;
+}
+
+qint64 LibraryJournal::size() const {
+    return this->file.isOpen() ? this->file.size() : 0;
+}
+
+bool LibraryJournal::rotate() {
+    this->file.close();
+
+    if (QFile::exists(this->rotatedPath)) {
+        // A previous compaction never completed; keep its records and add ours behind them
+        QFile active(this->path);
+        QFile rotated(this->rotatedPath);
+        if (!active.open(QIODevice::ReadOnly) || !rotated.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            openActive();
+            return false;
+        }
+        rotated.write(active.readAll());
+        rotated.close();
+        active.close();
+        QFile::remove(this->path);
+    } else if (QFile::exists(this->path) && !QFile::rename(this->path, this->rotatedPath)) {
+        qDebug() << "Failed to rotate library journal" << this->path;
+        openActive();
+        return false;
+    }
+
+    this->records = 0;
+    return openActive();
+}
+
+void LibraryJournal::discardRotated() {
+    QFile::remove(this->rotatedPath);
+}
+
+void LibraryJournal::reset() {
+    this->file.close();
+    QFile::remove(this->rotatedPath);
+    QFile::remove(this->path);
+    this->records = 0;
+    openActive();
+}
+
+QList<QJsonObject> LibraryJournal::readAll() const {
+    QList<QJsonObject> out;
+    readSegment(this->rotatedPath, out);
+    readSegment(this->path, out);
+    return out;
+}
+
+void LibraryJournal::readSegment(const QString &path, QList<QJsonObject> &out) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return; // Segment doesn't exist
+    }
+
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty()) continue;
+
+        QJsonParseError error;
+        QJsonDocument doc = QJsonDocument::fromJson(line, &error);
+        if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+            // A torn final line after a crash; everything before it is still valid
+            qDebug() << "Skipping damaged journal record in" << path;
+            continue;
+        }
+        out.append(doc.object());
+    }
+}
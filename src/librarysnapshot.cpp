@@ -0,0 +1,387 @@
+#include "librarysnapshot.h"
+#include "gamemanager.h"
+#include "tagmanager.h"
+#include "thumbnailpreview.h"
+#include <QSaveFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <cstring>
+#include <cstddef>
+#include <limits>
+
+static const char SNAPSHOT_MAGIC[4] = {'G', 'D', 'B', 'S'};
+static const quint32 SNAPSHOT_VERSION = 3;
+static const quint32 SNAPSHOT_BYTE_ORDER = 0x01020304;
+static const quint32 EMPTY_SLOT = 0xFFFFFFFF;
+static const qint64 INVALID_TIME = std::numeric_limits<qint64>::min();
+static const quint8 FLAG_KOREAN = 0x01;
+static const quint32 RECORD_V1_SIZE = offsetof(LibrarySnapshot::Record, volumeLabel);
+static_assert(ThumbnailPreview::MAX_BYTES <= sizeof(LibrarySnapshot::Record::thumbnailPreview),
+              "Record::thumbnailPreview can't hold the largest preview");
+
+// Every section starts on an 8 byte boundary so mapped records can be read in place
+static qint64 align8(qint64 value) {
+    return (value + 7) & ~qint64(7);
+}
+
+LibrarySnapshot::LibrarySnapshot() {
+    std::memset(&this->header, 0, sizeof(Header));
+}
+
+LibrarySnapshot::~LibrarySnapshot() {
+    close();
+}
+
+bool LibrarySnapshot::open(const QString &path) {
+    close();
+
+    this->file.setFileName(path);
+    if (!this->file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    this->size = this->file.size();
+    if (this->size < static_cast<qint64>(sizeof(Header))) {
+        close();
+        return false;
+    }
+
+    this->data = this->file.map(0, this->size);
+    if (!this->data) {
+        qDebug() << "Failed to map library snapshot" << path;
+        close();
+        return false;
+    }
+
+    std::memcpy(&this->header, this->data, sizeof(Header));
+    const Header &h = this->header;
+
+    bool valid = std::memcmp(h.magic, SNAPSHOT_MAGIC, 4) == 0
+        && h.version >= 1 && h.version <= SNAPSHOT_VERSION
+        && h.byteOrder == SNAPSHOT_BYTE_ORDER
+        && h.recordSize >= RECORD_V1_SIZE
+        && h.recordsOffset + quint64(h.recordCount) * h.recordSize <= quint64(this->size)
+        && h.tagRefsOffset + quint64(h.tagRefCount) * sizeof(StringRef) <= quint64(this->size)
+        && h.pathIndexOffset + quint64(h.pathIndexSlots) * sizeof(quint32) <= quint64(this->size)
+        && h.stringPoolOffset + h.stringPoolUnits * sizeof(char16_t) <= quint64(this->size);
+
+    if (!valid) {
+        qDebug() << "Library snapshot is damaged or from an unknown version:" << path;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void LibrarySnapshot::close() {
+    if (this->data) {
+        this->file.unmap(const_cast<uchar *>(this->data));
+        this->data = nullptr;
+    }
+    this->file.close();
+    this->size = 0;
+    this->tagIds.clear();
+    std::memset(&this->header, 0, sizeof(Header));
+}
+
+bool LibrarySnapshot::isOpen() const {
+    return this->data != nullptr;
+}
+
+int LibrarySnapshot::count() const {
+    return this->data ? static_cast<int>(this->header.recordCount) : 0;
+}
+
+LibrarySnapshot::Record LibrarySnapshot::recordAt(int index) const {
+    Record record;
+    std::memset(&record, 0, sizeof(Record));
+    // Older files have shorter records (missing fields stay zero), newer ones longer; only read the part both know
+    std::memcpy(&record, this->data + this->header.recordsOffset + quint64(index) * this->header.recordSize,
+                qMin<quint32>(this->header.recordSize, sizeof(Record)));
+    return record;
+}
+
+QString LibrarySnapshot::stringAt(const StringRef &ref) const {
+    if (ref.length == 0 || quint64(ref.offset) + ref.length > this->header.stringPoolUnits) {
+        return QString();
+    }
+    const char16_t *pool = reinterpret_cast<const char16_t *>(this->data + this->header.stringPoolOffset);
+    return QString(reinterpret_cast<const QChar *>(pool + ref.offset), ref.length);
+}
+
+QString LibrarySnapshot::filePathAt(int index) const {
+    if (index < 0 || index >= count()) return QString();
+    return stringAt(recordAt(index).filePath);
+}
+
+QString LibrarySnapshot::cleanNameAt(int index) const {
+    if (index < 0 || index >= count()) return QString();
+    return stringAt(recordAt(index).cleanName);
+}
+
+QString LibrarySnapshot::exePathAt(int index) const {
+    if (index < 0 || index >= count()) return QString();
+    return stringAt(recordAt(index).exePath);
+}
+
+QString LibrarySnapshot::thumbnailPathAt(int index) const {
+    if (index < 0 || index >= count()) return QString();
+    return stringAt(recordAt(index).thumbnailPath);
+}
+
+QList<int> LibrarySnapshot::tagIdsAt(int index) const {
+    QList<int> ids;
+    if (index < 0 || index >= count()) return ids;
+
+    const Record r = recordAt(index);
+    if (quint64(r.tagFirst) + r.tagCount > this->header.tagRefCount) return ids;
+    const uchar *tagRefs = this->data + this->header.tagRefsOffset;
+    ids.reserve(static_cast<int>(r.tagCount));
+    for (quint32 i = 0; i < r.tagCount; ++i) {
+        StringRef ref;
+        std::memcpy(&ref, tagRefs + (quint64(r.tagFirst) + i) * sizeof(StringRef), sizeof(StringRef));
+        ids.append(tagIdFor(ref));
+    }
+    return ids;
+}
+
+void LibrarySnapshot::resolveTags() {
+    const uchar *tagRefs = this->data + this->header.tagRefsOffset;
+    for (quint64 i = 0; i < this->header.tagRefCount; ++i) {
+        StringRef ref;
+        std::memcpy(&ref, tagRefs + i * sizeof(StringRef), sizeof(StringRef));
+        tagIdFor(ref);
+    }
+}
+
+GameItem LibrarySnapshot::gameAt(int index) const {
+    GameItem item;
+    if (index < 0 || index >= count()) return item;
+
+    Record r = recordAt(index);
+    item.originalName = stringAt(r.originalName);
+    item.cleanName = stringAt(r.cleanName);
+    item.filePath = stringAt(r.filePath);
+    item.type = static_cast<GameType>(r.type);
+    item.koreanSupport = (r.flags & FLAG_KOREAN) != 0;
+    item.folderName = stringAt(r.folderName);
+    item.source = stringAt(r.source);
+    item.gameCode = stringAt(r.gameCode);
+    item.thumbnailPath = stringAt(r.thumbnailPath);
+    item.exePath = stringAt(r.exePath);
+    if (r.thumbnailPreview[0] != 0) {
+        // The first byte gives the grid and so the length
+        const int cells = (r.thumbnailPreview[0] >> 4) * (r.thumbnailPreview[0] & 0x0F);
+        const QByteArray preview(reinterpret_cast<const char *>(r.thumbnailPreview),
+                                 qMin<int>(1 + cells * 3, sizeof(r.thumbnailPreview)));
+        if (ThumbnailPreview::isValid(preview)) item.thumbnailPreview = preview;
+    }
+    item.volumeLabel = stringAt(r.volumeLabel);
+    if (r.contentExecutables.length > 0) item.contentExecutables = stringAt(r.contentExecutables).split('\n');
+    item.contentSize = r.contentSize;
+    item.contentFiles = static_cast<int>(r.contentFiles);
+
+    const QList<int> tagIds = tagIdsAt(index);
+    for (int id : tagIds) item.tags.insert(id);
+
+    if (r.lastPlayed != INVALID_TIME) {
+        item.lastPlayed = QDateTime::fromMSecsSinceEpoch(r.lastPlayed);
+    }
+    return item;
+}
+
+int LibrarySnapshot::tagIdFor(const StringRef &ref) const {
+    // Tag names are interned in the pool, so the offset identifies the name
+    auto it = this->tagIds.constFind(ref.offset);
+    if (it != this->tagIds.constEnd()) return it.value();
+
+    int id = TagManager::instance().tagId(stringAt(ref));
+    this->tagIds.insert(ref.offset, id);
+    return id;
+}
+
+QList<GameItem> LibrarySnapshot::readAll() const {
+    QList<GameItem> games;
+    games.reserve(count());
+    for (int i = 0; i < count(); ++i) {
+        games.append(gameAt(i));
+    }
+    return games;
+}
+
+quint32 LibrarySnapshot::hashPath(const QString &path) {
+    // FNV-1a over UTF-16 units; must stay stable across Qt versions since it is stored on disk
+    quint32 hash = 2166136261u;
+    for (QChar c : path) {
+        hash ^= c.unicode();
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+int LibrarySnapshot::indexOfPath(const QString &path) const {
+    if (!this->data || this->header.pathIndexSlots == 0) return -1;
+
+    const uchar *slots = this->data + this->header.pathIndexOffset;
+    const quint32 mask = this->header.pathIndexSlots - 1;
+    quint32 slot = hashPath(path) & mask;
+
+    for (quint32 probe = 0; probe < this->header.pathIndexSlots; ++probe) {
+        quint32 index;
+        std::memcpy(&index, slots + quint64(slot) * sizeof(quint32), sizeof(quint32));
+        if (index == EMPTY_SLOT) return -1;
+        if (index < this->header.recordCount && filePathAt(index) == path) {
+            return static_cast<int>(index);
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+bool LibrarySnapshot::write(const QString &path, const QList<GameItem> &games, const QStringList &tagDictionary) {
+    QVector<char16_t> pool;
+    QHash<QString, StringRef> interned;
+
+    // Identical strings (tags, sources, shared thumbnails) are stored once
+    auto intern = [&](const QString &s) -> StringRef {
+        if (s.isEmpty()) return StringRef{0, 0};
+        auto it = interned.constFind(s);
+        if (it != interned.constEnd()) return it.value();
+
+        StringRef ref{static_cast<quint32>(pool.size()), static_cast<quint32>(s.size())};
+        pool.resize(pool.size() + s.size());
+        std::memcpy(pool.data() + ref.offset, s.utf16(), s.size() * sizeof(char16_t));
+        interned.insert(s, ref);
+        return ref;
+    };
+
+    QVector<Record> records;
+    QVector<StringRef> tagRefs;
+    records.reserve(games.size());
+
+    for (const GameItem &game : games) {
+        Record r;
+        std::memset(&r, 0, sizeof(Record));
+        r.originalName = intern(game.originalName);
+        r.cleanName = intern(game.cleanName);
+        r.filePath = intern(game.filePath);
+        r.folderName = intern(game.folderName);
+        r.source = intern(game.source);
+        r.gameCode = intern(game.gameCode);
+        r.thumbnailPath = intern(game.thumbnailPath);
+        r.exePath = intern(game.exePath);
+        if (ThumbnailPreview::isValid(game.thumbnailPreview)) {
+            std::memcpy(r.thumbnailPreview, game.thumbnailPreview.constData(), game.thumbnailPreview.size());
+        }
+        r.volumeLabel = intern(game.volumeLabel);
+        r.contentExecutables = intern(game.contentExecutables.join('\n'));
+        r.contentSize = game.contentSize;
+        r.contentFiles = static_cast<quint32>(game.contentFiles);
+        r.lastPlayed = game.lastPlayed.isValid() ? game.lastPlayed.toMSecsSinceEpoch() : INVALID_TIME;
+        r.type = static_cast<quint8>(game.type);
+        r.flags = game.koreanSupport ? FLAG_KOREAN : 0;
+
+        r.tagFirst = static_cast<quint32>(tagRefs.size());
+        const QList<int> tagIds = game.tags.ids();
+        for (int id : tagIds) {
+            // Retired ids have an empty name and are dropped here
+            QString tag = tagDictionary.value(id);
+            if (!tag.isEmpty()) tagRefs.append(intern(tag));
+        }
+        r.tagCount = static_cast<quint32>(tagRefs.size()) - r.tagFirst;
+        records.append(r);
+    }
+
+    // Power of two table at most half full keeps probe chains short
+    quint32 slotCount = 16;
+    while (slotCount < quint32(games.size()) * 2) slotCount <<= 1;
+    QVector<quint32> pathIndex(slotCount, EMPTY_SLOT);
+    for (int i = 0; i < games.size(); ++i) {
+        quint32 slot = hashPath(games[i].filePath) & (slotCount - 1);
+        while (pathIndex[slot] != EMPTY_SLOT) slot = (slot + 1) & (slotCount - 1);
+        pathIndex[slot] = static_cast<quint32>(i);
+    }
+
+    Header h;
+    std::memset(&h, 0, sizeof(Header));
+    std::memcpy(h.magic, SNAPSHOT_MAGIC, 4);
+    h.version = SNAPSHOT_VERSION;
+    h.byteOrder = SNAPSHOT_BYTE_ORDER;
+    h.recordSize = sizeof(Record);
+    h.recordCount = static_cast<quint32>(records.size());
+    h.tagRefCount = static_cast<quint32>(tagRefs.size());
+    h.pathIndexSlots = slotCount;
+    h.recordsOffset = align8(sizeof(Header));
+    h.tagRefsOffset = align8(h.recordsOffset + quint64(records.size()) * sizeof(Record));
+    h.pathIndexOffset = align8(h.tagRefsOffset + quint64(tagRefs.size()) * sizeof(StringRef));
+    h.stringPoolOffset = align8(h.pathIndexOffset + quint64(slotCount) * sizeof(quint32));
+    h.stringPoolUnits = static_cast<quint64>(pool.size());
+
+    const quint64 totalSize = h.stringPoolOffset + h.stringPoolUnits * sizeof(char16_t);
+    if (totalSize > quint64(std::numeric_limits<int>::max())) {
+        qDebug() << "Library snapshot would be" << totalSize << "bytes, too large to write" << path;
+        return false;
+    }
+    QByteArray out(static_cast<int>(totalSize), '\0');
+    char *dst = out.data();
+    std::memcpy(dst, &h, sizeof(Header));
+    if (!records.isEmpty()) std::memcpy(dst + h.recordsOffset, records.constData(), records.size() * sizeof(Record));
+    if (!tagRefs.isEmpty()) std::memcpy(dst + h.tagRefsOffset, tagRefs.constData(), tagRefs.size() * sizeof(StringRef));
+    std::memcpy(dst + h.pathIndexOffset, pathIndex.constData(), pathIndex.size() * sizeof(quint32));
+    if (!pool.isEmpty()) std::memcpy(dst + h.stringPoolOffset, pool.constData(), pool.size() * sizeof(char16_t));
+
+    // QSaveFile replaces the old snapshot atomically, so a crash mid-write keeps the previous one
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(out) != out.size() || !file.commit()) {
+        qDebug() << "Failed to write library snapshot" << path;
+        return false;
+    }
+    return true;
+}
+
+bool LibrarySnapshot::importJson(const QString &jsonPath, const QString &snapshotPath) {
+    QFile file(jsonPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+
+    QJsonObject root = doc.object();
+    if (!root.contains("games") || !root["games"].isArray()) {
+        return false;
+    }
+
+    QList<GameItem> games;
+    const QJsonArray array = root["games"].toArray();
+    for (const auto &val : array) {
+        games.append(GameManager::jsonToGame(val.toObject(), TagManager::instance()));
+    }
+    return write(snapshotPath, games, TagManager::instance().tagDictionary());
+}
+
+bool LibrarySnapshot::exportJson(const QString &snapshotPath, const QString &jsonPath) {
+    LibrarySnapshot snapshot;
+    if (!snapshot.open(snapshotPath)) {
+        return false;
+    }
+
+    QJsonArray array;
+    for (int i = 0; i < snapshot.count(); ++i) {
+        array.append(GameManager::gameToJson(snapshot.gameAt(i), TagManager::instance()));
+    }
+
+    QJsonObject root;
+    root["games"] = array;
+
+    QSaveFile file(jsonPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    return file.commit();
+}
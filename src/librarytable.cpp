@@ -0,0 +1,79 @@
+#include "librarytable.h"
+#include "librarysnapshot.h"
+
+LibraryTable::LibraryTable(std::shared_ptr<const LibrarySnapshot> snapshot) : snapshot(std::move(snapshot)) {
+    const int count = this->snapshot->count();
+    // Default GameItems don't allocate; the records are only read when asked for
+    this->items.resize(count);
+    this->records.resize(count);
+    for (int i = 0; i < count; ++i) this->records[i] = i;
+}
+
+const GameItem &LibraryTable::at(int row) const {
+    if (this->records.at(row) != -1) {
+        this->items[row] = this->snapshot->gameAt(this->records.at(row));
+        this->records[row] = -1;
+    }
+    return this->items.at(row);
+}
+
+GameItem &LibraryTable::operator[](int row) {
+    at(row);
+    return this->items[row];
+}
+
+QString LibraryTable::filePathAt(int row) const {
+    const int record = this->records.at(row);
+    return record != -1 ? this->snapshot->filePathAt(record) : this->items.at(row).filePath;
+}
+
+QString LibraryTable::exePathAt(int row) const {
+    const int record = this->records.at(row);
+    return record != -1 ? this->snapshot->exePathAt(record) : this->items.at(row).exePath;
+}
+
+QString LibraryTable::thumbnailPathAt(int row) const {
+    const int record = this->records.at(row);
+    return record != -1 ? this->snapshot->thumbnailPathAt(record) : this->items.at(row).thumbnailPath;
+}
+
+QList<int> LibraryTable::tagIdsAt(int row) const {
+    const int record = this->records.at(row);
+    return record != -1 ? this->snapshot->tagIdsAt(record) : this->items.at(row).tags.ids();
+}
+
+void LibraryTable::append(const GameItem &item) {
+    this->items.append(item);
+    this->records.append(-1);
+}
+
+void LibraryTable::replace(int row, const GameItem &item) {
+    this->items[row] = item;
+    this->records[row] = -1;
+}
+
+void LibraryTable::removeAt(int row) {
+    this->items.removeAt(row);
+    this->records.removeAt(row);
+}
+
+void LibraryTable::clear() {
+    this->items.clear();
+    this->records.clear();
+    this->snapshot.reset();
+}
+
+void LibraryTable::reserve(int rows) {
+    this->items.reserve(rows);
+    this->records.reserve(rows);
+}
+
+QList<GameItem> LibraryTable::toList() const {
+    QList<GameItem> games;
+    games.reserve(size());
+    for (int row = 0; row < size(); ++row) {
+        const int record = this->records.at(row);
+        games.append(record != -1 ? this->snapshot->gameAt(record) : this->items.at(row));
+    }
+    return games;
+}
@@ -1,4 +1,10 @@
 #include "mainwindow.h"
+#include <QThreadPool>
+#include "thumbnailstore.h"
+#include "imageprovider.h"
+
+// Per game; most are captured as soon as their window settles
+static const int CAPTURE_TIMEOUT_SECS = 30;
 
 MainWindow::MainWindow() {
     setMainUI();
@@ -9,13 +15,92 @@ MainWindow::MainWindow() {
     this->scanner->moveToThread(this->workerThread);
     
     connect(this->workerThread, &QThread::finished, this->scanner, &QObject::deleteLater);
-    connect(this->scanner, &GameScanner::gameFound, this, &MainWindow::onGameFound);
+    connect(this->scanner, &GameScanner::gamesFound, this, &MainWindow::onGamesFound);
     connect(this->scanner, &GameScanner::scanFinished, this, &MainWindow::onScanFinished);
     
 
     // We connect signal from UI to Scanner in thread
     // Connect scanRequested directly to scanner::scanDirectory (which is now a slot)
     connect(this->fileListTab, &FileListTab::scanRequested, this->scanner, &GameScanner::scanDirectory);
+
+    // Recursive crawl of the selected root; folders below maxDepth stay lazily expandable
+    this->walker = new DirectoryWalker(this);
+    this->walker->setMaxDepth(8);
+    this->walker->setConcurrency(qMax(4, QThread::idealThreadCount()));
+    connect(this->walker, &DirectoryWalker::gamesFound, this, &MainWindow::onGamesFound);
+    connect(this->walker, &DirectoryWalker::directoriesUnchanged, this, &MainWindow::onDirectoriesUnchanged);
+    connect(this->walker, &DirectoryWalker::gamesRemoved, this->fileListTab, &FileListTab::removeGameItems);
+    connect(this->walker, &DirectoryWalker::gamesChanged, this->fileListTab, &FileListTab::updateGameItems);
+    connect(this->walker, &DirectoryWalker::progress, this, &MainWindow::onWalkProgress);
+    connect(this->walker, &DirectoryWalker::finished, this, &MainWindow::onWalkFinished);
+
+    // Live updates: changed directories are re-listed by the scanner thread
+    this->folderWatcher = new FolderWatcher(this);
+    this->folderWatcher->setBudget(4096);
+    connect(this->folderWatcher, &FolderWatcher::directoriesChanged, this, &MainWindow::onDirectoriesChanged);
+    connect(this->folderWatcher, &FolderWatcher::fallbackScanDue, this, &MainWindow::onFallbackScan);
+    connect(this->scanner, &GameScanner::directoryScanned, this, &MainWindow::onDirectoryScanned);
+    connect(this->scanner, &GameScanner::pathsChecked, this, &MainWindow::onPathsChecked);
+    connect(&GameManager::instance(), &GameManager::gameAdded, this, [this](const GameItem &item) {
+        this->folderWatcher->watch(GameManager::parentDirectory(item.filePath));
+    });
+    this->workerThread->start();
+
+    updateWatchedDirectories();
+    GameManager::instance().verifyPaths();
+
+    // Check the thumbnail store and drop images no game uses any more
+    connect(&ThumbnailStore::instance(), &ThumbnailStore::maintenanceFinished, this,
+            [](int checked, const QStringList &damaged, const QStringList &missing, const QStringList &removed, qint64 bytesFreed) {
+        for (const QString &path : removed) ImageProvider::instance().invalidate(path);
+        // Only worth a line when something was wrong or got deleted
+        if (!damaged.isEmpty() || !missing.isEmpty() || !removed.isEmpty()) {
+            qDebug() << "Thumbnail store:" << checked << "checked," << damaged.size() << "damaged,"
+                     << missing.size() << "missing," << removed.size() << "removed," << bytesFreed << "bytes freed";
+        }
+    });
+    ThumbnailStore::instance().startMaintenance();
+
+    // Libraries from before previews get them as their thumbnails are first shown
+    connect(&ImageProvider::instance(), &ImageProvider::previewsComputed,
+            &GameManager::instance(), &GameManager::setThumbnailPreviews);
+
+    // Duplicate detection; lives here so a run survives closing the report
+    this->fingerprinter = new Fingerprinter(this);
+
+    // Thumbnails from the games' own files, for games that have none
+    this->thumbnailExtractor = new ThumbnailExtractor(this);
+    connect(this->thumbnailExtractor, &ThumbnailExtractor::progress, this, [this](int done, int total) {
+        statusBar()->showMessage(tr("Extracting thumbnails: %1 / %2").arg(done).arg(total));
+    });
+    connect(this->thumbnailExtractor, &ThumbnailExtractor::finished, this, [this](int found, int total) {
+        this->extractBtn->setText(tr("Extract Thumbnails"));
+        statusBar()->showMessage(tr("Thumbnails extracted for %1 of %2 games").arg(found).arg(total));
+    });
+
+    this->captureQueue = new ThumbnailManager(this);
+    connect(this->gameListTab, &GameListTab::captureRequested, this, &MainWindow::captureThumbnails);
+    connect(this->captureQueue, &ThumbnailManager::captureFinished, this,
+            [this](const QString &id, const QString &imagePath, const QByteArray &preview) {
+        const QString baseline = this->captureBaseline.take(id);
+        GameItem game = GameManager::instance().getGameByPath(id);
+        if (game.filePath.isEmpty()) return;
+        // The user picked a thumbnail while the game was running; theirs wins
+        if (game.thumbnailPath != baseline) return;
+        game.thumbnailPath = imagePath;
+        game.thumbnailPreview = preview;
+        GameManager::instance().updateGame(game);
+    });
+    connect(this->captureQueue, &ThumbnailManager::captureFailed, this, [this](const QString &id, const QString &reason) {
+        this->captureBaseline.remove(id);
+        qDebug() << "Capture failed for" << id << reason;
+    });
+    connect(this->captureQueue, &ThumbnailManager::progress, this, [this](int done, int total) {
+        statusBar()->showMessage(tr("Capturing thumbnails: %1 / %2").arg(done).arg(total));
+    });
+    connect(this->captureQueue, &ThumbnailManager::finished, this, [this]() {
+        statusBar()->showMessage(tr("Thumbnail capture finished"));
+    });
 }
 
 MainWindow::~MainWindow() {
@@ -28,6 +113,30 @@ void MainWindow::openTagManager() {
     dialog.exec();
 }
 
+void MainWindow::openDuplicateReport() {
+    DuplicateReportDialog dialog(this->fingerprinter, this);
+    dialog.exec();
+}
+
+void MainWindow::extractThumbnails() {
+    if (this->thumbnailExtractor->isRunning()) {
+        this->thumbnailExtractor->cancel();
+        this->extractBtn->setText(tr("Extract Thumbnails"));
+        statusBar()->showMessage(tr("Thumbnail extraction cancelled"));
+        return;
+    }
+    this->extractBtn->setText(tr("Stop Extracting"));
+    this->thumbnailExtractor->start(GameManager::instance().getGames().toList());
+}
+
+void MainWindow::captureThumbnails(const QList<GameItem> &games) {
+    for (const GameItem &game : games) {
+        if (game.exePath.isEmpty()) continue;
+        this->captureBaseline.insert(game.filePath, GameManager::instance().getGameByPath(game.filePath).thumbnailPath);
+    }
+    this->captureQueue->enqueue(games, CAPTURE_TIMEOUT_SECS);
+}
+
 void MainWindow::setMainUI() {
     resize(1200, 675);
 
@@ -59,13 +168,19 @@ void MainWindow::setSelectDirUI() {
     this->dirPathLabel = new QLabel(tr("No Directory Selected"));
     QPushButton *dirBtn = new QPushButton(tr("Select Directory"));
     QPushButton *tagBtn = new QPushButton(tr("Manage Tags"));
+    QPushButton *duplicateBtn = new QPushButton(tr("Find Duplicates"));
+    this->extractBtn = new QPushButton(tr("Extract Thumbnails"));
     
     connect(dirBtn, &QPushButton::clicked, this, &MainWindow::getDirPath);
     connect(tagBtn, &QPushButton::clicked, this, &MainWindow::openTagManager);
+    connect(duplicateBtn, &QPushButton::clicked, this, &MainWindow::openDuplicateReport);
+    connect(this->extractBtn, &QPushButton::clicked, this, &MainWindow::extractThumbnails);
     
     dirLayout->addWidget(this->dirPathLabel);
     dirLayout->addWidget(dirBtn);
     dirLayout->addWidget(tagBtn);
+    dirLayout->addWidget(duplicateBtn);
+    dirLayout->addWidget(this->extractBtn);
     
     this->selectDirFrame->setLayout(dirLayout);
 }
@@ -86,6 +201,7 @@ void MainWindow::setMainTabUI() {
     this->mainTabWidget->addTab(this->gameListTab, tr("게임 목록"));
     
     connect(this->fileListTab, &FileListTab::requestAddGame, this, &MainWindow::showGameInfoDialog);
+    connect(this->fileListTab, &FileListTab::requestAddGames, this, &MainWindow::addGamesToLibrary);
 }
 
 void MainWindow::getDirPath() {
@@ -93,23 +209,130 @@ void MainWindow::getDirPath() {
     
     if (path.isEmpty()) return;
     
-    this->dirPath = path;
+    this->dirPath = QDir::cleanPath(path);
     if (this->dirPathLabel) this->dirPathLabel->setText(path);
 
-    // Clear existing
-    this->fileListTab->clearItems();
+    // Same root as shown: keep the tree and let the walk report only what changed
+    bool refresh = !this->shownRoot.isEmpty() && this->shownRoot == this->dirPath;
+    if (!refresh) {
+        // Clear existing
+        this->fileListTab->clearItems();
+        this->fileListTab->setRootPath(this->dirPath);
+        this->shownRoot.clear();
 
-    // Start Scan in Thread
-    // To invoke method on object in another thread safely:
-    QMetaObject::invokeMethod(this->scanner, "scanDirectory", Qt::QueuedConnection, Q_ARG(QString, this->dirPath));
-    
-    if (!this->workerThread->isRunning()) {
-        this->workerThread->start();
+        // Unchanged directories are then filled from the index instead of being listed again
+        if (!this->scanIndex || this->scanIndex->root != this->dirPath) {
+            this->scanIndex.reset(new ScanIndex);
+            if (!this->scanIndex->load(ScanIndex::pathForRoot(this->dirPath)) || this->scanIndex->root != this->dirPath) {
+                this->scanIndex.reset();
+            }
+        }
+    }
+
+    // Restarts (and cancels any walk of the previous root)
+    this->walker->start(this->dirPath, this->scanIndex, !refresh);
+}
+
+void MainWindow::onGamesFound(const QList<GameItem> &items) {
+    this->fileListTab->addGameItems(items);
+}
+
+void MainWindow::onDirectoriesUnchanged(const QStringList &dirs) {
+    // scanIndex is the baseline the running walk was started with
+    if (!this->scanIndex) return;
+    QList<GameItem> items;
+    for (const QString &dir : dirs) items.append(this->scanIndex->itemsOf(dir));
+    this->fileListTab->addGameItems(items);
+}
+
+void MainWindow::onWalkProgress(double dirsPerSec, double entriesPerSec, int queueDepth) {
+    statusBar()->showMessage(tr("Scanning: %1 dirs/s, %2 entries/s, %3 dirs queued")
+        .arg(qRound(dirsPerSec)).arg(qRound(entriesPerSec)).arg(queueDepth));
+}
+
+void MainWindow::onWalkFinished(qint64 dirs, qint64 entries, qint64 elapsedMs) {
+    statusBar()->showMessage(tr("Scan finished: %1 dirs, %2 entries listed in %3 s")
+        .arg(dirs).arg(entries).arg(elapsedMs / 1000.0, 0, 'f', 1));
+
+    this->scanIndex = this->walker->lastIndex();
+    if (!this->scanIndex) return;
+    this->shownRoot = this->scanIndex->root;
+    updateWatchedDirectories();
+
+    // Persist for the next session without blocking the GUI
+    QSharedPointer<const ScanIndex> index = this->scanIndex;
+    QThreadPool::globalInstance()->start([index]() {
+        index->save(ScanIndex::pathForRoot(index->root));
+    });
+}
+
+void MainWindow::updateWatchedDirectories() {
+    QStringList dirs = GameManager::instance().libraryDirectories();
+    if (this->scanIndex && this->scanIndex->root == this->shownRoot) {
+        dirs.append(this->scanIndex->dirs.keys());
+    }
+    this->folderWatcher->watchDirectories(dirs);
+}
+
+void MainWindow::onDirectoriesChanged(const QStringList &dirs) {
+    // Library entries living directly in a changed directory may have gone (or come back);
+    // the scanner thread stats them and answers with pathsChecked
+    QStringList paths;
+    for (const QString &dir : dirs) {
+        paths.append(GameManager::instance().pathsInDirectory(dir));
+    }
+    if (!paths.isEmpty()) {
+        QMetaObject::invokeMethod(this->scanner, "checkPaths", Qt::QueuedConnection, Q_ARG(QStringList, paths));
+    }
+
+    // Only the changed directories of the shown tree are listed again; a running walk covers everything anyway
+    if (this->shownRoot.isEmpty() || this->walker->isRunning()) return;
+    QStringList treeDirs;
+    for (const QString &dir : dirs) {
+        if (dir == this->shownRoot || dir.startsWith(this->shownRoot + '/')) treeDirs.append(dir);
     }
+    if (!treeDirs.isEmpty()) {
+        QMetaObject::invokeMethod(this->scanner, "rescanDirectories", Qt::QueuedConnection, Q_ARG(QStringList, treeDirs));
+    }
+}
+
+void MainWindow::onPathsChecked(const QStringList &missing, const QStringList &present) {
+    GameManager::BatchGuard batch;
+    for (const QString &path : missing) GameManager::instance().setMissing(path, true);
+    for (const QString &path : present) GameManager::instance().setMissing(path, false);
 }
 
-void MainWindow::onGameFound(GameItem item) {
-    this->fileListTab->addGameItem(item);
+void MainWindow::onDirectoryScanned(const QString &dir, const QList<GameItem> &items, const ScanIndex::DirRecord &record) {
+    const QStringList newFolders = this->fileListTab->syncDirectory(dir, items);
+    for (const QString &folder : newFolders) {
+        this->folderWatcher->watch(folder);
+    }
+
+    // Keep the index in step, or the next walk would reuse the record from before the change.
+    // A running walk replaces the index when it finishes, so its baseline is left alone.
+    if (!this->scanIndex || record.mtime == 0 || this->walker->isRunning()) return;
+    if (this->scanIndex->root != this->shownRoot) return;
+    if (dir != this->shownRoot && !dir.startsWith(this->shownRoot + '/')) return;
+
+    ScanIndex::DirRecord updated = record;
+    if (dir == this->shownRoot) {
+        // The walk never classifies its root
+        updated.self = GameItem();
+        updated.self.type = GameType::Directory;
+        updated.probed.clear();
+    }
+    // Copied rather than edited in place: a background save may still hold the old index
+    QSharedPointer<ScanIndex> index(new ScanIndex(*this->scanIndex));
+    index->dirs.insert(dir, updated);
+    this->scanIndex = index;
+}
+
+void MainWindow::onFallbackScan() {
+    // Parts of the tree aren't watched; catch up with an incremental walk (only changed directories are listed)
+    GameManager::instance().verifyPaths();
+    if (!this->shownRoot.isEmpty() && !this->walker->isRunning()) {
+        this->walker->start(this->shownRoot, this->scanIndex, false);
+    }
 }
 
 void MainWindow::onScanFinished() {
@@ -122,4 +345,12 @@ void MainWindow::showGameInfoDialog(const GameItem &item) {
     if (dialog.exec() == QDialog::Accepted) {
         GameManager::instance().addGame(dialog.getGameItem());
     }
+}
+
+void MainWindow::addGamesToLibrary(const QList<GameItem> &items) {
+    // One journal write and one model update for the whole selection
+    GameManager::BatchGuard batch;
+    for (const GameItem &item : items) {
+        GameManager::instance().addGame(item);
+    }
 }
\ No newline at end of file
@@ -39,6 +39,29 @@ void MultiSelectComboBox::clearItems()
     updateText();
 }
 
+QStringList MultiSelectComboBox::itemDataList() const
+{
+    QStringList result;
+    for (int i = 0; i < model->rowCount(); ++i) {
+        result.append(model->item(i)->data(Qt::UserRole).toString());
+    }
+    return result;
+}
+
+void MultiSelectComboBox::setItemTextForData(const QString &userData, const QString &text)
+{
+    for (int i = 0; i < model->rowCount(); ++i) {
+        QStandardItem *item = model->item(i);
+        if (item->data(Qt::UserRole).toString() != userData) continue;
+        if (item->text() == text) return;
+        isUpdating = true;
+        item->setText(text);
+        isUpdating = false;
+        updateText();
+        return;
+    }
+}
+
 void MultiSelectComboBox::hidePopup()
 {
     int width = this->view()->width();
@@ -0,0 +1,236 @@
+#include "scanindex.h"
+#include "titlenormalizer.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+static const quint32 SCAN_INDEX_MAGIC = 0x47534958; // "GSIX"
+static const quint32 SCAN_INDEX_VERSION = 7;
+
+// A directory changed within this window of the previous walk may have been modified
+// again within the same mtime tick after it was listed, so its cached listing isn't trusted
+static const qint64 RACY_WINDOW_MS = 2000;
+
+const ScanIndex::DirRecord *ScanIndex::reusable(const QString &dir, qint64 mtime, quint64 inode) const {
+    auto it = this->dirs.constFind(dir);
+    if (it == this->dirs.constEnd()) return nullptr;
+    if (it.value().mtime != mtime || it.value().inode != inode) return nullptr;
+    if (mtime >= this->createdAt - RACY_WINDOW_MS) return nullptr;
+
+    // A file added to a probed subdirectory (an exe dropped into a folder's bin/, say) leaves
+    // dir's own mtime alone but can change how dir is classified
+    for (auto probe = it.value().probed.constBegin(); probe != it.value().probed.constEnd(); ++probe) {
+        qint64 probedMtime = 0;
+        quint64 probedInode = 0;
+        if (!statDirectory(probe.key(), probedMtime, probedInode) || probedMtime != probe.value()) return nullptr;
+        if (probedMtime >= this->createdAt - RACY_WINDOW_MS) return nullptr;
+    }
+    return &it.value();
+}
+
+bool ScanIndex::archiveCurrent(const DirRecord &record, const QString &path) const {
+    auto it = record.archives.constFind(path);
+    if (it == record.archives.constEnd()) return false;
+    FileStamp now;
+    if (!statFile(path, now)) return false;
+    if (now.size != it.value().size || now.mtime != it.value().mtime) return false;
+    return now.mtime < this->createdAt - RACY_WINDOW_MS;
+}
+
+QList<GameItem> ScanIndex::items() const {
+    QList<GameItem> out;
+    out.reserve(itemCount());
+    for (auto it = this->dirs.constBegin(); it != this->dirs.constEnd(); ++it) {
+        if (!it.value().self.filePath.isEmpty()) out.append(it.value().self);
+        out.append(it.value().items);
+    }
+    return out;
+}
+
+QList<GameItem> ScanIndex::itemsOf(const QString &dir) const {
+    auto it = this->dirs.constFind(dir);
+    if (it == this->dirs.constEnd()) return QList<GameItem>();
+    QList<GameItem> out;
+    if (!it.value().self.filePath.isEmpty()) out.append(it.value().self);
+    out.append(it.value().items);
+    return out;
+}
+
+int ScanIndex::itemCount() const {
+    int count = 0;
+    for (auto it = this->dirs.constBegin(); it != this->dirs.constEnd(); ++it) {
+        count += it.value().items.size() + (it.value().self.filePath.isEmpty() ? 0 : 1);
+    }
+    return count;
+}
+
+bool ScanIndex::load(const QString &path) {
+    this->dirs.clear();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != SCAN_INDEX_MAGIC || version != SCAN_INDEX_VERSION) {
+        qDebug() << "Ignoring scan index with unknown format:" << path;
+        return false;
+    }
+
+    quint32 dirCount;
+    in >> this->root >> this->createdAt >> this->titleRules >> dirCount;
+    this->dirs.reserve(dirCount);
+
+    for (quint32 d = 0; d < dirCount && in.status() == QDataStream::Ok; ++d) {
+        QString dir;
+        DirRecord record;
+        quint32 itemCount;
+        qint32 selfType;
+        in >> dir >> record.mtime >> record.inode >> record.subdirs;
+        in >> record.self.originalName >> record.self.cleanName >> selfType >> record.self.exePath;
+        in >> record.self.gameCode >> record.self.source >> record.probed >> itemCount;
+        record.self.type = static_cast<GameType>(selfType);
+        if (!record.self.originalName.isEmpty()) record.self.filePath = dir;
+
+        // Paths are stored once per directory rather than per item
+        const QString prefix = dir.endsWith('/') ? dir : dir + '/';
+        record.items.reserve(itemCount);
+        for (quint32 i = 0; i < itemCount && in.status() == QDataStream::Ok; ++i) {
+            GameItem item;
+            qint32 type;
+            in >> item.originalName >> item.cleanName >> type >> item.exePath >> item.gameCode >> item.source;
+            in >> item.contentSize >> item.contentFiles >> item.contentExecutables >> item.volumeLabel;
+            item.filePath = prefix + item.originalName;
+            item.type = static_cast<GameType>(type);
+            record.items.append(item);
+        }
+
+        quint32 archiveCount;
+        in >> archiveCount;
+        record.archives.reserve(archiveCount);
+        for (quint32 a = 0; a < archiveCount && in.status() == QDataStream::Ok; ++a) {
+            QString name;
+            FileStamp stamp;
+            in >> name >> stamp.size >> stamp.mtime;
+            record.archives.insert(prefix + name, stamp);
+        }
+        this->dirs.insert(dir, record);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        qDebug() << "Scan index is truncated:" << path;
+        this->dirs.clear();
+        return false;
+    }
+
+    const TitleNormalizer &normalizer = TitleNormalizer::instance();
+    if (this->titleRules != normalizer.rulesHash()) {
+        // title_rules.json changed since the walk; the listings are still good
+        auto renormalize = [&normalizer](GameItem &item, bool isFile) {
+            const TitleNormalizer::Result title = normalizer.normalize(item.originalName, isFile);
+            item.cleanName = title.cleanName;
+            item.gameCode = title.gameCode;
+            item.source = title.source;
+        };
+        for (auto it = this->dirs.begin(); it != this->dirs.end(); ++it) {
+            if (!it.value().self.originalName.isEmpty()) renormalize(it.value().self, false);
+            for (GameItem &item : it.value().items) renormalize(item, true);
+        }
+        this->titleRules = normalizer.rulesHash();
+    }
+    return true;
+}
+
+bool ScanIndex::save(const QString &path) const {
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out << SCAN_INDEX_MAGIC << SCAN_INDEX_VERSION;
+    out << this->root << this->createdAt << this->titleRules << quint32(this->dirs.size());
+    for (auto it = this->dirs.constBegin(); it != this->dirs.constEnd(); ++it) {
+        const DirRecord &record = it.value();
+        out << it.key() << record.mtime << record.inode << record.subdirs;
+        out << record.self.originalName << record.self.cleanName << qint32(record.self.type) << record.self.exePath;
+        out << record.self.gameCode << record.self.source << record.probed;
+        out << quint32(record.items.size());
+        for (const GameItem &item : record.items) {
+            out << item.originalName << item.cleanName << qint32(item.type) << item.exePath << item.gameCode << item.source;
+            out << item.contentSize << qint32(item.contentFiles) << item.contentExecutables << item.volumeLabel;
+        }
+        const int nameFrom = it.key().endsWith('/') ? it.key().size() : it.key().size() + 1;
+        out << quint32(record.archives.size());
+        for (auto stamp = record.archives.constBegin(); stamp != record.archives.constEnd(); ++stamp) {
+            out << stamp.key().mid(nameFrom) << stamp.value().size << stamp.value().mtime;
+        }
+    }
+
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        qDebug() << "Failed to write scan index" << path;
+        return false;
+    }
+    return true;
+}
+
+QString ScanIndex::pathForRoot(const QString &root) {
+    QString dataLocation = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QByteArray hash = QCryptographicHash::hash(QDir::cleanPath(root).toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QDir(dataLocation).filePath("scanindex/" + QString::fromLatin1(hash) + ".idx");
+}
+
+bool ScanIndex::statDirectory(const QString &path, qint64 &mtime, quint64 &inode) {
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0) return false;
+#if defined(Q_OS_DARWIN)
+    mtime = qint64(st.st_mtimespec.tv_sec) * 1000 + st.st_mtimespec.tv_nsec / 1000000;
+#else
+    mtime = qint64(st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000;
+#endif
+    inode = quint64(st.st_ino);
+    return true;
+#else
+    QFileInfo info(path);
+    if (!info.exists()) return false;
+    mtime = info.lastModified().toMSecsSinceEpoch();
+    inode = 0;
+    return true;
+#endif
+}
+
+bool ScanIndex::statFile(const QString &path, FileStamp &stamp) {
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0) return false;
+#if defined(Q_OS_DARWIN)
+    stamp.mtime = qint64(st.st_mtimespec.tv_sec) * 1000 + st.st_mtimespec.tv_nsec / 1000000;
+#else
+    stamp.mtime = qint64(st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000;
+#endif
+    stamp.size = qint64(st.st_size);
+    return true;
+#else
+    QFileInfo info(path);
+    if (!info.exists()) return false;
+    stamp.mtime = info.lastModified().toMSecsSinceEpoch();
+    stamp.size = info.size();
+    return true;
+#endif
+}
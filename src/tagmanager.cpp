@@ -1,5 +1,6 @@
 #include "tagmanager.h"
 #include <QDebug>
+#include <algorithm>
 
 TagManager& TagManager::instance() {
     static TagManager _instance;
@@ -25,10 +26,15 @@ QStringList TagManager::getTags() const {
     return this->tags;
 }
 
+void TagManager::insertSorted(const QString &tag) {
+    auto it = std::lower_bound(this->tags.begin(), this->tags.end(), tag);
+    this->tags.insert(it, tag);
+}
+
 void TagManager::addTag(const QString &tag) {
     if (!this->tags.contains(tag)) {
-        this->tags.append(tag);
-        this->tags.sort();
+        tagId(tag);
+        insertSorted(tag);
         saveTags();
         emit tagAdded(tag);
     }
@@ -38,19 +44,79 @@ void TagManager::removeTag(const QString &tag) {
     if (this->tags.removeOne(tag)) {
         saveTags();
         emit tagRemoved(tag);
+
+        // Retire the id only now; ids are never reused, so stale bits can't pick up another tag
+        int id = this->ids.take(tag);
+        this->names[id].clear();
     }
 }
 
 void TagManager::renameTag(const QString &oldTag, const QString &newTag) {
     int index = this->tags.indexOf(oldTag);
     if (index != -1 && !this->tags.contains(newTag)) {
-        this->tags[index] = newTag;
-        this->tags.sort();
+        int id = tagId(oldTag);
+        this->tags.removeAt(index);
+        insertSorted(newTag);
+
+        int existing = findTagId(newTag);
+        if (existing != -1) {
+            // The new name is already on some games (e.g. restored from the journal); fold into it
+            emit tagsMerged(id, existing);
+            this->ids.remove(oldTag);
+            this->names[id].clear();
+        } else {
+            // Same id, new name: games carrying it are renamed for free
+            this->ids.remove(oldTag);
+            this->ids.insert(newTag, id);
+            this->names[id] = newTag;
+        }
+
         saveTags();
         emit tagRenamed(oldTag, newTag);
     }
 }
 
+int TagManager::tagId(const QString &tag) {
+    auto it = this->ids.constFind(tag);
+    if (it != this->ids.constEnd()) return it.value();
+
+    int id = this->names.size();
+    this->names.append(tag);
+    this->ids.insert(tag, id);
+    return id;
+}
+
+int TagManager::findTagId(const QString &tag) const {
+    return this->ids.value(tag, -1);
+}
+
+QString TagManager::tagName(int id) const {
+    return (id >= 0 && id < this->names.size()) ? this->names[id] : QString();
+}
+
+QStringList TagManager::tagDictionary() const {
+    return this->names;
+}
+
+TagSet TagManager::toTagSet(const QStringList &tags) {
+    TagSet set;
+    for (const QString &tag : tags) {
+        if (!tag.isEmpty()) set.insert(tagId(tag));
+    }
+    return set;
+}
+
+QStringList TagManager::tagNames(const TagSet &set) const {
+    QStringList out;
+    const QList<int> tagIds = set.ids();
+    for (int id : tagIds) {
+        QString name = tagName(id);
+        if (!name.isEmpty()) out.append(name);
+    }
+    out.sort();
+    return out;
+}
+
 void TagManager::saveTags() {
     QJsonArray array;
     for (const QString &tag : this->tags) {
@@ -71,6 +137,7 @@ void TagManager::loadTags() {
         // Default tags
         this->tags << "Action" << "Adventure" << "RPG" << "Simulation" << "Strategy" << "Sports" << "FPS" << "Puzzle";
         this->tags.sort();
+        for (const QString &tag : this->tags) tagId(tag);
         saveTags();
         return;
     }
@@ -86,5 +153,6 @@ void TagManager::loadTags() {
             this->tags.append(val.toString());
         }
         this->tags.sort();
+        for (const QString &tag : this->tags) tagId(tag);
     }
 }
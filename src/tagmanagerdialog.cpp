@@ -1,5 +1,6 @@
 #include "tagmanagerdialog.h"
 #include "tagmanager.h"
+#include "gamemanager.h"
 #include <QInputDialog>
 #include <QMessageBox>
 
@@ -13,6 +14,7 @@ TagManagerDialog::TagManagerDialog(QWidget *parent) : QDialog(parent) {
     connect(&TagManager::instance(), &TagManager::tagAdded, this, &TagManagerDialog::refreshList);
     connect(&TagManager::instance(), &TagManager::tagRenamed, this, &TagManagerDialog::refreshList);
     connect(&TagManager::instance(), &TagManager::tagRemoved, this, &TagManagerDialog::refreshList);
+    connect(&GameManager::instance(), &GameManager::tagCountsChanged, this, &TagManagerDialog::refreshList);
 }
 
 void TagManagerDialog::setupUI() {
@@ -45,12 +47,35 @@ void TagManagerDialog::setupUI() {
 }
 
 void TagManagerDialog::refreshList() {
+    const QStringList tags = TagManager::instance().getTags();
+    auto label = [](const QString &tag) {
+        return QString("%1 (%2)").arg(tag).arg(GameManager::instance().tagCount(tag));
+    };
+
+    // Same tags, new counts: relabel in place so the selection stays
+    bool sameTags = this->tagList->count() == tags.size();
+    for (int i = 0; sameTags && i < tags.size(); ++i) {
+        sameTags = this->tagList->item(i)->data(Qt::UserRole).toString() == tags[i];
+    }
+    if (sameTags) {
+        for (int i = 0; i < tags.size(); ++i) {
+            const QString text = label(tags[i]);
+            if (this->tagList->item(i)->text() != text) this->tagList->item(i)->setText(text);
+        }
+        return;
+    }
+
+    const QListWidgetItem *current = this->tagList->currentItem();
+    const QString currentTag = current ? current->data(Qt::UserRole).toString() : QString();
     this->tagList->clear();
-    QStringList tags = TagManager::instance().getTags();
-    this->tagList->addItems(tags);
+    for (const QString &tag : tags) {
+        // Text shows the game count; the bare name is kept in UserRole for rename/remove
+        QListWidgetItem *item = new QListWidgetItem(label(tag), this->tagList);
+        item->setData(Qt::UserRole, tag);
+        if (tag == currentTag) this->tagList->setCurrentItem(item);
+    }
     
-    this->renameButton->setEnabled(false);
-    this->removeButton->setEnabled(false);
+    onSelectionChanged();
 }
 
 void TagManagerDialog::onSelectionChanged() {
@@ -73,7 +98,7 @@ void TagManagerDialog::renameTag() {
     QListWidgetItem *item = this->tagList->currentItem();
     if (!item) return;
     
-    QString oldTag = item->text();
+    QString oldTag = item->data(Qt::UserRole).toString();
     bool ok;
     QString text = QInputDialog::getText(this, tr("Rename Tag"),
                                          tr("New Tag Name:"), QLineEdit::Normal,
@@ -87,9 +112,10 @@ void TagManagerDialog::removeTag() {
     QListWidgetItem *item = this->tagList->currentItem();
     if (!item) return;
     
-    QString tag = item->text();
+    QString tag = item->data(Qt::UserRole).toString();
+    int count = GameManager::instance().tagCount(tag);
     if (QMessageBox::question(this, tr("Remove Tag"), 
-                              tr("Are you sure you want to remove tag '%1'?\nThis will remove it from all games.").arg(tag)) 
+                              tr("Are you sure you want to remove tag '%1'?\nThis will remove it from %2 game(s).").arg(tag).arg(count)) 
         == QMessageBox::Yes) {
         TagManager::instance().removeTag(tag);
     }
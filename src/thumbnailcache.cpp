@@ -0,0 +1,107 @@
+#include "thumbnailcache.h"
+#include "xxhash64.h"
+#include <QImageReader>
+#include <QFileInfo>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QDebug>
+
+static const ThumbnailCache::Size VARIANT_SIZES[] = {ThumbnailCache::Icon, ThumbnailCache::Preview, ThumbnailCache::Card};
+
+ThumbnailCache::Size ThumbnailCache::sizeFor(const QSize &target) {
+    const int side = qMax(target.width(), target.height());
+    for (Size size : VARIANT_SIZES) {
+        if (size >= side) return size;
+    }
+    return Card;
+}
+
+QImage ThumbnailCache::load(const QString &source, Size size) {
+    if (source.isEmpty()) return QImage();
+
+    QFileInfo info(source);
+    if (!info.exists()) return QImage();
+    const QDateTime modified = info.lastModified();
+
+    const QString path = variantPath(keyPrefix(source), size);
+    const QFileInfo variant(path);
+    if (variant.exists() && variant.lastModified().toMSecsSinceEpoch() == modified.toMSecsSinceEpoch()) {
+        QImageReader reader(path);
+        QImage image = reader.read();
+        if (!image.isNull()) return image;
+    }
+
+    return generate(source, modified, size);
+}
+
+void ThumbnailCache::ingest(const QString &source) {
+    if (source.isEmpty()) return;
+    QThreadPool::globalInstance()->start([source]() {
+        load(source, Icon);
+    });
+}
+
+void ThumbnailCache::discard(const QString &source) {
+    if (source.isEmpty()) return;
+    const QString prefix = keyPrefix(source);
+    for (Size size : VARIANT_SIZES) {
+        QFile::remove(variantPath(prefix, size));
+    }
+}
+
+QString ThumbnailCache::variantDir() {
+    QString dataLocation = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    return QDir(dataLocation).filePath("thumbnails/variants");
+}
+
+QString ThumbnailCache::keyPrefix(const QString &source) {
+    const QByteArray path = QFileInfo(source).absoluteFilePath().toUtf8();
+    return QString::number(XxHash64::hash(path.constData(), size_t(path.size())), 16).rightJustified(16, '0') + '_';
+}
+
+QString ThumbnailCache::variantPath(const QString &prefix, Size size) {
+    return QDir(variantDir()).filePath(prefix + QString::number(int(size)) + ".png");
+}
+
+QImage ThumbnailCache::generate(const QString &source, const QDateTime &modified, Size wanted) {
+    QImageReader reader(source);
+    reader.setAutoTransform(true);
+
+    // Decode straight to the largest variant instead of full size
+    const QSize fullSize = reader.size();
+    if (fullSize.isValid() && qMax(fullSize.width(), fullSize.height()) > Card) {
+        reader.setScaledSize(fullSize.scaled(Card, Card, Qt::KeepAspectRatio));
+    }
+    QImage largest = reader.read();
+    if (largest.isNull()) {
+        qDebug() << "Failed to decode thumbnail" << source << reader.errorString();
+        return QImage();
+    }
+
+    QDir().mkpath(variantDir());
+    const QString prefix = keyPrefix(source);
+
+    QImage result;
+    for (Size size : VARIANT_SIZES) {
+        QImage variant = largest;
+        if (qMax(largest.width(), largest.height()) > size) {
+            variant = largest.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+        if (size == wanted) result = variant;
+
+        const QString path = variantPath(prefix, size);
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || !variant.save(&file, "PNG") || !file.commit()) {
+            qDebug() << "Failed to write thumbnail variant" << path;
+            continue;
+        }
+        // Stamped after the rename: a reader in between just sees a mismatch and decodes again
+        QFile written(path);
+        if (written.open(QIODevice::ReadWrite)) written.setFileTime(modified, QFileDevice::FileModificationTime);
+    }
+    return result;
+}
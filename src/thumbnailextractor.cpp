@@ -0,0 +1,480 @@
+#include "thumbnailextractor.h"
+#include "thumbnailstore.h"
+#include "thumbnailcache.h"
+#include "thumbnailpreview.h"
+#include "archivereader.h"
+#include "directoryenumerator.h"
+#include "gamefolderdetector.h"
+#include "gamemanager.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QBuffer>
+#include <QImageReader>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtEndian>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+// Cover-like base names, best first
+static const char *const COVER_NAMES[] = {"cover", "folder", "title", "thumbnail", "thumb", "banner", "icon", "logo"};
+static const char *const IMAGE_SUFFIXES[] = {"png", "jpg", "jpeg", "webp", "bmp", "gif", "ico"};
+static const int DEPTH_RANKS = 16;
+
+static const int MAX_FOLDER_LISTINGS = 32;
+static const int MAX_IMAGE_ATTEMPTS = 4;
+static const qint64 MAX_IMAGE_BYTES = 16 * 1024 * 1024;
+static const qint64 MAX_EXECUTABLE_BYTES = 64 * 1024 * 1024;
+// Zip entries go through ArchiveReader's bit-at-a-time inflater, which is too slow for more
+static const qint64 MAX_ZIPPED_EXECUTABLE_BYTES = 4 * 1024 * 1024;
+static const qint64 MAX_AUTORUN_BYTES = 64 * 1024;
+static const qint64 MAX_RESOURCE_BYTES = 16 * 1024 * 1024;
+static const quint32 MAX_ICON_BYTES = 4 * 1024 * 1024;
+
+static const quint32 RT_ICON = 3;
+static const quint32 RT_GROUP_ICON = 14;
+
+struct ExtractionJob {
+    int total = 0;
+    int found = 0; // GUI thread only
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> done{0};
+
+    struct Result {
+        QString previousPath; // thumbnailPath the game had
+        QString imagePath;    // Stored image
+        QByteArray preview;
+    };
+    QMutex mutex;
+    // By filePath, not yet applied
+    QHash<QString, Result> results;
+};
+
+static quint16 le16(const char *p) { return qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(p)); }
+static quint32 le32(const char *p) { return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(p)); }
+
+static QByteArray readAt(QIODevice &device, qint64 offset, qint64 length) {
+    if (offset < 0 || length <= 0 || !device.seek(offset)) return QByteArray();
+    return device.read(length);
+}
+
+static bool isImageSuffix(const QString &lowerSuffix) {
+    for (const char *suffix : IMAGE_SUFFIXES) {
+        if (lowerSuffix == QLatin1String(suffix)) return true;
+    }
+    return false;
+}
+
+// Rank of a '/'-separated path as a cover image, lower is better; -1 if it isn't one
+static int coverRank(const QString &path) {
+    const QString fileName = path.mid(path.lastIndexOf('/') + 1).toLower();
+    const int dot = fileName.lastIndexOf('.');
+    if (dot <= 0 || !isImageSuffix(fileName.mid(dot + 1))) return -1;
+
+    const QString base = fileName.left(dot);
+    const int depth = qMin(int(path.count('/')), DEPTH_RANKS - 1);
+    for (int i = 0; i < int(sizeof(COVER_NAMES) / sizeof(COVER_NAMES[0])); ++i) {
+        const QLatin1String name(COVER_NAMES[i]);
+        // "cover", "cover_front", "title01"; not "icons" or "titlescreen"
+        if (base.startsWith(name) && (base.size() == name.size() || !base.at(name.size()).isLetter())) {
+            return i * DEPTH_RANKS + depth;
+        }
+    }
+    return -1;
+}
+
+// Largest frame of a multi-image file such as an .ico
+static QImage largestFrame(const QByteArray &data, const char *format = nullptr) {
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer, format);
+
+    QImage best;
+    const int count = qMax(1, reader.imageCount());
+    for (int i = 0; i < count; ++i) {
+        if (i > 0 && !reader.jumpToImage(i)) break;
+        const QImage image = reader.read();
+        if (qint64(image.width()) * image.height() > qint64(best.width()) * best.height()) best = image;
+    }
+    return best;
+}
+
+static QString findFolderCover(const QString &root) {
+    std::unique_ptr<DirectoryEnumerator> enumerator(DirectoryEnumerator::create());
+    QVector<DirectoryEnumerator::Entry> listing;
+
+    QString best;
+    int bestRank = -1;
+    QStringList dirs{QString()}; // Relative to root; the root and its direct subfolders
+    for (int d = 0; d < dirs.size(); ++d) {
+        const QString relative = dirs[d];
+        if (!enumerator->list(relative.isEmpty() ? root : root + '/' + relative, listing)) continue;
+
+        for (const DirectoryEnumerator::Entry &entry : listing) {
+            const QString path = relative.isEmpty() ? entry.name : relative + '/' + entry.name;
+            if (entry.isDir) {
+                if (relative.isEmpty() && dirs.size() < MAX_FOLDER_LISTINGS) dirs.append(path);
+                continue;
+            }
+            const int rank = coverRank(path);
+            if (rank >= 0 && (bestRank < 0 || rank < bestRank || (rank == bestRank && path < best))) {
+                bestRank = rank;
+                best = path;
+            }
+        }
+    }
+    return best.isEmpty() ? QString() : root + '/' + best;
+}
+
+static QString findSidecar(const QFileInfo &archive) {
+    const QString base = archive.absolutePath() + '/' + archive.completeBaseName() + '.';
+    for (const char *suffix : IMAGE_SUFFIXES) {
+        const QString path = base + QLatin1String(suffix);
+        if (QFileInfo::exists(path)) return path;
+    }
+    return QString();
+}
+
+static QImage archiveCover(const GameItem &game, const ArchiveReader::Info &archive) {
+    QVector<QPair<int, int>> candidates; // (rank, index)
+    for (int i = 0; i < archive.files.size(); ++i) {
+        const int rank = coverRank(archive.files[i]);
+        if (rank >= 0) candidates.append(qMakePair(rank, i));
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    // A candidate may be compressed with something other than deflate, or not an image at all
+    for (int i = 0; i < candidates.size() && i < MAX_IMAGE_ATTEMPTS; ++i) {
+        const QByteArray data = ArchiveReader::readEntry(game.filePath, game.type, archive, candidates[i].second, MAX_IMAGE_BYTES);
+        if (data.isEmpty()) continue;
+        const QImage image = archive.files[candidates[i].second].endsWith(".ico", Qt::CaseInsensitive)
+            ? largestFrame(data, "ico") : QImage::fromData(data);
+        if (!image.isNull()) return image;
+    }
+    return QImage();
+}
+
+static int indexOfFile(const ArchiveReader::Info &archive, const QString &path) {
+    for (int i = 0; i < archive.files.size(); ++i) {
+        if (archive.files[i].compare(path, Qt::CaseInsensitive) == 0) return i;
+    }
+    return -1;
+}
+
+static QImage entryIcon(const GameItem &game, const ArchiveReader::Info &archive, int index) {
+    if (index < 0) return QImage();
+    const qint64 maxBytes = game.type == GameType::Zip ? MAX_ZIPPED_EXECUTABLE_BYTES : MAX_EXECUTABLE_BYTES;
+    QByteArray data = ArchiveReader::readEntry(game.filePath, game.type, archive, index, maxBytes);
+    if (data.isEmpty()) return QImage();
+    if (archive.files[index].endsWith(".ico", Qt::CaseInsensitive)) return largestFrame(data, "ico");
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    return ThumbnailExtractor::executableIcon(buffer);
+}
+
+// icon= of the [autorun] section, '/'-separated and relative to the volume root
+static QString autorunIcon(const QByteArray &inf) {
+    bool inAutorun = false;
+    for (QString line : QString::fromLocal8Bit(inf).split('\n')) {
+        line = line.trimmed();
+        if (line.startsWith('[')) {
+            inAutorun = line.compare("[autorun]", Qt::CaseInsensitive) == 0;
+            continue;
+        }
+        const int equals = line.indexOf('=');
+        if (!inAutorun || equals < 0 || line.left(equals).trimmed().compare("icon", Qt::CaseInsensitive) != 0) continue;
+
+        // "icon=game.exe,0" picks a resource index; the largest icon is wanted anyway
+        QString value = line.mid(equals + 1).trimmed();
+        const int comma = value.lastIndexOf(',');
+        if (comma >= 0) value.truncate(comma);
+        value.remove('"');
+        value.replace('\\', '/');
+        while (value.startsWith('/')) value.remove(0, 1);
+        return value;
+    }
+    return QString();
+}
+
+static int mainExecutable(const ArchiveReader::Info &archive) {
+    QString best;
+    for (const QString &exe : archive.executables) {
+        if (GameFolderDetector::isHelperExecutable(exe.mid(exe.lastIndexOf('/') + 1))) continue;
+        if (best.isEmpty() || exe.count('/') < best.count('/')) best = exe;
+    }
+    return best.isEmpty() ? -1 : archive.files.indexOf(best);
+}
+
+ThumbnailExtractor::ThumbnailExtractor(QObject *parent) : QObject(parent) {
+    this->pool.setMaxThreadCount(4);
+
+    this->pollTimer.setInterval(250);
+    connect(&this->pollTimer, &QTimer::timeout, this, &ThumbnailExtractor::poll);
+}
+
+ThumbnailExtractor::~ThumbnailExtractor() {
+    cancel();
+    this->pool.waitForDone();
+}
+
+void ThumbnailExtractor::setConcurrency(int threads) {
+    this->pool.setMaxThreadCount(qMax(1, threads));
+}
+
+bool ThumbnailExtractor::isRunning() const {
+    return !this->current.isNull();
+}
+
+void ThumbnailExtractor::start(const QList<GameItem> &games) {
+    cancel();
+
+    QSharedPointer<ExtractionJob> job(new ExtractionJob);
+    job->total = games.size();
+    this->current = job;
+
+    for (const GameItem &game : games) {
+        this->pool.start([job, game]() { runGame(job, game); });
+    }
+
+    emit progress(0, job->total);
+    this->pollTimer.start();
+}
+
+void ThumbnailExtractor::cancel() {
+    if (!this->current) return;
+
+    // What was found so far is still worth keeping
+    applyResults(this->current);
+
+    // Queued tasks still run, but return as soon as they see the flag
+    this->current->cancelled = true;
+    this->current.reset();
+    this->pollTimer.stop();
+}
+
+void ThumbnailExtractor::poll() {
+    if (!this->current) return;
+    QSharedPointer<ExtractionJob> job = this->current;
+
+    applyResults(job);
+    const int done = job->done;
+    emit progress(done, job->total);
+    if (done < job->total) return;
+
+    this->pollTimer.stop();
+    this->current.reset();
+    emit finished(job->found, job->total);
+}
+
+void ThumbnailExtractor::applyResults(const QSharedPointer<ExtractionJob> &job) {
+    QHash<QString, ExtractionJob::Result> results;
+    {
+        QMutexLocker lock(&job->mutex);
+        results.swap(job->results);
+    }
+    if (results.isEmpty()) return;
+
+    GameManager &manager = GameManager::instance();
+    GameManager::BatchGuard batch(manager);
+    for (auto it = results.constBegin(); it != results.constEnd(); ++it) {
+        // Left alone if the user picked a thumbnail in the meantime
+        GameItem game = manager.getGameByPath(it.key());
+        if (game.filePath.isEmpty() || game.thumbnailPath != it.value().previousPath) continue;
+        game.thumbnailPath = it.value().imagePath;
+        game.thumbnailPreview = it.value().preview;
+        manager.updateGame(game);
+        ++job->found;
+    }
+}
+
+void ThumbnailExtractor::runGame(const QSharedPointer<ExtractionJob> &job, const GameItem &game) {
+    struct DoneGuard {
+        ExtractionJob &job;
+        ~DoneGuard() { ++job.done; }
+    } guard{*job};
+
+    if (job->cancelled) return;
+    if (!game.thumbnailPath.isEmpty() && QFileInfo::exists(game.thumbnailPath)) return;
+
+    const QString path = extract(game);
+    if (path.isEmpty() || job->cancelled) return;
+
+    // Table icons for the new rows are then ready before the view asks, and give the preview
+    const QByteArray preview = ThumbnailPreview::encode(ThumbnailCache::load(path, ThumbnailCache::Icon));
+
+    QMutexLocker lock(&job->mutex);
+    job->results.insert(game.filePath, ExtractionJob::Result{game.thumbnailPath, path, preview});
+}
+
+QString ThumbnailExtractor::extract(const GameItem &game) {
+    ThumbnailStore &store = ThumbnailStore::instance();
+    const QFileInfo info(game.filePath);
+    if (!info.exists()) return QString();
+
+    if (info.isDir()) {
+        const QString cover = findFolderCover(game.filePath);
+        if (!cover.isEmpty()) {
+            const QString stored = store.import(cover);
+            if (!stored.isEmpty()) return stored;
+        }
+        if (game.exePath.isEmpty()) return QString();
+
+        QFile exe(game.exePath);
+        if (!exe.open(QIODevice::ReadOnly)) return QString();
+        const QImage icon = executableIcon(exe);
+        return icon.isNull() ? QString() : store.store(icon);
+    }
+
+    const QString sidecar = findSidecar(info);
+    if (!sidecar.isEmpty()) {
+        const QString stored = store.import(sidecar);
+        if (!stored.isEmpty()) return stored;
+    }
+
+    if (!ArchiveReader::isArchive(game.type)) return QString();
+    const ArchiveReader::Info archive = ArchiveReader::read(game.filePath, game.type);
+    if (!archive.valid) return QString();
+
+    QImage image = archiveCover(game, archive);
+    if (image.isNull() && game.type == GameType::Iso) {
+        const int autorun = indexOfFile(archive, "autorun.inf");
+        if (autorun >= 0) {
+            const QByteArray inf = ArchiveReader::readEntry(game.filePath, game.type, archive, autorun, MAX_AUTORUN_BYTES);
+            const QString icon = autorunIcon(inf);
+            if (!icon.isEmpty()) image = entryIcon(game, archive, indexOfFile(archive, icon));
+        }
+    }
+    if (image.isNull()) image = entryIcon(game, archive, mainExecutable(archive));
+    return image.isNull() ? QString() : store.store(image);
+}
+
+QImage ThumbnailExtractor::executableIcon(QIODevice &device) {
+    // DOS stub, then the PE signature and COFF header
+    const QByteArray dos = readAt(device, 0, 64);
+    if (dos.size() < 64 || !dos.startsWith("MZ")) return QImage();
+    const qint64 peOffset = le32(dos.constData() + 0x3C);
+
+    const QByteArray coff = readAt(device, peOffset, 24);
+    if (coff.size() < 24 || !coff.startsWith(QByteArray("PE\0\0", 4))) return QImage();
+    const int sectionCount = le16(coff.constData() + 6);
+    const int optionalSize = le16(coff.constData() + 20);
+
+    // The resource table is the third data directory, at a different place in PE32 and PE32+
+    const QByteArray optional = readAt(device, peOffset + 24, optionalSize);
+    if (optionalSize < 2 || optional.size() < optionalSize) return QImage();
+    const quint16 magic = le16(optional.constData());
+    const int directories = magic == 0x20B ? 112 : (magic == 0x10B ? 96 : -1);
+    if (directories < 0 || optionalSize < directories + 3 * 8) return QImage();
+    const quint32 resourceRva = le32(optional.constData() + directories + 16);
+    const quint32 resourceSize = le32(optional.constData() + directories + 20);
+    if (resourceRva == 0 || resourceSize == 0) return QImage();
+
+    const QByteArray sections = readAt(device, peOffset + 24 + optionalSize, qint64(sectionCount) * 40);
+    auto fileOffset = [&sections](quint32 rva) -> qint64 {
+        for (int i = 0; i + 40 <= sections.size(); i += 40) {
+            const char *section = sections.constData() + i;
+            const quint32 address = le32(section + 12);
+            const quint32 span = qMax(le32(section + 8), le32(section + 16));
+            if (rva >= address && rva - address < span) return qint64(le32(section + 20)) + (rva - address);
+        }
+        return -1;
+    };
+
+    const QByteArray resources = readAt(device, fileOffset(resourceRva), qMin<qint64>(resourceSize, MAX_RESOURCE_BYTES));
+    if (resources.size() < 16) return QImage();
+
+    struct ResourceEntry {
+        qint64 id;          // -1 for named entries
+        quint32 offset;     // Into resources
+        bool isDirectory;
+    };
+    auto entries = [&resources](quint32 offset) {
+        QVector<ResourceEntry> out;
+        if (qint64(offset) + 16 > resources.size()) return out;
+        const char *dir = resources.constData() + offset;
+        const int count = le16(dir + 12) + le16(dir + 14);
+        for (int i = 0; i < count && qint64(offset) + 16 + (i + 1) * 8 <= resources.size(); ++i) {
+            const char *entry = dir + 16 + i * 8;
+            const quint32 name = le32(entry);
+            const quint32 data = le32(entry + 4);
+            out.append(ResourceEntry{(name & 0x80000000) ? -1 : qint64(name), data & 0x7FFFFFFF, (data & 0x80000000) != 0});
+        }
+        return out;
+    };
+
+    // Type -> name -> language; the first language of a name is as good as any
+    auto data = [&](ResourceEntry entry) -> QByteArray {
+        for (int level = 0; entry.isDirectory && level < 2; ++level) {
+            const QVector<ResourceEntry> children = entries(entry.offset);
+            if (children.isEmpty()) return QByteArray();
+            entry = children.first();
+        }
+        if (entry.isDirectory || qint64(entry.offset) + 16 > resources.size()) return QByteArray();
+        const char *leaf = resources.constData() + entry.offset;
+        const quint32 rva = le32(leaf);
+        const quint32 size = le32(leaf + 4);
+        if (size == 0 || size > MAX_ICON_BYTES) return QByteArray();
+        if (rva >= resourceRva && qint64(rva - resourceRva) + size <= resources.size()) {
+            return resources.mid(int(rva - resourceRva), int(size));
+        }
+        return readAt(device, fileOffset(rva), size);
+    };
+
+    QVector<ResourceEntry> groups, icons;
+    for (const ResourceEntry &type : entries(0)) {
+        if (!type.isDirectory) continue;
+        if (type.id == RT_GROUP_ICON) groups = entries(type.offset);
+        else if (type.id == RT_ICON) icons = entries(type.offset);
+    }
+    if (groups.isEmpty() || icons.isEmpty()) return QImage();
+
+    // The first group is the icon Explorer shows; its directory lists every size of it
+    const QByteArray group = data(groups.first());
+    if (group.size() < 6) return QImage();
+    const int count = le16(group.constData() + 4);
+    int best = -1;
+    qint64 bestScore = -1;
+    for (int i = 0; i < count && 6 + (i + 1) * 14 <= group.size(); ++i) {
+        const char *entry = group.constData() + 6 + i * 14;
+        const int width = quint8(entry[0]) ? quint8(entry[0]) : 256;
+        const int height = quint8(entry[1]) ? quint8(entry[1]) : 256;
+        const qint64 score = qint64(width) * height * 64 + le16(entry + 6);
+        if (score > bestScore) {
+            bestScore = score;
+            best = i;
+        }
+    }
+    if (best < 0) return QImage();
+
+    const char *chosen = group.constData() + 6 + best * 14;
+    const quint16 iconId = le16(chosen + 12);
+    QByteArray image;
+    for (const ResourceEntry &icon : icons) {
+        if (icon.id == iconId) {
+            image = data(icon);
+            break;
+        }
+    }
+    if (image.isEmpty()) return QImage();
+
+    // Vista-style 256px icons are plain PNG
+    if (image.startsWith("\x89PNG")) return QImage::fromData(image, "PNG");
+
+    // Otherwise a headerless DIB; give it the one-entry .ico header it lost when linked in
+    QByteArray ico(22, '\0');
+    qToLittleEndian<quint16>(1, ico.data() + 2);
+    qToLittleEndian<quint16>(1, ico.data() + 4);
+    std::copy(chosen, chosen + 8, ico.data() + 6); // Width, height, colours, reserved, planes, bit count
+    qToLittleEndian<quint32>(quint32(image.size()), ico.data() + 14);
+    qToLittleEndian<quint32>(22, ico.data() + 18);
+    ico += image;
+    return QImage::fromData(ico, "ICO");
+}
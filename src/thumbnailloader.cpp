@@ -0,0 +1,119 @@
+#include "thumbnailloader.h"
+#include "thumbnailpreview.h"
+#include <QElapsedTimer>
+#include <QMetaObject>
+
+ThumbnailLoader::ThumbnailLoader(QObject *parent) : QObject(parent) {
+    this->pool.setMaxThreadCount(this->maxWorkers);
+}
+
+ThumbnailLoader::~ThumbnailLoader() {
+    // Results posted after this point are dropped with the object's pending events
+    this->pool.waitForDone();
+}
+
+void ThumbnailLoader::setMaxWorkers(int workers) {
+    this->maxWorkers = qMax(1, workers);
+    this->pool.setMaxThreadCount(this->maxWorkers);
+    pump();
+}
+
+QString ThumbnailLoader::keyFor(const QString &path, ThumbnailCache::Size size) {
+    return path + '@' + QString::number(int(size));
+}
+
+void ThumbnailLoader::request(const QString &path, ThumbnailCache::Size size, int priority) {
+    if (path.isEmpty()) return;
+
+    const QString key = keyFor(path, size);
+    if (this->running.contains(key)) return;
+
+    auto it = this->queued.find(key);
+    if (it != this->queued.end()) {
+        this->queue.remove(it->order);
+    } else {
+        it = this->queued.insert(key, Request{path, size, 0});
+    }
+
+    it->order = (quint64(qMax(0, priority)) << 32) | this->sequence++;
+    this->queue.insert(it->order, key);
+    pump();
+}
+
+void ThumbnailLoader::setViewport(ThumbnailCache::Size size, const QStringList &visible, const QStringList &prefetch) {
+    QSet<QString> wanted;
+    wanted.reserve(visible.size() + prefetch.size());
+    for (const QString &path : visible) wanted.insert(keyFor(path, size));
+    for (const QString &path : prefetch) wanted.insert(keyFor(path, size));
+
+    for (auto it = this->queued.begin(); it != this->queued.end();) {
+        if (it->size == size && !wanted.contains(it.key())) {
+            this->queue.remove(it->order);
+            it = this->queued.erase(it);
+            ++this->counters.cancelled;
+        } else {
+            ++it;
+        }
+    }
+
+    // A path listed twice keeps its first, better place
+    QSet<QString> placed;
+    auto place = [&](const QString &path, int priority) {
+        if (path.isEmpty() || placed.contains(path)) return;
+        placed.insert(path);
+        request(path, size, priority);
+    };
+    for (int i = 0; i < visible.size(); ++i) place(visible[i], VISIBLE + i);
+    for (int i = 0; i < prefetch.size(); ++i) place(prefetch[i], PREFETCH + i);
+}
+
+bool ThumbnailLoader::isPending(const QString &path, ThumbnailCache::Size size) const {
+    const QString key = keyFor(path, size);
+    return this->queued.contains(key) || this->running.contains(key);
+}
+
+ThumbnailLoader::Stats ThumbnailLoader::stats() const {
+    Stats result = this->counters;
+    result.queued = this->queued.size();
+    result.running = this->running.size();
+    result.averageDecodeMs = result.completed > 0 ? this->totalDecodeMs / qint64(result.completed) : 0;
+    return result;
+}
+
+void ThumbnailLoader::pump() {
+    while (this->running.size() < this->maxWorkers && !this->queue.isEmpty()) {
+        const QString key = this->queue.take(this->queue.firstKey());
+        const Request request = this->queued.take(key);
+        this->running.insert(key);
+
+        this->pool.start([this, key, request]() {
+            QElapsedTimer timer;
+            timer.start();
+            QImage image = ThumbnailCache::load(request.path, request.size);
+            if (!image.isNull()) {
+                // The formats a pixmap stores natively, so the conversion on the GUI thread is a plain copy
+                image.convertTo(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+            }
+            const qint64 decodeMs = timer.elapsed();
+            // Here, next to the decode, so painting never has to
+            const QByteArray preview = ThumbnailPreview::encode(image);
+
+            QMetaObject::invokeMethod(this, [this, key, request, image, preview, decodeMs]() {
+                finish(key, request.path, request.size, image, preview, decodeMs);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void ThumbnailLoader::finish(const QString &key, const QString &path, ThumbnailCache::Size size, const QImage &image,
+                             const QByteArray &preview, qint64 decodeMs) {
+    this->running.remove(key);
+
+    ++this->counters.completed;
+    this->counters.lastDecodeMs = decodeMs;
+    this->counters.maxDecodeMs = qMax(this->counters.maxDecodeMs, decodeMs);
+    this->totalDecodeMs += decodeMs;
+
+    emit loaded(path, size, image, preview);
+    pump();
+}
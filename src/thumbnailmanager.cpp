@@ -1,176 +1,269 @@
 #include "thumbnailmanager.h"
+#include "capturebackend.h"
+#include "thumbnailcache.h"
+#include "thumbnailstore.h"
+#include "thumbnailpreview.h"
 #include <QGuiApplication>
-#include <QScreen>
-#include <QStandardPaths>
-#include <QDir>
-#include <QDateTime>
-#include <QDebug>
+#include <QElapsedTimer>
 #include <QFileInfo>
-#include <windows.h>
-#include <QWindow>
-#include <QRegularExpression>
+#include <QDebug>
+
+static const int POLL_MS = 250;
+// A new window gets this long to come to the front and repaint before it counts as ready
+static const qint64 SETTLE_MS = 1000;
+// On the 16x16 signatures below: grey range of a blank frame, mean channel difference of a still one
+static const int BLANK_RANGE = 12;
+static const int STILL_DIFFERENCE = 6;
+
+struct ThumbnailManager::Capture {
+    Request request;
+    QProcess *process = nullptr;
+    qint64 pid = 0;             // 0 until started
+    bool exited = false;
+    QElapsedTimer clock;
+    WId window = 0;
+    QElapsedTimer windowClock;  // Since window was found
+    QImage lastFrame;           // Last grab with something painted
+    QImage lastSignature;       // Downscaled previous grab, null if it was blank
+};
+
+static QImage signatureOf(const QImage &frame) {
+    return frame.scaled(16, 16, Qt::IgnoreAspectRatio, Qt::FastTransformation).convertToFormat(QImage::Format_RGB32);
+}
+
+// Black, white or a single colour: still loading, or a surface that was never drawn
+static bool isBlank(const QImage &signature) {
+    int lowest = 255, highest = 0;
+    for (int y = 0; y < signature.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(signature.constScanLine(y));
+        for (int x = 0; x < signature.width(); ++x) {
+            const int grey = qGray(line[x]);
+            lowest = qMin(lowest, grey);
+            highest = qMax(highest, grey);
+        }
+    }
+    return highest - lowest <= BLANK_RANGE;
+}
+
+static bool isStill(const QImage &a, const QImage &b) {
+    if (a.size() != b.size()) return false;
+    qint64 difference = 0;
+    for (int y = 0; y < a.height(); ++y) {
+        const QRgb *lineA = reinterpret_cast<const QRgb *>(a.constScanLine(y));
+        const QRgb *lineB = reinterpret_cast<const QRgb *>(b.constScanLine(y));
+        for (int x = 0; x < a.width(); ++x) {
+            difference += qAbs(qRed(lineA[x]) - qRed(lineB[x])) + qAbs(qGreen(lineA[x]) - qGreen(lineB[x]))
+                        + qAbs(qBlue(lineA[x]) - qBlue(lineB[x]));
+        }
+    }
+    return difference <= qint64(STILL_DIFFERENCE) * a.width() * a.height() * 3;
+}
 
 ThumbnailManager::ThumbnailManager(QObject *parent) : QObject(parent) {
-    this->process = new QProcess(this);
-    this->timer = new QTimer(this);
-    this->timer->setSingleShot(true);
-    
-    connect(this->timer, &QTimer::timeout, this, &ThumbnailManager::onTimeout);
-    connect(this->process, &QProcess::finished, this, &ThumbnailManager::onProcessFinished);
+    this->backend.reset(CaptureBackend::create());
+    if (!this->backend) {
+        qDebug() << "No window capture backend for platform" << QGuiApplication::platformName();
+    }
+
+    this->pollTimer.setInterval(POLL_MS);
+    connect(&this->pollTimer, &QTimer::timeout, this, &ThumbnailManager::poll);
 }
 
 ThumbnailManager::~ThumbnailManager() {
-    if (this->process->state() != QProcess::NotRunning) {
-        this->process->terminate();
-    }
+    // Whoever listens may already be half destroyed (a closing dialog owning this)
+    blockSignals(true);
+    cancel();
 }
 
-void ThumbnailManager::startCapture(const QString &exePath, const QString &gameName, int delaySec) {
+void ThumbnailManager::setBackend(CaptureBackend *backend) {
+    if (!this->running.isEmpty()) return;
+    this->backend.reset(backend);
+}
+
+void ThumbnailManager::setConcurrency(int games) {
+    this->maxConcurrent = qMax(1, games);
+    startNext();
+}
+
+int ThumbnailManager::concurrency() const {
+    return this->maxConcurrent;
+}
+
+bool ThumbnailManager::isRunning() const {
+    return !this->running.isEmpty() || !this->pending.isEmpty();
+}
+
+void ThumbnailManager::enqueue(const QString &id, const QString &exePath, int timeoutSec) {
     if (exePath.isEmpty()) {
-        emit captureFailed("Executable path is empty.");
+        report(id, QString(), QByteArray(), "Executable path is empty.");
         return;
     }
-    
-    this->currentExePath = exePath;
-    this->currentGameName = gameName;
-    
-    QFileInfo info(exePath);
-    this->process->setProgram(exePath);
-    this->process->setWorkingDirectory(info.absolutePath());
-    
-    qDebug() << "Starting process:" << exePath;
-    this->process->start();
-    
-    if (!this->process->waitForStarted()) {
-         emit captureFailed("Failed to start executable: " + this->process->errorString());
-         return;
+    this->pending.append(Request{id, exePath, qMax(1, timeoutSec) * 1000});
+    ++this->total;
+    startNext();
+}
+
+void ThumbnailManager::enqueue(const QList<GameItem> &games, int timeoutSec) {
+    for (const GameItem &game : games) {
+        if (game.exePath.isEmpty()) continue;
+        this->pending.append(Request{game.filePath, game.exePath, qMax(1, timeoutSec) * 1000});
+        ++this->total;
+    }
+    // Queued too, or it would overtake the progress of captures that just finished
+    const int done = this->done;
+    const int total = this->total;
+    QMetaObject::invokeMethod(this, [this, done, total]() { emit progress(done, total); }, Qt::QueuedConnection);
+    startNext();
+}
+
+void ThumbnailManager::cancel() {
+    this->total -= this->pending.size();
+    this->pending.clear();
+    for (Capture *capture : QList<Capture *>(this->running)) {
+        finish(capture, QImage(), "Cancelled.");
     }
-    
-    qDebug() << "Process started with PID:" << this->process->processId();
-    qDebug() << "Waiting for" << delaySec << "seconds...";
-    
-    this->timer->start(delaySec * 1000);
 }
 
-// Struct to pass data to EnumWindows callback
-struct EnumData {
-    DWORD processId;
-    HWND bestHandle;
-};
+void ThumbnailManager::startNext() {
+    while (this->running.size() < this->maxConcurrent && !this->pending.isEmpty()) {
+        const Request request = this->pending.takeFirst();
+        if (!this->backend) {
+            ++this->done;
+            report(request.id, QString(), QByteArray(), "Window capture isn't supported on this platform.");
+            continue;
+        }
+
+        Capture *capture = new Capture;
+        capture->request = request;
+        capture->process = new QProcess(this);
+        capture->process->setProgram(request.exePath);
+        capture->process->setWorkingDirectory(QFileInfo(request.exePath).absolutePath());
+        this->backend->prepare(*capture->process);
 
-// Callback for EnumWindows
-BOOL CALLBACK EnumWindowsProc(HWND hwnd, LPARAM lParam) {
-    EnumData* data = reinterpret_cast<EnumData*>(lParam);
-    DWORD processId = 0;
-    GetWindowThreadProcessId(hwnd, &processId);
-    
-    if (data->processId != processId) return TRUE; // Not our process
-    
-    // Check if visible
-    if (!IsWindowVisible(hwnd)) return TRUE;
-    
-    // Check if it has a title (avoid hidden/utility windows)
-    int length = GetWindowTextLength(hwnd);
-    if (length == 0) return TRUE;
-    
-    // Found a candidate. 
-    // Usually the first visible window with a title is the main window.
-    data->bestHandle = hwnd;
-    return FALSE; // Stop enumeration
-}
-
-void ThumbnailManager::onTimeout() {
-    qDebug() << "Timeout reached. Attempting capture...";
-    
-    if (this->process->state() == QProcess::NotRunning) {
-        emit captureFailed("Process exited before capture.");
+        // Started asynchronously; the poll timer takes over once the pid is known
+        connect(capture->process, &QProcess::started, this, [this, capture]() {
+            capture->pid = capture->process->processId();
+            this->backend->attach(*capture->process);
+        });
+        connect(capture->process, &QProcess::errorOccurred, this, [this, capture](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                finish(capture, QImage(), "Failed to start executable: " + capture->process->errorString());
+            }
+        });
+        // Not the end: a launcher stub exits once it has started the game proper
+        connect(capture->process, &QProcess::finished, this, [capture]() {
+            capture->exited = true;
+        });
+
+        this->running.append(capture);
+        capture->clock.start();
+        qDebug() << "Starting process:" << request.exePath;
+        capture->process->start();
+    }
+
+    if (!this->running.isEmpty()) {
+        if (!this->pollTimer.isActive()) this->pollTimer.start();
         return;
     }
-    
-    captureWindow(this->process->processId());
-}
-
-void ThumbnailManager::captureWindow(qint64 pid) {
-    EnumData data;
-    data.processId = static_cast<DWORD>(pid);
-    data.bestHandle = NULL;
-    
-    EnumWindows(EnumWindowsProc, reinterpret_cast<LPARAM>(&data));
-    
-    if (data.bestHandle) {
-        qDebug() << "Found Window Handle:" << data.bestHandle;
-        
-        // Bring to front to ensure it's not covered by GameDB
-        ShowWindow(data.bestHandle, SW_RESTORE);
-        SetForegroundWindow(data.bestHandle);
-        
-        // Wait a bit for the window to come to front and repaint
-        // 500ms should be enough
-        QTimer::singleShot(500, [this, pid, bestHandle = data.bestHandle]() {
-            doCapture(pid, reinterpret_cast<WId>(bestHandle));
-        });
-        
-    } else {
-        emit captureFailed("Could not find a visible window for the process.");
-        // Process cleanup if not found? 
-        this->process->terminate();
+    this->pollTimer.stop();
+    if (this->pending.isEmpty() && this->total > 0) {
+        this->total = 0;
+        this->done = 0;
+        // Behind the results report() has queued
+        QMetaObject::invokeMethod(this, &ThumbnailManager::finished, Qt::QueuedConnection);
     }
 }
 
-void ThumbnailManager::doCapture(qint64 pid, WId windowId) {
-    Q_UNUSED(pid);
-    QScreen *screen = QGuiApplication::primaryScreen();
-    if (screen) {
-        // grabWindow requires WId (which is HWND on Windows)
-        QPixmap pixmap = screen->grabWindow(windowId);
-        
-        if (!pixmap.isNull()) {
-            QString path = saveThumbnail(pixmap);
-            emit captureFinished(path);
-        } else {
-            emit captureFailed("Failed to grab window content.");
+void ThumbnailManager::poll() {
+    for (Capture *capture : QList<Capture *>(this->running)) {
+        if (capture->pid != 0) {
+            // Looked up every time: a splash screen is often replaced by the real window
+            const WId window = this->backend->findWindow(capture->pid);
+            if (window != capture->window) {
+                capture->window = window;
+                capture->lastSignature = QImage();
+                if (window) {
+                    this->backend->raise(window);
+                    capture->windowClock.start();
+                }
+            }
+
+            const QImage frame = window ? this->backend->grab(window) : QImage();
+            if (!frame.isNull()) {
+                const QImage signature = signatureOf(frame);
+                if (isBlank(signature)) {
+                    capture->lastSignature = QImage();
+                } else {
+                    const bool still = !capture->lastSignature.isNull() && isStill(signature, capture->lastSignature);
+                    capture->lastFrame = frame;
+                    capture->lastSignature = signature;
+                    if (still && capture->windowClock.elapsed() >= SETTLE_MS) {
+                        finish(capture, frame, QString());
+                        continue;
+                    }
+                }
+            }
+        }
+
+        if (capture->clock.elapsed() >= capture->request.timeoutMs) {
+            if (!capture->lastFrame.isNull()) {
+                // Never held still (an animated title screen); the latest frame is as good as any
+                finish(capture, capture->lastFrame, QString());
+            } else if (capture->exited && !capture->window) {
+                finish(capture, QImage(), "Process exited before a window appeared.");
+            } else {
+                finish(capture, QImage(), "Timed out waiting for the game window.");
+            }
         }
-    } else {
-         emit captureFailed("Primary screen not found.");
-    }
-    
-    // Cleanup process after capture attempt
-    // Force kill using taskkill for robust termination on Windows
-    QString pidStr = QString::number(pid);
-    QProcess::execute("taskkill", QStringList() << "/F" << "/PID" << pidStr);
-    
-    // Fallback/Cleanup internal state
-    if (this->process->state() != QProcess::NotRunning) {
-        this->process->kill();
     }
 }
 
-QString ThumbnailManager::saveThumbnail(const QPixmap &pixmap) {
-    QString dataLocation = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    QDir dir(dataLocation);
-    if (!dir.exists("thumbnails")) {
-        dir.mkdir("thumbnails");
+void ThumbnailManager::finish(Capture *capture, const QImage &frame, const QString &error) {
+    this->running.removeOne(capture);
+
+    QProcess *process = capture->process;
+    process->disconnect(this);
+    if (this->backend) this->backend->killProcessTree(*process);
+    // QProcess's destructor would block until the process is gone
+    if (process->state() == QProcess::NotRunning) {
+        process->deleteLater();
+    } else {
+        connect(process, &QProcess::finished, process, &QObject::deleteLater);
     }
-    
-    QString safeName = this->currentGameName;
-    safeName.replace(QRegularExpression("[^a-zA-Z0-9_]"), "_"); // Sanitize
-    if (safeName.isEmpty()) safeName = "game";
-    
-    QString filename = QString("%1_thumbnail.png").arg(safeName);
-    QString fullPath = dir.filePath("thumbnails/" + filename);
-    
-    if (pixmap.save(fullPath, "PNG")) {
-        return fullPath;
+
+    const QString id = capture->request.id;
+    delete capture;
+    ++this->done;
+
+    QString path;
+    QString reason = error;
+    if (reason.isEmpty()) {
+        path = saveThumbnail(frame);
+        if (path.isEmpty()) reason = "Failed to save the captured image.";
     }
-    return QString();
+    const QByteArray preview = path.isEmpty() ? QByteArray() : ThumbnailPreview::encode(frame);
+    report(id, path, preview, reason);
+
+    startNext();
+}
+
+void ThumbnailManager::report(const QString &id, const QString &path, const QByteArray &preview,
+                              const QString &reason) {
+    // From the event loop, once the queue's state is settled: a slot that opens a message
+    // box would otherwise run poll() again from inside poll() or cancel()
+    const int done = this->done;
+    const int total = this->total;
+    QMetaObject::invokeMethod(this, [this, id, path, preview, reason, done, total]() {
+        if (reason.isEmpty()) emit captureFinished(id, path, preview);
+        else emit captureFailed(id, reason);
+        emit progress(done, total);
+    }, Qt::QueuedConnection);
 }
 
-void ThumbnailManager::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus) {
-    Q_UNUSED(exitCode);
-    Q_UNUSED(exitStatus);
-    // If finished before timeout, we can't capture.
-    if (this->timer->isActive()) {
-        this->timer->stop();
-        // emit captureFailed("Process exited early."); // This might trigger confusingly if we called terminate()
+QString ThumbnailManager::saveThumbnail(const QImage &image) {
+    QString fullPath = ThumbnailStore::instance().store(image);
+    if (!fullPath.isEmpty()) {
+        ThumbnailCache::ingest(fullPath);
     }
+    return fullPath;
 }
@@ -0,0 +1,300 @@
+#include "thumbnailpack.h"
+#include "xxhash64.h"
+#include <QSaveFile>
+#include <QVector>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+static const char PACK_MAGIC[4] = {'G', 'D', 'T', 'P'};
+static const quint32 PACK_VERSION = 2;
+static const quint32 PACK_BYTE_ORDER = 0x01020304;
+static const qint64 PIXEL_ALIGNMENT = 64;
+
+static qint64 alignTo(qint64 value, qint64 alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static bool isPackedFormat(quint32 format) {
+    return format == QImage::Format_RGB32 || format == QImage::Format_ARGB32_Premultiplied;
+}
+
+static qint64 pixelBytesOf(const ThumbnailPack::Entry &entry) {
+    return alignTo(qint64(entry.bytesPerLine) * entry.height, PIXEL_ALIGNMENT);
+}
+
+// Null if the image can't be packed
+static QImage packable(QImage image) {
+    if (image.isNull() || image.width() > 0xFFFF || image.height() > 0xFFFF) return QImage();
+    if (!isPackedFormat(image.format())) {
+        image = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+    }
+    return image;
+}
+
+static ThumbnailPack::Entry entryFor(quint64 key, const QImage &image, qint64 pixelOffset) {
+    ThumbnailPack::Entry entry;
+    std::memset(&entry, 0, sizeof(ThumbnailPack::Entry));
+    entry.key = key;
+    entry.pixelOffset = quint64(pixelOffset);
+    entry.bytesPerLine = quint32(image.bytesPerLine());
+    entry.width = quint16(image.width());
+    entry.height = quint16(image.height());
+    entry.format = quint32(image.format());
+    return entry;
+}
+
+static bool writePixels(QFileDevice &file, const ThumbnailPack::Entry &entry, const QImage &image) {
+    QByteArray pixels(int(pixelBytesOf(entry)), '\0');
+    for (int y = 0; y < image.height(); ++y) {
+        std::memcpy(pixels.data() + qint64(y) * entry.bytesPerLine, image.constScanLine(y), entry.bytesPerLine);
+    }
+    return file.write(pixels) == pixels.size();
+}
+
+static bool writeTable(QFileDevice &file, QVector<ThumbnailPack::Entry> entries) {
+    // Sorted once here so lookups can binary search the mapped table
+    std::sort(entries.begin(), entries.end(), [](const ThumbnailPack::Entry &a, const ThumbnailPack::Entry &b) {
+        return a.key < b.key;
+    });
+    const qint64 bytes = qint64(entries.size()) * sizeof(ThumbnailPack::Entry);
+    return file.write(reinterpret_cast<const char *>(entries.constData()), bytes) == bytes;
+}
+
+ThumbnailPack::ThumbnailPack() {
+    std::memset(&this->header, 0, sizeof(Header));
+}
+
+ThumbnailPack::~ThumbnailPack() {
+    close();
+}
+
+bool ThumbnailPack::open(const QString &path) {
+    close();
+
+    this->file.setFileName(path);
+    if (!this->file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    this->size = this->file.size();
+    if (this->size < static_cast<qint64>(sizeof(Header))) {
+        close();
+        return false;
+    }
+
+    this->data = this->file.map(0, this->size);
+    if (!this->data) {
+        qDebug() << "Failed to map thumbnail pack" << path;
+        close();
+        return false;
+    }
+
+    std::memcpy(&this->header, this->data, sizeof(Header));
+    const Header &h = this->header;
+
+    bool valid = std::memcmp(h.magic, PACK_MAGIC, 4) == 0
+        && h.version == PACK_VERSION
+        && h.byteOrder == PACK_BYTE_ORDER
+        && h.entriesOffset % alignof(Entry) == 0
+        && h.pixelsOffset <= h.entriesOffset
+        && h.entriesOffset + quint64(h.entryCount) * sizeof(Entry) <= quint64(this->size);
+
+    if (!valid) {
+        qDebug() << "Thumbnail pack is damaged or from an unknown version:" << path;
+        close();
+        return false;
+    }
+
+    const Entry *table = entries();
+    for (quint32 i = 0; i < h.entryCount; ++i) this->live += pixelBytesOf(table[i]);
+    return true;
+}
+
+void ThumbnailPack::close() {
+    if (this->data) {
+        this->file.unmap(const_cast<uchar *>(this->data));
+        this->data = nullptr;
+    }
+    this->file.close();
+    this->size = 0;
+    this->live = 0;
+    std::memset(&this->header, 0, sizeof(Header));
+}
+
+bool ThumbnailPack::isOpen() const {
+    return this->data != nullptr;
+}
+
+int ThumbnailPack::count() const {
+    return this->data ? static_cast<int>(this->header.entryCount) : 0;
+}
+
+quint64 ThumbnailPack::keyFor(const QString &thumbnailPath, ThumbnailCache::Size size) {
+    const QByteArray path = thumbnailPath.toUtf8();
+    return XxHash64::hash(path.constData(), size_t(path.size()), quint64(size));
+}
+
+qint64 ThumbnailPack::liveBytes() const {
+    return this->live;
+}
+
+qint64 ThumbnailPack::deadBytes() const {
+    if (!this->data) return 0;
+    const qint64 table = qint64(this->header.entryCount) * sizeof(Entry);
+    return this->size - qint64(this->header.pixelsOffset) - this->live - table;
+}
+
+const ThumbnailPack::Entry *ThumbnailPack::entries() const {
+    return reinterpret_cast<const Entry *>(this->data + this->header.entriesOffset);
+}
+
+const ThumbnailPack::Entry *ThumbnailPack::find(quint64 key) const {
+    if (!this->data) return nullptr;
+
+    const Entry *first = entries();
+    const Entry *last = first + this->header.entryCount;
+    const Entry *it = std::lower_bound(first, last, key, [](const Entry &entry, quint64 value) {
+        return entry.key < value;
+    });
+    return (it != last && it->key == key) ? it : nullptr;
+}
+
+bool ThumbnailPack::contains(quint64 key) const {
+    return find(key) != nullptr;
+}
+
+QImage ThumbnailPack::image(quint64 key) const {
+    const Entry *entry = find(key);
+    if (!entry || !isPackedFormat(entry->format)) return QImage();
+
+    // A damaged entry must not reach outside the mapping
+    const quint64 bytes = quint64(entry->bytesPerLine) * entry->height;
+    if (entry->bytesPerLine < quint32(entry->width) * 4
+        || this->header.pixelsOffset + entry->pixelOffset + bytes > quint64(this->size)) {
+        return QImage();
+    }
+
+    // The const-data constructor never writes to or frees the buffer
+    return QImage(this->data + this->header.pixelsOffset + entry->pixelOffset, entry->width, entry->height,
+                  entry->bytesPerLine, static_cast<QImage::Format>(entry->format));
+}
+
+bool ThumbnailPack::write(const QString &path, const ThumbnailPack *base, const QHash<quint64, QImage> &images,
+                          const QSet<quint64> &dropped, qint64 byteBudget) {
+    struct Source {
+        quint64 key;
+        QImage image;
+        bool fresh;
+    };
+
+    QVector<Source> sources;
+    for (auto it = images.constBegin(); it != images.constEnd(); ++it) {
+        const QImage image = packable(it.value());
+        if (!image.isNull()) sources.append(Source{it.key(), image, true});
+    }
+    if (base && base->isOpen()) {
+        const Entry *entries = base->entries();
+        for (quint32 i = 0; i < base->header.entryCount; ++i) {
+            const quint64 key = entries[i].key;
+            if (images.contains(key) || dropped.contains(key)) continue;
+            QImage image = base->image(key);
+            if (!image.isNull()) sources.append(Source{key, image, false});
+        }
+    }
+
+    // Icons are tiny and on every table row, so they go in before any card
+    std::stable_sort(sources.begin(), sources.end(), [](const Source &a, const Source &b) {
+        const qint64 areaA = qint64(a.image.width()) * a.image.height();
+        const qint64 areaB = qint64(b.image.width()) * b.image.height();
+        if (areaA != areaB) return areaA < areaB;
+        return a.fresh && !b.fresh;
+    });
+
+    QVector<Entry> entries;
+    QVector<const Source *> packed;
+    qint64 pixelBytes = 0;
+    for (const Source &source : sources) {
+        const Entry entry = entryFor(source.key, source.image, pixelBytes);
+        const qint64 bytes = pixelBytesOf(entry);
+        if (pixelBytes + bytes > byteBudget) continue;
+        entries.append(entry);
+        packed.append(&source);
+        pixelBytes += bytes;
+    }
+
+    Header h;
+    std::memset(&h, 0, sizeof(Header));
+    std::memcpy(h.magic, PACK_MAGIC, 4);
+    h.version = PACK_VERSION;
+    h.byteOrder = PACK_BYTE_ORDER;
+    h.entryCount = quint32(entries.size());
+    h.pixelsOffset = alignTo(sizeof(Header), PIXEL_ALIGNMENT);
+    h.entriesOffset = h.pixelsOffset + quint64(pixelBytes);
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to write thumbnail pack" << path;
+        return false;
+    }
+
+    // Written in sections rather than assembled in memory: a full pack can be hundreds of megabytes
+    QByteArray head(int(h.pixelsOffset), '\0');
+    std::memcpy(head.data(), &h, sizeof(Header));
+    bool ok = file.write(head) == head.size();
+    for (int i = 0; ok && i < entries.size(); ++i) {
+        ok = writePixels(file, entries[i], packed[i]->image);
+    }
+    ok = ok && writeTable(file, entries);
+
+    if (!ok || !file.commit()) {
+        qDebug() << "Failed to write thumbnail pack" << path;
+        return false;
+    }
+    return true;
+}
+
+bool ThumbnailPack::append(const QString &path, const ThumbnailPack *base, const QHash<quint64, QImage> &images,
+                           const QSet<quint64> &dropped) {
+    if (!base || !base->isOpen()) return false;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qDebug() << "Failed to append to thumbnail pack" << path;
+        return false;
+    }
+
+    // Behind whatever is there, a failed earlier append included: mapped bytes stay untouched
+    Header h = base->header;
+    qint64 end = alignTo(file.size(), PIXEL_ALIGNMENT);
+    bool ok = file.seek(file.size()) && file.write(QByteArray(int(end - file.size()), '\0')) == end - file.size();
+
+    QVector<Entry> entries;
+    for (auto it = images.constBegin(); ok && it != images.constEnd(); ++it) {
+        const QImage image = packable(it.value());
+        if (image.isNull()) continue;
+        const Entry entry = entryFor(it.key(), image, end - qint64(h.pixelsOffset));
+        ok = writePixels(file, entry, image);
+        entries.append(entry);
+        end += pixelBytesOf(entry);
+    }
+
+    const Entry *old = base->entries();
+    for (quint32 i = 0; i < h.entryCount; ++i) {
+        if (!images.contains(old[i].key) && !dropped.contains(old[i].key)) entries.append(old[i]);
+    }
+    ok = ok && writeTable(file, entries) && file.flush();
+
+    // The table is complete on disk before the header points at it; a crash before this
+    // leaves the old header and table, and the new bytes as dead ones
+    h.entryCount = quint32(entries.size());
+    h.entriesOffset = quint64(end);
+    ok = ok && file.seek(0) && file.write(reinterpret_cast<const char *>(&h), sizeof(Header)) == qint64(sizeof(Header));
+    ok = ok && file.flush();
+
+    if (!ok) {
+        qDebug() << "Failed to append to thumbnail pack" << path;
+        return false;
+    }
+    return true;
+}
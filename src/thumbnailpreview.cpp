@@ -0,0 +1,73 @@
+#include "thumbnailpreview.h"
+#include <QColor>
+
+// Same grey as ImageProvider's placeholder
+static const int BACKGROUND = 200;
+
+QByteArray ThumbnailPreview::encode(const QImage &image) {
+    if (image.isNull()) return QByteArray();
+
+    const QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+    const int width = argb.width();
+    const int height = argb.height();
+    int columns = GRID;
+    int rows = GRID;
+    if (width >= height) rows = qBound(1, qRound(double(GRID) * height / width), GRID);
+    else columns = qBound(1, qRound(double(GRID) * width / height), GRID);
+
+    QByteArray code;
+    code.reserve(1 + columns * rows * 3);
+    code.append(char(columns << 4 | rows));
+
+    for (int row = 0; row < rows; ++row) {
+        const int top = row * height / rows;
+        const int bottom = qMax(top + 1, (row + 1) * height / rows);
+        for (int column = 0; column < columns; ++column) {
+            const int left = column * width / columns;
+            const int right = qMax(left + 1, (column + 1) * width / columns);
+
+            qint64 red = 0, green = 0, blue = 0;
+            for (int y = top; y < bottom; ++y) {
+                const QRgb *line = reinterpret_cast<const QRgb *>(argb.constScanLine(y));
+                for (int x = left; x < right; ++x) {
+                    const int alpha = qAlpha(line[x]);
+                    red += qRed(line[x]) * alpha + BACKGROUND * (255 - alpha);
+                    green += qGreen(line[x]) * alpha + BACKGROUND * (255 - alpha);
+                    blue += qBlue(line[x]) * alpha + BACKGROUND * (255 - alpha);
+                }
+            }
+            const qint64 weight = qint64(bottom - top) * (right - left) * 255;
+            code.append(char(red / weight));
+            code.append(char(green / weight));
+            code.append(char(blue / weight));
+        }
+    }
+    return code;
+}
+
+bool ThumbnailPreview::isValid(const QByteArray &code) {
+    if (code.isEmpty()) return false;
+    const int columns = quint8(code[0]) >> 4;
+    const int rows = quint8(code[0]) & 0x0F;
+    return columns >= 1 && columns <= GRID && rows >= 1 && rows <= GRID && code.size() == 1 + columns * rows * 3;
+}
+
+QImage ThumbnailPreview::decode(const QByteArray &code, int longSide) {
+    if (!isValid(code) || longSide <= 0) return QImage();
+
+    const int columns = quint8(code[0]) >> 4;
+    const int rows = quint8(code[0]) & 0x0F;
+    QImage grid(columns, rows, QImage::Format_RGB32);
+    const uchar *cell = reinterpret_cast<const uchar *>(code.constData()) + 1;
+    for (int y = 0; y < rows; ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(grid.scanLine(y));
+        for (int x = 0; x < columns; ++x, cell += 3) {
+            line[x] = qRgb(cell[0], cell[1], cell[2]);
+        }
+    }
+
+    // Bilinear upscaling of a handful of pixels is what blurs the cells into each other
+    const QSize target = columns >= rows ? QSize(longSide, qMax(1, longSide * rows / columns))
+                                         : QSize(qMax(1, longSide * columns / rows), longSide);
+    return grid.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
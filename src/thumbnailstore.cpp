@@ -0,0 +1,216 @@
+#include "thumbnailstore.h"
+#include "thumbnailcache.h"
+#include "gamemanager.h"
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QBuffer>
+#include <QImageReader>
+#include <QDateTime>
+#include <QThreadPool>
+#include <QPointer>
+#include <QDebug>
+#include <algorithm>
+
+// Unreferenced files this young may belong to a dialog that hasn't saved its game yet
+static const qint64 GRACE_PERIOD_SECS = 60 * 60;
+
+ThumbnailStore &ThumbnailStore::instance() {
+    static ThumbnailStore _instance;
+    return _instance;
+}
+
+ThumbnailStore::ThumbnailStore(QObject *parent) : QObject(parent) {
+    QString dataLocation = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    this->root = QDir::cleanPath(QDir(dataLocation).filePath("thumbnails/store"));
+}
+
+QString ThumbnailStore::pathFor(const QByteArray &hash, const QString &suffix) const {
+    const QString hex = QString::fromLatin1(hash.toHex());
+    return this->root + '/' + hex.left(2) + '/' + hex + '.' + suffix;
+}
+
+QString ThumbnailStore::write(const QByteArray &bytes, const QString &suffix) {
+    const QString path = pathFor(QCryptographicHash::hash(bytes, QCryptographicHash::Sha256), suffix);
+
+    // Same bytes, same name: an identical image is already there. It may be an old orphan
+    // about to be used again, so it starts a new grace period like a fresh file would.
+    if (QFileInfo::exists(path)) {
+        QFile existing(path);
+        if (existing.open(QIODevice::ReadWrite)) {
+            existing.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        }
+        return path;
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size() || !file.commit()) {
+        qDebug() << "Failed to store thumbnail" << path;
+        return QString();
+    }
+    return path;
+}
+
+QString ThumbnailStore::store(const QImage &image) {
+    if (image.isNull()) return QString();
+
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, "PNG")) return QString();
+    return write(bytes, "png");
+}
+
+QString ThumbnailStore::import(const QString &filePath) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return QString();
+    const QByteArray bytes = file.readAll();
+
+    QBuffer buffer;
+    buffer.setData(bytes);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    if (!reader.canRead()) return QString();
+
+    QString suffix = QString::fromLatin1(reader.format()).toLower();
+    if (suffix == "jpeg") suffix = "jpg";
+    return write(bytes, suffix);
+}
+
+bool ThumbnailStore::isStored(const QString &path) const {
+    return !path.isEmpty() && QDir::cleanPath(path).startsWith(this->root + '/');
+}
+
+QHash<QString, int> ThumbnailStore::referenceCounts() const {
+    QHash<QString, int> counts;
+    // Just the one field, so rows still in the library snapshot aren't decoded
+    const LibraryTable &games = GameManager::instance().getGames();
+    for (int row = 0; row < games.size(); ++row) {
+        const QString thumbnailPath = games.thumbnailPathAt(row);
+        if (isStored(thumbnailPath)) ++counts[QDir::cleanPath(thumbnailPath)];
+    }
+    return counts;
+}
+
+void ThumbnailStore::setDiskBudget(qint64 bytes) {
+    this->diskBudget = qMax<qint64>(0, bytes);
+}
+
+void ThumbnailStore::startMaintenance() {
+    if (this->maintaining) return;
+    this->maintaining = true;
+
+    // Taken on the GUI thread; files stored while the job runs are young enough to be kept
+    const QHash<QString, int> references = referenceCounts();
+    const QString root = this->root;
+    const qint64 budget = this->diskBudget;
+    QPointer<ThumbnailStore> self(this);
+
+    QThreadPool::globalInstance()->start([self, references, root, budget]() {
+        // Stored files are never rewritten, so content that hashed correctly once is only
+        // re-hashed if it changed since; older files just have to still look like an image
+        const QString stampPath = root + "/.verified";
+        QDateTime lastVerified;
+        QFile stamp(stampPath);
+        if (stamp.open(QIODevice::ReadOnly)) {
+            lastVerified = QDateTime::fromMSecsSinceEpoch(stamp.readAll().trimmed().toLongLong());
+            stamp.close();
+        }
+        const QDateTime startedAt = QDateTime::currentDateTime();
+
+        struct StoredFile {
+            QString path;
+            qint64 size;
+            QDateTime modified;
+        };
+
+        int checked = 0;
+        QStringList damaged;
+        QStringList removed;
+        qint64 bytesFreed = 0;
+        QList<StoredFile> files;
+
+        QDirIterator it(root, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString path = it.next();
+            const QFileInfo info = it.fileInfo();
+            if (info.fileName().startsWith('.')) continue;
+            ++checked;
+
+            bool intact;
+            if (lastVerified.isValid() && info.lastModified() < lastVerified) {
+                intact = info.size() > 0 && QImageReader(path).canRead();
+            } else {
+                // The name is the hash of the content
+                QFile file(path);
+                QCryptographicHash hash(QCryptographicHash::Sha256);
+                intact = file.open(QIODevice::ReadOnly) && hash.addData(&file)
+                    && QString::fromLatin1(hash.result().toHex()) == info.completeBaseName();
+            }
+            if (!intact) {
+                qDebug() << "Removing damaged thumbnail" << path;
+                if (QFile::remove(path)) {
+                    damaged.append(path);
+                    bytesFreed += info.size();
+                    ThumbnailCache::discard(path);
+                }
+                continue;
+            }
+
+            files.append(StoredFile{path, info.size(), info.lastModified()});
+        }
+
+        QStringList missing;
+        for (auto ref = references.constBegin(); ref != references.constEnd(); ++ref) {
+            if (!QFileInfo::exists(ref.key())) missing.append(ref.key());
+        }
+
+        // Only orphans past the grace period may go, so only they count against the budget;
+        // referenced images filling it must not sweep away anything else. Oldest go first.
+        std::sort(files.begin(), files.end(), [](const StoredFile &a, const StoredFile &b) {
+            return a.modified < b.modified;
+        });
+        const QDateTime graceLimit = QDateTime::currentDateTime().addSecs(-GRACE_PERIOD_SECS);
+        QList<StoredFile> freeable;
+        qint64 freeableBytes = 0;
+        for (const StoredFile &file : files) {
+            if (references.contains(file.path) || file.modified > graceLimit) continue;
+            freeable.append(file);
+            freeableBytes += file.size;
+        }
+        for (const StoredFile &file : freeable) {
+            if (freeableBytes <= budget) break;
+            // Stored again since the listing
+            if (QFileInfo(file.path).lastModified() > graceLimit) {
+                freeableBytes -= file.size;
+                continue;
+            }
+            if (QFile::remove(file.path)) {
+                removed.append(file.path);
+                bytesFreed += file.size;
+                freeableBytes -= file.size;
+                ThumbnailCache::discard(file.path);
+            }
+        }
+        removed += damaged;
+
+        QDir().mkpath(root);
+        QSaveFile stampOut(stampPath);
+        if (stampOut.open(QIODevice::WriteOnly)) {
+            stampOut.write(QByteArray::number(startedAt.toMSecsSinceEpoch()));
+            stampOut.commit();
+        }
+
+        if (!self) return;
+        QMetaObject::invokeMethod(self.data(), [self, checked, damaged, missing, removed, bytesFreed]() {
+            if (!self) return;
+            self->maintaining = false;
+            emit self->maintenanceFinished(checked, damaged, missing, removed, bytesFreed);
+        }, Qt::QueuedConnection);
+    });
+}
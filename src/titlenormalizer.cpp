@@ -0,0 +1,324 @@
+#include "titlenormalizer.h"
+#include "xxhash64.h"
+#include <QFile>
+#include <QDir>
+#include <QStandardPaths>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <algorithm>
+
+// Separators left over at the ends once codes and versions are gone, e.g. "RJ123456 - Title"
+static const QString TRIM_CHARS = QStringLiteral(" -~.,:;_+");
+
+// Full-width ASCII (U+FF01..U+FF5E) and the ideographic space to their half-width forms
+static inline QChar foldWidth(QChar c) {
+    const ushort u = c.unicode();
+    if (u >= 0xFF01 && u <= 0xFF5E) return QChar(ushort(u - 0xFEE0));
+    if (u == 0x3000) return QChar(' ');
+    return c;
+}
+
+static inline ushort lowerAscii(QChar c) {
+    const ushort u = foldWidth(c).unicode();
+    return (u >= 'A' && u <= 'Z') ? ushort(u + 32) : u;
+}
+
+static inline bool isDigit(QChar c) {
+    const ushort u = foldWidth(c).unicode();
+    return u >= '0' && u <= '9';
+}
+
+static inline bool isWordChar(QChar c) {
+    return foldWidth(c).isLetterOrNumber();
+}
+
+TitleNormalizer::TitleNormalizer() {
+    QVector<CodeRule> codes;
+    for (const char *prefix : {"RJ", "RE", "VJ", "BJ"}) {
+        CodeRule rule;
+        rule.prefix = prefix;
+        rule.source = "DLsite";
+        codes.append(rule);
+    }
+
+    CodeRule dmm;
+    dmm.prefix = "d_";
+    dmm.minDigits = 5;
+    dmm.maxDigits = 7;
+    dmm.source = "DMM";
+    codes.append(dmm);
+
+    CodeRule steam;
+    steam.prefix = "steam";
+    steam.separators = " _-";
+    steam.minDigits = 1;
+    steam.maxDigits = 10;
+    steam.source = "Steam";
+    steam.keepPrefix = false;
+    codes.append(steam);
+
+    setRules(QStringList() << "()" << "[]" << "{}" << QString::fromUtf8("【】") << QString::fromUtf8("〔〕"),
+             codes,
+             QStringList() << "version" << "ver." << "ver" << "v");
+}
+
+const TitleNormalizer &TitleNormalizer::instance() {
+    static const TitleNormalizer normalizer = [] {
+        TitleNormalizer loaded;
+        QString dataLocation = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        QString path = QDir(dataLocation).filePath("title_rules.json");
+        if (QFile::exists(path) && !loaded.loadRules(path)) {
+            qDebug() << "Ignoring invalid title rules" << path;
+        }
+        return loaded;
+    }();
+    return normalizer;
+}
+
+bool TitleNormalizer::loadRules(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject()) return false;
+    QJsonObject root = doc.object();
+
+    QStringList brackets;
+    for (int i = 0; i < this->openers.size(); ++i) brackets.append(QString(this->openers[i]) + this->closers[i]);
+    if (root.contains("brackets")) {
+        brackets.clear();
+        for (const auto &val : root.value("brackets").toArray()) brackets.append(val.toString());
+    }
+
+    QVector<CodeRule> codes = this->codeRules;
+    if (root.contains("codes")) {
+        codes.clear();
+        for (const auto &val : root.value("codes").toArray()) {
+            QJsonObject obj = val.toObject();
+            CodeRule rule;
+            rule.prefix = obj.value("prefix").toString();
+            rule.separators = obj.value("separators").toString();
+            rule.minDigits = obj.value("minDigits").toInt(rule.minDigits);
+            rule.maxDigits = obj.value("maxDigits").toInt(rule.maxDigits);
+            rule.source = obj.value("source").toString();
+            rule.keepPrefix = obj.value("keepPrefix").toBool(rule.keepPrefix);
+            codes.append(rule);
+        }
+    }
+
+    QStringList versions = this->versionPrefixes;
+    if (root.contains("versionPrefixes")) {
+        versions.clear();
+        for (const auto &val : root.value("versionPrefixes").toArray()) versions.append(val.toString());
+    }
+
+    setRules(brackets, codes, versions);
+    return true;
+}
+
+void TitleNormalizer::setRules(const QStringList &bracketPairs, const QVector<CodeRule> &codes, const QStringList &versionPrefixes) {
+    this->openers.clear();
+    this->closers.clear();
+    for (const QString &pair : bracketPairs) {
+        if (pair.size() != 2) continue;
+        this->openers.append(foldWidth(pair[0]));
+        this->closers.append(foldWidth(pair[1]));
+    }
+
+    this->codeRules.clear();
+    for (const CodeRule &rule : codes) {
+        if (rule.prefix.isEmpty() || rule.minDigits < 1 || rule.maxDigits < rule.minDigits) continue;
+        this->codeRules.append(rule);
+    }
+
+    this->versionPrefixes.clear();
+    for (const QString &prefix : versionPrefixes) {
+        if (!prefix.isEmpty()) this->versionPrefixes.append(prefix.toLower());
+    }
+
+    compile();
+}
+
+void TitleNormalizer::compile() {
+    for (int c = 0; c < DISPATCH_SIZE; ++c) {
+        this->codesByFirst[c].clear();
+        this->versionsByFirst[c].clear();
+    }
+
+    for (int i = 0; i < this->codeRules.size(); ++i) {
+        const ushort first = lowerAscii(this->codeRules[i].prefix[0]);
+        if (first < DISPATCH_SIZE) this->codesByFirst[first].append(i);
+    }
+
+    // Longest prefix first, so "ver." wins over "v"
+    std::stable_sort(this->versionPrefixes.begin(), this->versionPrefixes.end(), [](const QString &a, const QString &b) {
+        return a.size() > b.size();
+    });
+    for (int i = 0; i < this->versionPrefixes.size(); ++i) {
+        const ushort first = lowerAscii(this->versionPrefixes[i][0]);
+        if (first < DISPATCH_SIZE) this->versionsByFirst[first].append(i);
+    }
+
+    // Everything normalize() depends on, in the order it was compiled
+    QString rules = this->openers + '\n' + this->closers + '\n' + this->versionPrefixes.join('\t') + '\n';
+    for (const CodeRule &rule : this->codeRules) {
+        rules += rule.prefix + '\t' + rule.separators + '\t' + QString::number(rule.minDigits) + '\t'
+                 + QString::number(rule.maxDigits) + '\t' + rule.source + '\t' + (rule.keepPrefix ? '1' : '0') + '\n';
+    }
+    const QByteArray bytes = rules.toUtf8();
+    this->hash = XxHash64::hash(bytes.constData(), size_t(bytes.size()));
+}
+
+quint64 TitleNormalizer::rulesHash() const {
+    return this->hash;
+}
+
+int TitleNormalizer::matchCode(const QChar *s, int i, int end, Result &result) const {
+    const ushort first = lowerAscii(s[i]);
+    if (first >= DISPATCH_SIZE) return 0;
+
+    for (int index : this->codesByFirst[first]) {
+        const CodeRule &rule = this->codeRules[index];
+        const int prefixLength = rule.prefix.size();
+        if (end - i < prefixLength + rule.minDigits) continue;
+
+        int k = 0;
+        while (k < prefixLength && lowerAscii(s[i + k]) == lowerAscii(rule.prefix[k])) ++k;
+        if (k < prefixLength) continue;
+
+        int pos = i + prefixLength;
+        if (pos < end && !rule.separators.isEmpty() && rule.separators.contains(foldWidth(s[pos]))) ++pos;
+
+        const int digitsStart = pos;
+        while (pos < end && isDigit(s[pos]) && pos - digitsStart <= rule.maxDigits) ++pos;
+        const int digits = pos - digitsStart;
+        if (digits < rule.minDigits || digits > rule.maxDigits) continue;
+        if (pos < end && isWordChar(s[pos])) continue;
+
+        if (result.gameCode.isEmpty()) {
+            QString code;
+            code.reserve(prefixLength + digits);
+            if (rule.keepPrefix) code += rule.prefix.toUpper();
+            for (int d = digitsStart; d < pos; ++d) code += foldWidth(s[d]);
+            result.gameCode = code;
+            result.source = rule.source;
+        }
+        return pos - i;
+    }
+    return 0;
+}
+
+int TitleNormalizer::matchVersion(const QChar *s, int i, int end) const {
+    const ushort first = lowerAscii(s[i]);
+    if (first >= DISPATCH_SIZE) return 0;
+
+    for (int index : this->versionsByFirst[first]) {
+        const QString &prefix = this->versionPrefixes[index];
+        const int prefixLength = prefix.size();
+        if (end - i <= prefixLength) continue;
+
+        int k = 0;
+        while (k < prefixLength && lowerAscii(s[i + k]) == prefix[k].unicode()) ++k;
+        if (k < prefixLength) continue;
+
+        // The number has to follow directly: "v1.0", "ver.2", but not "Vampire" or "Ver Two"
+        int pos = i + prefixLength;
+        if (!isDigit(s[pos])) continue;
+        if (prefixLength == 1) {
+            // One letter and a number is too often part of the title: only v\d+(\.\d+)+
+            while (pos < end && isDigit(s[pos])) ++pos;
+            int groups = 0;
+            while (pos + 1 < end && foldWidth(s[pos]) == '.' && isDigit(s[pos + 1])) {
+                pos += 2;
+                while (pos < end && isDigit(s[pos])) ++pos;
+                ++groups;
+            }
+            if (groups == 0) continue;
+        }
+        while (pos < end) {
+            const QChar c = foldWidth(s[pos]);
+            if (!c.isLetterOrNumber() && c != '.') break;
+            ++pos;
+        }
+        // A trailing dot belongs to the sentence, not the version
+        while (pos > i + prefixLength && foldWidth(s[pos - 1]) == '.') --pos;
+        return pos - i;
+    }
+    return 0;
+}
+
+TitleNormalizer::Result TitleNormalizer::normalize(const QString &name, bool isFile) const {
+    Result result;
+    const QChar *s = name.constData();
+
+    int end = name.size();
+    if (isFile) {
+        int lastDot = name.lastIndexOf('.');
+        if (lastDot > 0) end = lastDot;
+    }
+
+    QString clean;
+    clean.reserve(end);
+    bool pendingSpace = false;
+
+    int i = 0;
+    while (i < end) {
+        const QChar c = foldWidth(s[i]);
+
+        const int bracket = this->openers.indexOf(c);
+        if (bracket >= 0) {
+            // Same-kind nesting only: "(Win (JP))" is one group
+            const QChar closer = this->closers[bracket];
+            int depth = 1;
+            int j = i + 1;
+            for (; j < end; ++j) {
+                const QChar d = foldWidth(s[j]);
+                if (d == closer && --depth == 0) break;
+                if (d == c) ++depth;
+            }
+            if (j < end) {
+                for (int k = i + 1; k < j && result.gameCode.isEmpty(); ++k) {
+                    if (k == i + 1 || !isWordChar(s[k - 1])) {
+                        const int matched = matchCode(s, k, j, result);
+                        if (matched > 0) k += matched - 1;
+                    }
+                }
+                pendingSpace = !clean.isEmpty();
+                i = j + 1;
+                continue;
+            }
+            // Unbalanced: keep it as text
+        }
+
+        if (i == 0 || !isWordChar(s[i - 1])) {
+            int matched = matchCode(s, i, end, result);
+            if (matched == 0) matched = matchVersion(s, i, end);
+            if (matched > 0) {
+                pendingSpace = !clean.isEmpty();
+                i += matched;
+                continue;
+            }
+        }
+
+        if (c == '_' || c.isSpace()) {
+            pendingSpace = !clean.isEmpty();
+        } else {
+            if (pendingSpace) clean += ' ';
+            pendingSpace = false;
+            clean += c;
+        }
+        ++i;
+    }
+
+    int from = 0;
+    int to = clean.size();
+    while (from < to && TRIM_CHARS.contains(clean[from])) ++from;
+    while (to > from && TRIM_CHARS.contains(clean[to - 1])) --to;
+    result.cleanName = (from == 0 && to == clean.size()) ? clean : clean.mid(from, to - from);
+
+    // Nothing but a code or tags: the raw name beats an empty title
+    if (result.cleanName.isEmpty()) result.cleanName = name.left(end).simplified();
+    return result;
+}
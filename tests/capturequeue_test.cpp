@@ -0,0 +1,112 @@
+#include "thumbnailmanager.h"
+#include "capturebackend.h"
+#include "thumbnailpreview.h"
+#include <QtTest>
+#include <QStandardPaths>
+#include <QFileInfo>
+#include <memory>
+
+// Runs ThumbnailManager's queue headless through the fake backend, with /bin/cat standing
+// in for a game: it waits on its stdin until the queue kills it.
+//   QT_QPA_PLATFORM=offscreen CaptureQueueTest
+
+// The fake backend with a window that never opens
+class NoWindowBackend : public CaptureBackend {
+public:
+    NoWindowBackend() : fake(CaptureBackend::create(Backend::Fake)) {}
+
+    void prepare(QProcess &process) override { this->fake->prepare(process); }
+    void attach(QProcess &process) override { this->fake->attach(process); }
+    void killProcessTree(QProcess &process) override { this->fake->killProcessTree(process); }
+    WId findWindow(qint64 pid) override {
+        Q_UNUSED(pid);
+        return 0;
+    }
+    void raise(WId window) override { this->fake->raise(window); }
+    QImage grab(WId window) override { return this->fake->grab(window); }
+    Backend backend() const override { return Backend::Fake; }
+
+private:
+    std::unique_ptr<CaptureBackend> fake;
+};
+
+class CaptureQueueTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {
+#ifndef Q_OS_UNIX
+        QSKIP("Needs /bin/cat as a stand-in game");
+#endif
+        // ThumbnailStore writes the captures under AppData
+        QStandardPaths::setTestModeEnabled(true);
+    }
+
+    void success() {
+        ThumbnailManager queue;
+        queue.setBackend(CaptureBackend::create(CaptureBackend::Backend::Fake));
+        QSignalSpy finished(&queue, &ThumbnailManager::captureFinished);
+        QSignalSpy failed(&queue, &ThumbnailManager::captureFailed);
+        QSignalSpy empty(&queue, &ThumbnailManager::finished);
+
+        queue.enqueue("game", "/bin/cat", 10);
+        QVERIFY(queue.isRunning());
+        // The fake window paints after FAKE_PAINT_MS, then has to hold still for SETTLE_MS
+        QVERIFY(empty.wait(8000));
+
+        QCOMPARE(failed.count(), 0);
+        QCOMPARE(finished.count(), 1);
+        const QList<QVariant> result = finished.takeFirst();
+        QCOMPARE(result[0].toString(), QString("game"));
+        QVERIFY(QFileInfo::exists(result[1].toString()));
+        QVERIFY(ThumbnailPreview::isValid(result[2].toByteArray()));
+        QVERIFY(!queue.isRunning());
+    }
+
+    void timeout() {
+        ThumbnailManager queue;
+        queue.setBackend(new NoWindowBackend);
+        QSignalSpy finished(&queue, &ThumbnailManager::captureFinished);
+        QSignalSpy failed(&queue, &ThumbnailManager::captureFailed);
+        QSignalSpy empty(&queue, &ThumbnailManager::finished);
+
+        queue.enqueue("game", "/bin/cat", 1);
+        QVERIFY(empty.wait(5000));
+
+        QCOMPARE(finished.count(), 0);
+        QCOMPARE(failed.count(), 1);
+        QCOMPARE(failed[0][0].toString(), QString("game"));
+        QCOMPARE(failed[0][1].toString(), QString("Timed out waiting for the game window."));
+    }
+
+    void cancel() {
+        ThumbnailManager queue;
+        queue.setBackend(CaptureBackend::create(CaptureBackend::Backend::Fake));
+        QSignalSpy finished(&queue, &ThumbnailManager::captureFinished);
+        QSignalSpy failed(&queue, &ThumbnailManager::captureFailed);
+        QSignalSpy progress(&queue, &ThumbnailManager::progress);
+        QSignalSpy empty(&queue, &ThumbnailManager::finished);
+
+        queue.enqueue("first", "/bin/cat", 10);
+        queue.enqueue("second", "/bin/cat", 10);
+        QTest::qWait(500); // First one has a (blank) window by now
+        progress.clear();
+
+        queue.cancel();
+        QVERIFY(!queue.isRunning());
+        // Queued, so a slot can't re-enter the queue halfway through
+        QCOMPARE(failed.count(), 0);
+
+        QVERIFY(empty.wait(2000));
+        QCOMPARE(finished.count(), 0);
+        QCOMPARE(failed.count(), 1); // The second one never started
+        QCOMPARE(failed[0][0].toString(), QString("first"));
+        QCOMPARE(failed[0][1].toString(), QString("Cancelled."));
+        QCOMPARE(progress.count(), 1);
+        QCOMPARE(progress[0][0].toInt(), 1);
+        QCOMPARE(progress[0][1].toInt(), 1);
+    }
+};
+
+QTEST_MAIN(CaptureQueueTest)
+#include "capturequeue_test.moc"
@@ -0,0 +1,68 @@
+#include "thumbnailstore.h"
+#include <QtTest>
+#include <QStandardPaths>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+
+// Stores images in a test-mode AppData and runs maintenance over them.
+//   ThumbnailStoreTest
+
+static QImage solidImage(const QColor &color) {
+    QImage image(32, 32, QImage::Format_RGB32);
+    image.fill(color);
+    return image;
+}
+
+// Past the store's one-hour grace period
+static void backdate(const QString &path) {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(-2 * 60 * 60), QFileDevice::FileModificationTime));
+}
+
+class ThumbnailStoreTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {
+        QStandardPaths::setTestModeEnabled(true);
+        const QString data = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        QDir(data + "/thumbnails/store").removeRecursively();
+    }
+
+    void storingAgainRestartsGracePeriod() {
+        const QString path = ThumbnailStore::instance().store(solidImage(Qt::red));
+        QVERIFY(!path.isEmpty());
+        backdate(path);
+
+        QCOMPARE(ThumbnailStore::instance().store(solidImage(Qt::red)), path);
+        QVERIFY(QFileInfo(path).lastModified() > QDateTime::currentDateTime().addSecs(-60));
+    }
+
+    void maintenanceKeepsStoredAgainOrphans() {
+        ThumbnailStore &store = ThumbnailStore::instance();
+        const QString reused = store.store(solidImage(Qt::green));
+        const QString orphan = store.store(solidImage(Qt::blue));
+        QVERIFY(!reused.isEmpty() && !orphan.isEmpty());
+        backdate(reused);
+        backdate(orphan);
+
+        // An old orphan picked again, e.g. by an edit dialog that hasn't saved yet
+        QCOMPARE(store.store(solidImage(Qt::green)), reused);
+
+        QSignalSpy finished(&store, &ThumbnailStore::maintenanceFinished);
+        store.startMaintenance();
+        QVERIFY(finished.wait(10000));
+
+        const QStringList removed = finished[0][3].toStringList();
+        QVERIFY(QFileInfo::exists(reused));
+        QVERIFY(!removed.contains(reused));
+        QVERIFY(!QFileInfo::exists(orphan));
+        QVERIFY(removed.contains(orphan));
+    }
+};
+
+QTEST_MAIN(ThumbnailStoreTest)
+#include "thumbnailstore_test.moc"